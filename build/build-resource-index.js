@@ -14,6 +14,7 @@ const resources = allResourceFilePaths.map(resourceFilePath => {
   return {
     namespaces,
     name: path.basename(resourceFilePath).replace('.', '_').toUpperCase(),
+    filePath: path.relative(path.join(__dirname, '../src'), resourceFilePath),
   };
 });
 
@@ -27,7 +28,12 @@ try {
     path.dirname(indexFilePath),
     path.resolve(__dirname, '../src/ds/resource.h')
   );
-  fs.writeSync(fd, `#include "${resourceHeaderPath}"\n\n`);
+  fs.writeSync(fd, `#include "${resourceHeaderPath}"\n`);
+  fs.writeSync(fd, `#include <cstdint>\n\n`);
+  fs.writeSync(fd, `namespace resources {\n`);
+  fs.writeSync(fd, `extern const std::uint8_t* const PACK_DATA;\n`);
+  fs.writeSync(fd, `extern const size_t PACK_SIZE;\n`);
+  fs.writeSync(fd, `}\n\n`);
   for (let i = 0; i < resources.length; ++i) {
     const res = resources[i];
     let k = 0;
@@ -45,7 +51,10 @@ try {
       currentNamespaces.push(ns);
       fs.writeSync(fd, `namespace ${ns} {\n`);
     }
-    fs.writeSync(fd, `extern const ds::resource ${res.name};\n`);
+    fs.writeSync(
+      fd,
+      `const char* const ${res.name} = "${res.filePath}";\n`
+    );
   }
   while (currentNamespaces.length > 0) {
     fs.writeSync(fd, '}\n');
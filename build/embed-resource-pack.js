@@ -0,0 +1,54 @@
+#!/usr/bin/env node
+
+'use strict';
+
+/**
+ * Link the resource pack in the binary with `.incbin`, rather than having
+ * the compiler parse it as a C array literal.
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+
+const packFilePath = path.resolve(process.argv[3]);
+const content = fs.readFileSync(packFilePath);
+// So that the source changes, and gets recompiled, whenever the pack does.
+const digest = crypto.createHash('sha1').update(content).digest('hex');
+const sourceFilePath = process.argv[2];
+const resourceHeaderPath = path.relative(
+  path.dirname(sourceFilePath),
+  path.resolve(__dirname, '../src/ds/resource.h')
+);
+
+fs.writeFileSync(sourceFilePath, `// THIS FILE IS AUTOGENERATED, DO NOT MODIFY
+// Pack digest: ${digest}
+#include "${resourceHeaderPath}"
+#include <cstdint>
+
+#ifdef __APPLE__
+#define DS_PACK_SECTION ".const_data\\n"
+#define DS_PACK_SYMBOL "_ds_resource_pack"
+#else
+#define DS_PACK_SECTION ".section .rodata\\n"
+#define DS_PACK_SYMBOL "ds_resource_pack"
+#endif
+
+asm(
+  DS_PACK_SECTION
+  ".balign 16\\n"
+  ".globl " DS_PACK_SYMBOL "\\n"
+  DS_PACK_SYMBOL ":\\n"
+  ".incbin \\"${packFilePath}\\"\\n"
+  ".text\\n"
+);
+
+extern "C" const std::uint8_t ds_resource_pack[];
+
+namespace resources {
+
+extern const std::uint8_t* const PACK_DATA = ds_resource_pack;
+extern const size_t PACK_SIZE = ${content.length};
+
+}
+`);
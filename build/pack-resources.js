@@ -0,0 +1,137 @@
+#!/usr/bin/env node
+
+'use strict';
+
+/**
+ * Put all the resources in a single pack file, see `src/ds/resource_pack.h`
+ * for the format. Entries are LZ4-compressed when that makes them smaller.
+ */
+
+const fs = require('fs');
+const path = require('path');
+
+const MAGIC = 0x50525344; // "DSRP"
+const VERSION = 1;
+const HEADER_SIZE = 16;
+const ENTRY_SIZE = 24;
+const FLAG_LZ4 = 1;
+
+const MIN_MATCH = 4;
+const MAX_OFFSET = 0xffff;
+// The LZ4 block format wants the last 5 bytes to be literals, and the last
+// match to start at least 12 bytes before the end.
+const LAST_LITERALS = 5;
+const MATCH_LIMIT = 12;
+const HASH_BITS = 12;
+
+function hash(content, i) {
+  const value = content.readUInt32LE(i);
+  return (Math.imul(value, 2654435761) >>> (32 - HASH_BITS));
+}
+
+function writeLength(bytes, length) {
+  while (length >= 255) {
+    bytes.push(255);
+    length -= 255;
+  }
+  bytes.push(length);
+}
+
+function writeSequence(bytes, content, start, end, offset, matchLength) {
+  const literalLength = end - start;
+  const token =
+    (Math.min(literalLength, 15) << 4) |
+    (offset > 0 ? Math.min(matchLength - MIN_MATCH, 15) : 0);
+  bytes.push(token);
+  if (literalLength >= 15) {
+    writeLength(bytes, literalLength - 15);
+  }
+  for (let i = start; i < end; ++i) {
+    bytes.push(content[i]);
+  }
+  if (offset === 0) {
+    return;
+  }
+  bytes.push(offset & 0xff, offset >> 8);
+  if (matchLength - MIN_MATCH >= 15) {
+    writeLength(bytes, matchLength - MIN_MATCH - 15);
+  }
+}
+
+/**
+ * Greedy LZ4 block compression, with a single candidate per hash. Resources
+ * get packed once per build so speed doesn't matter much.
+ */
+function compressLZ4(content) {
+  const bytes = [];
+  const table = new Int32Array(1 << HASH_BITS).fill(-1);
+  const matchEnd = content.length - LAST_LITERALS;
+  let anchor = 0;
+  let i = 0;
+  while (i + MATCH_LIMIT <= content.length) {
+    const h = hash(content, i);
+    const candidate = table[h];
+    table[h] = i;
+    if (
+      candidate < 0 ||
+      i - candidate > MAX_OFFSET ||
+      content.readUInt32LE(candidate) !== content.readUInt32LE(i)
+    ) {
+      ++i;
+      continue;
+    }
+    let length = MIN_MATCH;
+    while (
+      i + length < matchEnd &&
+      content[candidate + length] === content[i + length]
+    ) {
+      ++length;
+    }
+    writeSequence(bytes, content, anchor, i, i - candidate, length);
+    i += length;
+    anchor = i;
+  }
+  writeSequence(bytes, content, anchor, content.length, 0, 0);
+  return Buffer.from(bytes);
+}
+
+const topDir = path.resolve(__dirname, '../src');
+const entries = process.argv.slice(3).map(resourceFilePath => {
+  const content = fs.readFileSync(resourceFilePath);
+  const compressed = compressLZ4(content);
+  const useLZ4 = compressed.length < content.length;
+  return {
+    path: Buffer.from(path.relative(topDir, resourceFilePath) + '\0'),
+    size: content.length,
+    flags: useLZ4 ? FLAG_LZ4 : 0,
+    // Uncompressed entries get a terminating zero, so that they can be used
+    // in place as C strings.
+    stored: useLZ4 ? compressed : Buffer.concat([content, Buffer.from([0])]),
+  };
+});
+entries.sort((a, b) => Buffer.compare(a.path, b.path));
+
+const header = Buffer.alloc(HEADER_SIZE + entries.length * ENTRY_SIZE);
+header.writeUInt32LE(MAGIC, 0);
+header.writeUInt32LE(VERSION, 4);
+header.writeUInt32LE(entries.length, 8);
+let offset = header.length;
+const chunks = [header];
+entries.forEach((entry, i) => {
+  const at = HEADER_SIZE + i * ENTRY_SIZE;
+  header.writeUInt32LE(offset, at);
+  header.writeUInt32LE(entry.path.length - 1, at + 4);
+  offset += entry.path.length;
+  chunks.push(entry.path);
+});
+entries.forEach((entry, i) => {
+  const at = HEADER_SIZE + i * ENTRY_SIZE;
+  header.writeUInt32LE(offset, at + 8);
+  header.writeUInt32LE(entry.stored.length - (entry.flags ? 0 : 1), at + 12);
+  header.writeUInt32LE(entry.size, at + 16);
+  header.writeUInt32LE(entry.flags, at + 20);
+  offset += entry.stored.length;
+  chunks.push(entry.stored);
+});
+
+fs.writeFileSync(process.argv[2], Buffer.concat(chunks));
@@ -11,12 +11,26 @@ const resource_sources = [
 
 const BUILD_DIR = '.build_files';
 
-const resource_cpp_files = manifest.rule(
-  manifest.cli_template("build/embed-resource.js", [
+const LINK_FLAGS = process.platform === 'darwin'
+  ? ['-framework', 'OpenGL', '-lglew', '-lglfw3']
+  : ['-lGLEW', '-lGL', '-lEGL', '-lglfw', '-pthread'];
+
+// All resources go in a single pack. It's linked in the binary, and can be
+// given to `--resource-pack` to try changes without relinking.
+const resource_pack_file = manifest.rule(
+  manifest.cli_template("build/pack-resources.js", [
     {variables: ["output_file", "input_files"]},
   ]),
   resource_sources,
-  `${BUILD_DIR}/($1).cpp`
+  `${BUILD_DIR}/resources.pack`
+);
+
+const resource_pack_cpp_file = manifest.rule(
+  manifest.cli_template("build/embed-resource-pack.js", [
+    {variables: ["output_file", "input_files"]},
+  ]),
+  [resource_pack_file],
+  `${BUILD_DIR}/(resources_pack).cpp`
 );
 
 const resource_index_file = manifest.rule(
@@ -27,18 +41,12 @@ const resource_index_file = manifest.rule(
   `${BUILD_DIR}/headers/resources.h`
 );
 
-const generated_cpps = manifest.rule(
-  manifest.cli_template('node', [
-    {variables: ["input_files", "output_file"]},
-  ]),
-  [manifest.source('build/gen_(icosahedron)_cpp.js')],
-  `${BUILD_DIR}/(generated_cpps/$1).cpp`
-);
-
 const compile_cpp_cli = manifest.cli_template('clang++', [
   {literals: ["-c", "-o"], variables: ["output_file"]},
   {
-    literals: ["-std=c++14", "-Wall", "-fcolor-diagnostics", "-MMD", "-MF"],
+    literals: [
+      "-std=c++14", "-O2", "-Wall", "-fcolor-diagnostics", "-MMD", "-MF",
+    ],
     variables: ["dependency_file"]
   },
   {
@@ -47,28 +55,47 @@ const compile_cpp_cli = manifest.cli_template('clang++', [
   },
 ]);
 
-const compiled_cpp_files = manifest.rule(
+const compile_cpps = sources => manifest.rule(
   compile_cpp_cli,
-  [
-    manifest.source("(src/**/*).cpp"),
-    generated_cpps,
-    resource_cpp_files,
-  ],
+  sources,
   `${BUILD_DIR}/($1).o`,
   [resource_index_file]
 );
 
+// The benchmark links `ds` without any of the windowing code. It never
+// creates a GL context, but the renderers in `ds` refer to `glpp`.
+const ds_object_files = compile_cpps([
+  manifest.source("(src/ds/**/*).cpp"),
+  manifest.source("(src/glpp/**/*).cpp"),
+]);
+
+const app_object_files = compile_cpps([
+  manifest.source("(src/eglpp/**/*).cpp"),
+  manifest.source("(src/glfwpp/**/*).cpp"),
+  manifest.source("(src/main).cpp"),
+  resource_pack_cpp_file,
+]);
+
+const bench_object_files = compile_cpps([
+  manifest.source("(src/bench/**/*).cpp"),
+]);
+
+const link_cli = manifest.cli_template('clang++', [
+  {literals: ["-o"], variables: ["output_file"]},
+  {
+    literals: LINK_FLAGS.concat(
+      ['-Wall', '-std=c++14', '-fcolor-diagnostics', '-L', '/usr/local/lib']
+    ),
+    variables: ["input_files"]
+  },
+]);
+
+manifest.rule(link_cli, [ds_object_files, app_object_files], "dist/gl-demo");
+
 manifest.rule(
-  manifest.cli_template('clang++', [
-    {literals: ["-o"], variables: ["output_file"]},
-    {
-      literals: ['-framework', 'OpenGL', '-Wall', '-std=c++14',
-        '-lglew', '-lglfw3', '-fcolor-diagnostics', '-L', '/usr/local/lib'],
-      variables: ["input_files"]
-    },
-  ]),
-  [compiled_cpp_files],
-  "dist/gl-demo"
+  link_cli,
+  [ds_object_files, bench_object_files],
+  "dist/gl-demo-bench"
 );
 
 manifest.export(__dirname);
@@ -0,0 +1,512 @@
+#include "../ds/cube.h"
+#include "../ds/geodesic_sphere.h"
+#include "../ds/mesh_optimizer.h"
+#include "../ds/meshlets.h"
+#include "../ds/noise_terrain.h"
+#include "../ds/normals.h"
+#include "../ds/palette.h"
+#include "../ds/planet.h"
+#include "../ds/planet_mesh.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> allocation_count(0);
+std::atomic<size_t> allocated_bytes(0);
+std::atomic<size_t> live_bytes(0);
+std::atomic<size_t> peak_live_bytes(0);
+
+/**
+ * Allocations are prefixed with their size, so that deleting them can keep
+ * track of the bytes still live.
+ */
+const size_t ALLOCATION_HEADER_SIZE = alignof(std::max_align_t);
+
+}
+
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  auto ptr = static_cast<char*>(std::malloc(ALLOCATION_HEADER_SIZE + size));
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<size_t*>(ptr) = size;
+  auto live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  auto peak = peak_live_bytes.load(std::memory_order_relaxed);
+  while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live)) {}
+  return ptr + ALLOCATION_HEADER_SIZE;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  auto base = static_cast<char*>(ptr) - ALLOCATION_HEADER_SIZE;
+  live_bytes.fetch_sub(
+    *reinterpret_cast<size_t*>(base),
+    std::memory_order_relaxed
+  );
+  std::free(base);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  operator delete(ptr);
+}
+
+namespace gl_demo_bench {
+
+struct options {
+  options():
+    show_help(false),
+    frequencies({8, 16, 32, 64}),
+    seeds({123}),
+    iterations(10) {
+    thread_counts.push_back(1);
+    if (std::thread::hardware_concurrency() > 1) {
+      thread_counts.push_back(std::thread::hardware_concurrency());
+    }
+  }
+
+  bool show_help;
+  std::vector<size_t> frequencies;
+  std::vector<size_t> seeds;
+  std::vector<size_t> thread_counts;
+  size_t iterations;
+  std::string output_path;
+};
+
+static size_t parse_positive_integer(
+  const std::string& arg,
+  const std::string& value
+) {
+  size_t end = 0;
+  unsigned long result = 0;
+  try {
+    result = std::stoul(value, &end);
+  } catch (const std::logic_error&) {}
+  if (end == 0 || end != value.size() || result == 0) {
+    throw std::runtime_error(
+      "expected a positive integer for `" + arg + "`, got `" + value + "`"
+    );
+  }
+  return result;
+}
+
+static std::vector<size_t> parse_list(
+  const std::string& arg,
+  const std::string& value
+) {
+  std::vector<size_t> result;
+  std::istringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    result.push_back(parse_positive_integer(arg, item));
+  }
+  if (result.empty()) {
+    throw std::runtime_error("expected a list of values for `" + arg + "`");
+  }
+  return result;
+}
+
+static std::string shift_value(const std::string& arg, int& argc, char**& argv) {
+  if (argc < 2) {
+    throw std::runtime_error("expected a value after `" + arg + "`");
+  }
+  ++argv, --argc;
+  return *argv;
+}
+
+static options parse_options(int argc, char* argv[]) {
+  options result;
+  for (++argv, --argc; argc > 0; ++argv, --argc) {
+    const auto arg = std::string(*argv);
+    if (arg == "--frequencies") {
+      result.frequencies = parse_list(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--seeds") {
+      result.seeds = parse_list(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--threads") {
+      result.thread_counts = parse_list(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--iterations") {
+      result.iterations =
+        parse_positive_integer(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--output" || arg == "-o") {
+      result.output_path = shift_value(arg, argc, argv);
+    } else if (arg == "--help" || arg == "-h") {
+      result.show_help = true;
+    } else {
+      throw std::runtime_error("unknown argument: `" + arg + "`");
+    }
+  }
+  return result;
+}
+
+static int show_help() {
+  std::cout << R"END(Usage: gl-demo-bench [options]
+Benchmark each stage of the planet generation pipeline in isolation, without
+any GL context, and write the results as JSON.
+Options:
+  --frequencies <n,...>     Sphere subdivision frequencies (default 8,16,32,64)
+  --seeds <n,...>           Planet seeds (default 123)
+  --threads <n,...>         Thread counts for the multithreaded stages
+                            (default 1 and the hardware thread count)
+  --iterations <n>          Runs of each stage (default 10)
+  --output, -o <path>       Write the JSON there instead of stdout
+  --help, -h                Show this
+)END";
+  return 0;
+}
+
+struct stage_result {
+  std::string stage;
+  size_t frequency;
+  size_t seed;
+  /**
+   * Zero for the stages that are single-threaded.
+   */
+  size_t thread_count;
+  /**
+   * Sorted durations of each run, in microseconds.
+   */
+  std::vector<double> durations;
+  size_t allocation_count;
+  size_t allocated_bytes;
+  /**
+   * Most bytes live at once during the stage, on top of those live before.
+   */
+  size_t peak_bytes;
+};
+
+/**
+ * Memory use of a stage of `ds::gen_planet()`, as it reports it.
+ */
+struct memory_result {
+  std::string stage;
+  size_t frequency;
+  size_t seed;
+  size_t allocated_bytes;
+  size_t peak_bytes;
+};
+
+/**
+ * Run `options.iterations` times `setup` followed by `stage`, timing only
+ * the latter. Allocations are those of the last run, as they are expected to
+ * be the same for all of them.
+ */
+static stage_result measure(
+  const options& options,
+  const std::function<void()>& setup,
+  const std::function<void()>& stage
+) {
+  stage_result result;
+  result.durations.reserve(options.iterations);
+  for (size_t i = 0; i < options.iterations; ++i) {
+    setup();
+    auto allocations_before = allocation_count.load();
+    auto bytes_before = allocated_bytes.load();
+    auto live_before = live_bytes.load();
+    peak_live_bytes.store(live_before);
+    auto start = std::chrono::steady_clock::now();
+    stage();
+    auto end = std::chrono::steady_clock::now();
+    result.allocation_count = allocation_count.load() - allocations_before;
+    result.allocated_bytes = allocated_bytes.load() - bytes_before;
+    result.peak_bytes = peak_live_bytes.load() - live_before;
+    result.durations.push_back(
+      std::chrono::duration<double, std::micro>(end - start).count()
+    );
+  }
+  std::sort(result.durations.begin(), result.durations.end());
+  return result;
+}
+
+static double get_percentile(const std::vector<double>& sorted, double rank) {
+  auto ix = static_cast<size_t>(rank * static_cast<double>(sorted.size()));
+  return sorted[std::min(ix, sorted.size() - 1)];
+}
+
+static void write_json(
+  std::ostream& os,
+  const std::vector<stage_result>& results,
+  const std::vector<memory_result>& memory
+) {
+  os << "{\n  \"unit\": \"us\",\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    os << "    {\"stage\": \"" << result.stage << "\""
+      << ", \"frequency\": " << result.frequency
+      << ", \"seed\": " << result.seed
+      << ", \"threads\": " << result.thread_count
+      << ", \"iterations\": " << result.durations.size()
+      << ", \"min\": " << result.durations.front()
+      << ", \"median\": " << get_percentile(result.durations, 0.5)
+      << ", \"p99\": " << get_percentile(result.durations, 0.99)
+      << ", \"allocations\": " << result.allocation_count
+      << ", \"allocated_bytes\": " << result.allocated_bytes
+      << ", \"peak_bytes\": " << result.peak_bytes
+      << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ],\n  \"memory\": [\n";
+  for (size_t i = 0; i < memory.size(); ++i) {
+    const auto& result = memory[i];
+    os << "    {\"stage\": \"" << result.stage << "\""
+      << ", \"frequency\": " << result.frequency
+      << ", \"seed\": " << result.seed
+      << ", \"allocated_bytes\": " << result.allocated_bytes
+      << ", \"peak_bytes\": " << result.peak_bytes
+      << "}" << (i + 1 < memory.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
+
+const float OVERDRAW_THRESHOLD = 1.05f;
+
+static void report_cache_stats(
+  const std::string& name,
+  const ds::mesh& before,
+  const ds::mesh& after
+) {
+  auto stats_before = ds::get_vertex_cache_stats(
+    before.triangles,
+    before.vertices.size(),
+    ds::VERTEX_CACHE_SIZE
+  );
+  auto stats_after = ds::get_vertex_cache_stats(
+    after.triangles,
+    after.vertices.size(),
+    ds::VERTEX_CACHE_SIZE
+  );
+  std::cerr << name << ": ACMR " << stats_before.acmr << " -> "
+    << stats_after.acmr << ", ATVR " << stats_before.atvr << " -> "
+    << stats_after.atvr << std::endl;
+}
+
+/**
+ * Run all the mesh optimizations on `mesh`.
+ */
+static ds::mesh optimize_mesh(ds::mesh mesh) {
+  ds::optimize_vertex_cache(mesh, ds::VERTEX_CACHE_SIZE);
+  ds::optimize_overdraw(mesh, ds::VERTEX_CACHE_SIZE, OVERDRAW_THRESHOLD);
+  ds::optimize_vertex_fetch(mesh);
+  return mesh;
+}
+
+/**
+ * The scratch arena is shared by the stages that take one, as in the app:
+ * past the first run, they take no allocations from the heap.
+ */
+static std::vector<stage_result> run_benchmarks(
+  const options& options,
+  std::vector<memory_result>& memory
+) {
+  std::vector<stage_result> results;
+  ds::scratch_arena scratch(ds::SCRATCH_BLOCK_SIZE);
+  auto add = [&](
+    const char* stage,
+    size_t frequency,
+    size_t seed,
+    size_t thread_count,
+    stage_result result
+  ) {
+    result.stage = stage;
+    result.frequency = frequency;
+    result.seed = seed;
+    result.thread_count = thread_count;
+    std::cerr << stage << " frequency=" << frequency << " seed=" << seed
+      << " threads=" << thread_count << ": median "
+      << get_percentile(result.durations, 0.5) << "us" << std::endl;
+    results.push_back(std::move(result));
+  };
+  auto noop = []() {};
+
+  auto cube = ds::get_cube();
+  report_cache_stats("cube", cube, optimize_mesh(cube));
+
+  for (auto frequency: options.frequencies) {
+    ds::mesh sphere;
+    add("geodesic_sphere", frequency, 0, 0, measure(options, noop, [&]() {
+      sphere = ds::get_geodesic_sphere(frequency);
+    }));
+
+    for (auto seed: options.seeds) {
+      ds::planet_options planet_options;
+      planet_options.seed = seed;
+      planet_options.frequency = frequency;
+      ds::planet planet;
+      planet_options.kernel = ds::terrain_kernel::REFERENCE;
+      add("gen_planet_reference", frequency, seed, 0,
+        measure(options, noop, [&]() {
+          planet = ds::gen_planet(planet_options);
+        }));
+      planet_options.kernel = ds::terrain_kernel::SIMD;
+      for (auto thread_count: options.thread_counts) {
+        planet_options.thread_count = thread_count;
+        add("gen_planet", frequency, seed, thread_count,
+          measure(options, noop, [&]() {
+            planet = ds::gen_planet(planet_options);
+          }));
+      }
+      std::cerr << "gen_planet memory frequency=" << frequency
+        << " seed=" << seed << ":";
+      for (const auto& stage: planet.memory) {
+        std::cerr << " " << stage.stage << " "
+          << stage.allocated_bytes / 1024 << " KiB";
+        memory.push_back({
+          stage.stage,
+          frequency,
+          seed,
+          stage.allocated_bytes,
+          stage.peak_bytes,
+        });
+      }
+      std::cerr << ", peak " << planet.memory.back().peak_bytes / 1024
+        << " KiB" << std::endl;
+
+      auto adjacency = ds::get_vertex_adjacency(planet.mesh);
+      ds::mesh normal_mesh = planet.mesh;
+      for (auto thread_count: options.thread_counts) {
+        add("compute_normals", frequency, seed, thread_count,
+          measure(options, noop, [&]() {
+            ds::compute_normals(
+              normal_mesh,
+              adjacency,
+              thread_count,
+              scratch
+            );
+          }));
+      }
+
+      ds::noise_terrain noise(static_cast<std::uint32_t>(seed));
+      std::vector<ds::vertex> noise_vertices;
+      auto reset_noise = [&]() { noise_vertices = sphere.vertices; };
+      add("noise_terrain_reference", frequency, seed, 0,
+        measure(options, reset_noise, [&]() {
+          noise.displace(
+            ds::terrain_kernel::REFERENCE,
+            noise_vertices,
+            1,
+            scratch
+          );
+        }));
+      for (auto thread_count: options.thread_counts) {
+        add("noise_terrain", frequency, seed, thread_count,
+          measure(options, reset_noise, [&]() {
+            noise.displace(
+              ds::terrain_kernel::SIMD,
+              noise_vertices,
+              thread_count,
+              scratch
+            );
+          }));
+      }
+
+      std::vector<ds::vertex> vertices;
+      auto reset = [&]() { vertices = planet.mesh.vertices; };
+      add("recenter_vertices", frequency, seed, 0,
+        measure(options, reset, [&]() {
+          ds::recenter_vertices(vertices);
+        }));
+      float altitude = 0;
+      add("get_average_altitude", frequency, seed, 0,
+        measure(options, reset, [&]() {
+          altitude = ds::get_average_altitude(vertices);
+        }));
+      add("shake_vertices", frequency, seed, 0,
+        measure(options, reset, [&]() {
+          ds::shake_vertices(seed, vertices);
+        }));
+      ds::palette palette;
+      add("planet_palette", frequency, seed, 0,
+        measure(options, noop, [&]() {
+          palette = ds::get_planet_palette(planet.ocean_altitude);
+        }));
+      ds::meshlet_set meshlets;
+      add("build_meshlets", frequency, seed, 0,
+        measure(options, noop, [&]() {
+          meshlets = ds::build_meshlets(planet.mesh);
+        }));
+      ds::meshlet_set optimized_meshlets;
+      add("optimize_meshlets", frequency, seed, 0,
+        measure(options, [&]() { optimized_meshlets = meshlets; }, [&]() {
+          ds::optimize_meshlets(optimized_meshlets, planet.mesh);
+        }));
+
+      ds::mesh mesh;
+      add("optimize_vertex_cache", frequency, seed, 0,
+        measure(options, [&]() { mesh = planet.mesh; }, [&]() {
+          ds::optimize_vertex_cache(mesh, ds::VERTEX_CACHE_SIZE);
+        }));
+      auto cache_optimized = mesh;
+      add("optimize_overdraw", frequency, seed, 0,
+        measure(options, [&]() { mesh = cache_optimized; }, [&]() {
+          ds::optimize_overdraw(
+            mesh,
+            ds::VERTEX_CACHE_SIZE,
+            OVERDRAW_THRESHOLD
+          );
+        }));
+      auto overdraw_optimized = mesh;
+      add("optimize_vertex_fetch", frequency, seed, 0,
+        measure(options, [&]() { mesh = overdraw_optimized; }, [&]() {
+          ds::optimize_vertex_fetch(mesh);
+        }));
+      report_cache_stats(
+        "planet frequency=" + std::to_string(frequency) +
+          " seed=" + std::to_string(seed),
+        planet.mesh,
+        mesh
+      );
+      auto meshlet_stats_before =
+        ds::get_vertex_cache_stats(meshlets, ds::VERTEX_CACHE_SIZE);
+      auto meshlet_stats_after =
+        ds::get_vertex_cache_stats(optimized_meshlets, ds::VERTEX_CACHE_SIZE);
+      std::cerr << "meshlets frequency=" << frequency << " seed=" << seed
+        << ": ACMR " << meshlet_stats_before.acmr << " -> "
+        << meshlet_stats_after.acmr << ", ATVR " << meshlet_stats_before.atvr
+        << " -> " << meshlet_stats_after.atvr << std::endl;
+    }
+  }
+  return results;
+}
+
+static int run(int argc, char* argv[]) {
+  const auto options = parse_options(argc, argv);
+  if (options.show_help) {
+    return show_help();
+  }
+  std::vector<memory_result> memory;
+  auto results = run_benchmarks(options, memory);
+  if (options.output_path.empty()) {
+    write_json(std::cout, results, memory);
+    return 0;
+  }
+  std::ofstream output(options.output_path);
+  write_json(output, results, memory);
+  if (!output) {
+    throw std::runtime_error("cannot write `" + options.output_path + "`");
+  }
+  return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  try {
+    return gl_demo_bench::run(argc, argv);
+  } catch (const std::runtime_error& error) {
+    std::cerr << "fatal: " << error.what() << std::endl;
+    return 2;
+  }
+}
@@ -4,12 +4,12 @@
 namespace ds {
 
 /**
- * An arbitrary dataset embeded into the binary file.
+ * An arbitrary dataset of the resource pack, see `resource_pack`.
  */
 struct resource {
   /**
-   * The original file path this resource has been build from. It may be
-   * a `nullptr` for production builds.
+   * The original file path this resource has been built from, relative to
+   * `src`.
    */
   const char* file_path;
   /**
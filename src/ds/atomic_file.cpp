@@ -0,0 +1,38 @@
+#include "atomic_file.h"
+#include "system_error.h"
+#include <cerrno>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ds {
+
+atomic_file::atomic_file(const std::string& directory, std::string path):
+  path_(std::move(path)),
+  temporary_path_(path_ + ".tmp" + std::to_string(getpid())),
+  committed_(false) {
+  if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    throw system_error("cannot create the cache directory `" + directory + "`");
+  }
+  stream_.open(temporary_path_, std::ios::binary);
+}
+
+atomic_file::~atomic_file() {
+  if (!committed_) {
+    stream_.close();
+    std::remove(temporary_path_.c_str());
+  }
+}
+
+void atomic_file::commit() {
+  stream_.close();
+  if (!stream_) {
+    throw system_error("cannot write the cache file `" + path_ + "`");
+  }
+  if (std::rename(temporary_path_.c_str(), path_.c_str()) != 0) {
+    throw system_error("cannot write the cache file `" + path_ + "`");
+  }
+  committed_ = true;
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <fstream>
+#include <string>
+
+namespace ds {
+
+/**
+ * Cache file that gets written to a temporary path first, then renamed over its
+ * actual path, so that other processes never see it partially written. The
+ * temporary file is removed if the writing doesn't get committed.
+ */
+class atomic_file {
+public:
+  /**
+   * Create `directory` if needed, its parent must exist, and start writing
+   * `path`, that is in it.
+   */
+  atomic_file(const std::string& directory, std::string path);
+  ~atomic_file();
+  atomic_file(atomic_file&) = delete;
+
+  std::ofstream& stream() {
+    return stream_;
+  }
+
+  /**
+   * Replace the file at the path with what got written so far.
+   */
+  void commit();
+
+private:
+  std::string path_;
+  std::string temporary_path_;
+  std::ofstream stream_;
+  bool committed_;
+};
+
+}
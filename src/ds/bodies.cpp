@@ -0,0 +1,134 @@
+#include "bodies.h"
+#include "geodesic_sphere.h"
+#include "mesh_optimizer.h"
+#include "normals.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+namespace ds {
+
+namespace {
+
+const float PI = 3.14159265f;
+
+const float MIN_ORBIT_RADIUS = 2.4f;
+const float MAX_ORBIT_RADIUS = 4.0f;
+const float ORBIT_INCLINATION = 0.4f;
+const float MIN_SCALE = 0.003f;
+const float MAX_SCALE = 0.03f;
+
+}
+
+std::vector<body> gen_bodies(std::uint_fast32_t seed, size_t count) {
+  DS_TRACE_ZONE("gen_bodies");
+  std::mt19937 mt(seed);
+  std::uniform_real_distribution<float> unit(0, 1);
+  std::uniform_real_distribution<float> urd(-1, 1);
+  std::vector<body> result(count);
+  for (auto& body: result) {
+    body.shape = static_cast<std::uint32_t>(mt() % BODY_SHAPE_COUNT);
+    body.palette = static_cast<std::uint32_t>(mt() % BODY_PALETTE_COUNT);
+    // Many more small bodies than big ones.
+    auto size = unit(mt);
+    body.scale = MIN_SCALE + (MAX_SCALE - MIN_SCALE) * size * size * size;
+    body.orbit_radius =
+      MIN_ORBIT_RADIUS + (MAX_ORBIT_RADIUS - MIN_ORBIT_RADIUS) * unit(mt);
+    body.orbit_axis = glm::normalize(glm::vec3(1, 0, urd(mt) * 0.1f));
+    body.orbit_angle = ORBIT_INCLINATION + urd(mt) * 0.03f;
+    body.orbit_phase = unit(mt) * 2 * PI;
+    // Kepler's third law, roughly.
+    body.orbit_speed = 0.2f / glm::pow(body.orbit_radius, 1.5f);
+    body.spin_axis = glm::normalize(glm::vec3(urd(mt), urd(mt), urd(mt)));
+    body.spin_speed = urd(mt) * 2;
+  }
+  return result;
+}
+
+glm::mat4 get_body_transform(const body& body, float time) {
+  auto ident = glm::mat4();
+  auto orbit = body.orbit_phase + body.orbit_speed * time;
+  return
+    glm::rotate(ident, body.orbit_angle, body.orbit_axis) *
+    glm::translate(
+      ident,
+      glm::vec3(std::cos(orbit), 0, std::sin(orbit)) * body.orbit_radius
+    ) *
+    glm::rotate(ident, body.spin_speed * time, body.spin_axis);
+}
+
+body_mesh build_body_mesh(planet planet) {
+  DS_TRACE_ZONE("build_body_mesh");
+  auto& mesh = planet.mesh;
+  optimize_vertex_cache(mesh, VERTEX_CACHE_SIZE);
+  auto remap = optimize_vertex_fetch(mesh);
+  body_mesh result;
+  result.heights = get_height_range(planet.altitudes);
+  result.ocean_altitude = planet.ocean_altitude;
+  result.radius = std::max(result.heights.max, planet.ocean_altitude);
+  result.vertices.resize(mesh.vertices.size());
+  for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+    result.vertices[i] = pack_vertex(
+      mesh.vertices[i].position,
+      planet.altitudes[remap[i]],
+      mesh.vertices[i].normal,
+      result.heights
+    );
+  }
+  result.indices.reserve(mesh.triangles.size() * 3);
+  for (const auto& triangle: mesh.triangles) {
+    for (int k = 0; k < 3; ++k) {
+      result.indices.push_back(static_cast<std::uint16_t>(triangle[k]));
+    }
+  }
+  return result;
+}
+
+std::vector<body_mesh> gen_body_meshes(std::uint_fast32_t seed) {
+  DS_TRACE_ZONE("gen_body_meshes");
+  std::mt19937 mt(seed);
+  scratch_arena scratch(SCRATCH_BLOCK_SIZE);
+  std::vector<body_mesh> result;
+  result.reserve(BODY_SHAPE_COUNT * BODY_LOD_COUNT);
+  for (size_t shape = 0; shape < BODY_SHAPE_COUNT; ++shape) {
+    planet_options options;
+    options.seed = mt();
+    options.frequency = BODY_FREQUENCIES[0];
+    options.thread_count = 1;
+    auto finest = gen_planet(options, scratch);
+    auto ocean_altitude = finest.ocean_altitude;
+    auto terrain = finest.terrain;
+    auto cuts = finest.cuts;
+    auto noise = finest.noise;
+    auto center = finest.center;
+    result.push_back(build_body_mesh(std::move(finest)));
+    for (size_t level = 1; level < BODY_LOD_COUNT; ++level) {
+      planet coarser = {
+        .mesh = get_geodesic_sphere(BODY_FREQUENCIES[level]),
+        .ocean_altitude = ocean_altitude,
+        .terrain = terrain,
+        .cuts = cuts,
+        .noise = noise,
+        .center = center,
+      };
+      displace_to_surface(
+        coarser,
+        coarser.mesh.vertices,
+        coarser.altitudes,
+        scratch
+      );
+      compute_normals(
+        coarser.mesh,
+        get_vertex_adjacency(coarser.mesh),
+        1,
+        scratch
+      );
+      result.push_back(build_body_mesh(std::move(coarser)));
+    }
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "packed_vertex.h"
+#include "planet.h"
+#include <cstdint>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Small planets share a few meshes, each at several levels of detail, from
+ * the finest to the coarsest. Frequencies must stay low enough for 16-bit
+ * indices.
+ */
+const size_t BODY_SHAPE_COUNT = 3;
+const size_t BODY_FREQUENCIES[] = {16, 8, 4};
+const size_t BODY_LOD_COUNT = sizeof(BODY_FREQUENCIES) / sizeof(size_t);
+
+/**
+ * Color variants of the bodies, as layers of a palette texture array.
+ */
+const size_t BODY_PALETTE_COUNT = 4;
+
+/**
+ * A body orbiting the origin, and spinning on itself.
+ */
+struct body {
+  std::uint32_t shape;
+  std::uint32_t palette;
+  float scale;
+  float orbit_radius;
+  /**
+   * Rotation of the orbit plane from the XZ plane.
+   */
+  glm::vec3 orbit_axis;
+  float orbit_angle;
+  float orbit_phase;
+  /**
+   * Radians per second.
+   */
+  float orbit_speed;
+  glm::vec3 spin_axis;
+  float spin_speed;
+};
+
+/**
+ * A ring of `count` bodies around the planet, of radius about 1. They are in
+ * an inclined plane, so that the camera sees them from above.
+ */
+std::vector<body> gen_bodies(std::uint_fast32_t seed, size_t count);
+
+/**
+ * Rotation and translation of the body at `time`, in seconds. The scale is
+ * kept separate, see `body_instance`.
+ */
+glm::mat4 get_body_transform(const body& body, float time);
+
+/**
+ * A whole body mesh for `glDrawElementsInstanced`, ordered for the vertex
+ * cache then for vertex fetch.
+ */
+struct body_mesh {
+  std::vector<packed_vertex> vertices;
+  std::vector<std::uint16_t> indices;
+  height_range heights;
+  float ocean_altitude;
+  /**
+   * Bounding sphere centered on the origin.
+   */
+  float radius;
+};
+
+body_mesh build_body_mesh(planet planet);
+
+/**
+ * Meshes of each shape, by shape then level of detail, see
+ * `BODY_FREQUENCIES`. All the levels of a shape are carved from the same
+ * terrain.
+ */
+std::vector<body_mesh> gen_body_meshes(std::uint_fast32_t seed);
+
+}
@@ -0,0 +1,306 @@
+#include "body_renderer.h"
+#include "culling.h"
+#include "palette.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace ds {
+
+namespace {
+
+/**
+ * Screen-space length in pixels below which the triangle edges of a level
+ * of detail are fine enough.
+ */
+const float MAX_EDGE_PIXELS = 4;
+
+/**
+ * Angle of the edges of the icosahedron, that geodesic spheres split in
+ * `frequency` segments.
+ */
+const float ICOSAHEDRON_EDGE_ANGLE = 1.107f;
+
+/**
+ * Colors the palette of each layer gets multiplied by.
+ */
+const glm::vec3 PALETTE_TINTS[BODY_PALETTE_COUNT] = {
+  glm::vec3(1, 1, 1),
+  glm::vec3(0.75f, 0.75f, 0.8f),
+  glm::vec3(1.1f, 0.7f, 0.5f),
+  glm::vec3(0.7f, 1, 0.8f),
+};
+
+size_t get_vertex_count(const std::vector<body_mesh>& meshes) {
+  size_t count = 0;
+  for (const auto& mesh: meshes) {
+    count += mesh.vertices.size();
+  }
+  return count;
+}
+
+size_t get_index_count(const std::vector<body_mesh>& meshes) {
+  size_t count = 0;
+  for (const auto& mesh: meshes) {
+    count += mesh.indices.size();
+  }
+  return count;
+}
+
+std::uint8_t tint(std::uint8_t value, float factor) {
+  return static_cast<std::uint8_t>(
+    std::min(std::lround(value * factor), 255l)
+  );
+}
+
+}
+
+body_renderer::body_renderer(
+  const std::vector<body_mesh>& meshes,
+  glpp::program& program,
+  glpp::buffer_arena& arena,
+  size_t max_instances
+):
+  program_(program),
+  arena_(arena),
+  vertices_(arena.allocate(
+    get_vertex_count(meshes) * sizeof(packed_vertex),
+    sizeof(packed_vertex)
+  )),
+  indices_(arena.allocate(
+    get_index_count(meshes) * sizeof(std::uint16_t),
+    sizeof(std::uint16_t)
+  )),
+  height_range_uniform_(program.get_uniform_location("HeightRange")),
+  ocean_altitude_uniform_(program.get_uniform_location("OceanAltitude")),
+  palettes_uniform_(program.get_uniform_location("Palettes")),
+  palette_range_uniform_(program.get_uniform_location("PaletteRange")),
+  model_attrib_(program.get_attrib_location("model")),
+  body_attrib_(program.get_attrib_location("body")),
+  instances_(std::max<size_t>(max_instances, 1) * sizeof(gpu_instance)),
+  drawn_triangle_count_(0),
+  draw_call_count_(0) {
+  size_t vertex_count = 0;
+  size_t index_count = 0;
+  for (const auto& mesh: meshes) {
+    meshes_.push_back({
+      .index_count = static_cast<GLsizei>(mesh.indices.size()),
+      .index_offset = indices_.offset + index_count * sizeof(std::uint16_t),
+      .base_vertex = static_cast<GLint>(vertex_count),
+      .heights = mesh.heights,
+      .ocean_altitude = mesh.ocean_altitude,
+      .radius = mesh.radius,
+      .first_instance = 0,
+      .instance_count = 0,
+    });
+    vertex_count += mesh.vertices.size();
+    index_count += mesh.indices.size();
+  }
+
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, vertices_.buffer);
+    glBufferSubData(
+      GL_COPY_WRITE_BUFFER,
+      vertices_.offset + meshes_[i].base_vertex * sizeof(packed_vertex),
+      meshes[i].vertices.size() * sizeof(packed_vertex),
+      meshes[i].vertices.data()
+    );
+    glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, indices_.buffer);
+    glBufferSubData(
+      GL_COPY_WRITE_BUFFER,
+      meshes_[i].index_offset,
+      meshes[i].indices.size() * sizeof(std::uint16_t),
+      meshes[i].indices.data()
+    );
+  }
+  glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glpp::state::bind_buffer(GL_ARRAY_BUFFER, vertices_.buffer);
+  glpp::state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, indices_.buffer);
+  set_packed_vertex_attribs(program, vertices_.offset);
+
+  // Instance attributes get pointed at the instances of each mesh when
+  // drawing it.
+  for (GLint column = 0; column < 4; ++column) {
+    glEnableVertexAttribArray(model_attrib_ + column);
+    glVertexAttribDivisor(model_attrib_ + column, 1);
+  }
+  glEnableVertexAttribArray(body_attrib_);
+  glVertexAttribDivisor(body_attrib_, 1);
+  glpp::state::bind_vertex_array(0);
+
+  // All the meshes have about the same ocean level.
+  glpp::state::bind_texture(GL_TEXTURE_2D_ARRAY, palettes_.handles()[0]);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  auto palette = get_planet_palette(
+    meshes.empty() ? 1 : meshes[0].ocean_altitude
+  );
+  std::vector<std::uint8_t> texels;
+  texels.reserve(palette.texels.size() * BODY_PALETTE_COUNT);
+  for (const auto& color: PALETTE_TINTS) {
+    for (size_t i = 0; i < palette.texels.size(); i += 4) {
+      texels.push_back(tint(palette.texels[i], color.x));
+      texels.push_back(tint(palette.texels[i + 1], color.y));
+      texels.push_back(tint(palette.texels[i + 2], color.z));
+      texels.push_back(palette.texels[i + 3]);
+    }
+  }
+  glTexImage3D(
+    GL_TEXTURE_2D_ARRAY,
+    0,
+    GL_RGBA8,
+    PALETTE_ALTITUDE_SIZE,
+    PALETTE_LATITUDE_SIZE,
+    BODY_PALETTE_COUNT,
+    0,
+    GL_RGBA,
+    GL_UNSIGNED_BYTE,
+    texels.data()
+  );
+}
+
+body_renderer::~body_renderer() {
+  arena_.free(vertices_);
+  arena_.free(indices_);
+}
+
+void body_renderer::update(
+  const std::vector<body_instance>& instances,
+  const glm::vec3& camera,
+  const glm::mat4& view_projection,
+  float fovy,
+  float viewport_height,
+  float occluder
+) {
+  DS_TRACE_ZONE("update_bodies");
+  auto frustum = culling::get_frustum(view_projection);
+  auto pixels_per_slope = viewport_height / 2 / std::tan(fovy / 2);
+  for (auto& mesh: meshes_) {
+    mesh.instance_count = 0;
+  }
+
+  // Count the instances of each mesh, then put them in place.
+  levels_.clear();
+  for (const auto& instance: instances) {
+    auto first = instance.shape * BODY_LOD_COUNT;
+    auto radius = meshes_[first].radius * instance.scale;
+    const auto& translation = instance.transform[3];
+    auto center = glm::vec3(translation.x, translation.y, translation.z);
+    if (
+      culling::is_outside_frustum(frustum, center, radius) ||
+      culling::is_below_horizon(camera, occluder, center, radius)
+    ) {
+      levels_.push_back(BODY_LOD_COUNT);
+      continue;
+    }
+    auto distance = std::max(glm::length(center - camera) - radius, 1e-6f);
+    auto size = radius / distance * pixels_per_slope;
+    std::uint32_t level = 0;
+    while (
+      level + 1 < BODY_LOD_COUNT &&
+      size * ICOSAHEDRON_EDGE_ANGLE / BODY_FREQUENCIES[level + 1] <=
+        MAX_EDGE_PIXELS
+    ) {
+      ++level;
+    }
+    levels_.push_back(level);
+    ++meshes_[first + level].instance_count;
+  }
+  size_t first_instance = 0;
+  drawn_triangle_count_ = 0;
+  for (auto& mesh: meshes_) {
+    mesh.first_instance = first_instance;
+    first_instance += mesh.instance_count;
+    drawn_triangle_count_ += mesh.instance_count * mesh.index_count / 3;
+    mesh.instance_count = 0;
+  }
+  staged_.resize(first_instance);
+  for (size_t i = 0; i < instances.size(); ++i) {
+    if (levels_[i] == BODY_LOD_COUNT) {
+      continue;
+    }
+    const auto& instance = instances[i];
+    auto& mesh = meshes_[instance.shape * BODY_LOD_COUNT + levels_[i]];
+    staged_[mesh.first_instance + mesh.instance_count++] = {
+      .model = instance.transform,
+      .scale = instance.scale,
+      .palette = static_cast<float>(instance.palette),
+    };
+  }
+
+  auto size = staged_.size() * sizeof(gpu_instance);
+  if (size > instances_.section_size()) {
+    throw std::logic_error("more bodies than the renderer was made for");
+  }
+  std::memcpy(instances_.map(), staged_.data(), size);
+  instances_.unmap();
+}
+
+void body_renderer::draw() {
+  program_.use();
+  glpp::state::active_texture(GL_TEXTURE0);
+  glpp::state::bind_texture(GL_TEXTURE_2D_ARRAY, palettes_.handles()[0]);
+  program_.uniform_1i(palettes_uniform_, 0);
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glpp::state::bind_buffer(GL_ARRAY_BUFFER, instances_.buffer());
+  draw_call_count_ = 0;
+  for (const auto& mesh: meshes_) {
+    if (mesh.instance_count == 0) {
+      continue;
+    }
+    auto offset =
+      instances_.offset() + mesh.first_instance * sizeof(gpu_instance);
+    for (GLint column = 0; column < 4; ++column) {
+      glVertexAttribPointer(
+        model_attrib_ + column,
+        4,
+        GL_FLOAT,
+        GL_FALSE,
+        sizeof(gpu_instance),
+        reinterpret_cast<void*>(
+          offset + offsetof(gpu_instance, model) +
+          column * sizeof(glm::vec4)
+        )
+      );
+    }
+    glVertexAttribPointer(
+      body_attrib_,
+      2,
+      GL_FLOAT,
+      GL_FALSE,
+      sizeof(gpu_instance),
+      reinterpret_cast<void*>(offset + offsetof(gpu_instance, scale))
+    );
+    program_.uniform_2f(
+      height_range_uniform_,
+      mesh.heights.min,
+      mesh.heights.max
+    );
+    program_.uniform_1f(ocean_altitude_uniform_, mesh.ocean_altitude);
+    program_.uniform_2f(
+      palette_range_uniform_,
+      mesh.ocean_altitude + PALETTE_MIN_ALTITUDE,
+      mesh.ocean_altitude + PALETTE_MAX_ALTITUDE
+    );
+    glDrawElementsInstancedBaseVertex(
+      GL_TRIANGLES,
+      mesh.index_count,
+      GL_UNSIGNED_SHORT,
+      reinterpret_cast<void*>(mesh.index_offset),
+      static_cast<GLsizei>(mesh.instance_count),
+      mesh.base_vertex
+    );
+    ++draw_call_count_;
+  }
+  glpp::state::bind_vertex_array(0);
+  instances_.fence();
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "../glpp/buffer_arena.h"
+#include "../glpp/program.h"
+#include "../glpp/ring_buffer.h"
+#include "../glpp/textures.h"
+#include "../glpp/vertex_arrays.h"
+#include "bodies.h"
+#include <vector>
+
+namespace ds {
+
+/**
+ * A body to draw this frame. `transform` is a rotation and a translation.
+ */
+struct body_instance {
+  std::uint32_t shape;
+  std::uint32_t palette;
+  float scale;
+  glm::mat4 transform;
+};
+
+/**
+ * Draw many bodies sharing a few meshes with one `glDrawElementsInstanced`
+ * per mesh and level of detail, whatever the number of bodies. Bodies are
+ * culled and get their level of detail on the CPU, then their transforms
+ * are written to a ring buffer, grouped by mesh. All the meshes are in a
+ * single vertex and index range of the arena.
+ *
+ * The program must have the attributes and uniforms of `bodies.vs`.
+ */
+class body_renderer {
+public:
+  /**
+   * `meshes` are by shape then level of detail, see `gen_body_meshes()`.
+   * The arena must outlive the renderer. Updates take at most
+   * `max_instances`.
+   */
+  body_renderer(
+    const std::vector<body_mesh>& meshes,
+    glpp::program& program,
+    glpp::buffer_arena& arena,
+    size_t max_instances
+  );
+  ~body_renderer();
+  body_renderer(body_renderer&) = delete;
+
+  /**
+   * Keep the instances that may be visible from `camera`, in world space:
+   * those in the frustum and not hidden behind a sphere of radius
+   * `occluder` at the origin. Each one is drawn at the coarsest level of
+   * detail whose triangle edges are small enough on screen.
+   */
+  void update(
+    const std::vector<body_instance>& instances,
+    const glm::vec3& camera,
+    const glm::mat4& view_projection,
+    float fovy,
+    float viewport_height,
+    float occluder
+  );
+
+  /**
+   * Draw the instances kept by the last update, with the program.
+   */
+  void draw();
+
+  size_t drawn_instance_count() const {
+    return staged_.size();
+  }
+
+  size_t drawn_triangle_count() const {
+    return drawn_triangle_count_;
+  }
+
+  size_t draw_call_count() const {
+    return draw_call_count_;
+  }
+
+private:
+  /**
+   * As read by `bodies.vs`.
+   */
+  struct gpu_instance {
+    glm::mat4 model;
+    float scale;
+    float palette;
+  };
+
+  struct mesh_range {
+    GLsizei index_count;
+    size_t index_offset;
+    GLint base_vertex;
+    height_range heights;
+    float ocean_altitude;
+    float radius;
+    /**
+     * Instances of the last update, in `staged_`.
+     */
+    size_t first_instance;
+    size_t instance_count;
+  };
+
+  glpp::program& program_;
+  glpp::buffer_arena& arena_;
+  glpp::buffer_arena::range vertices_;
+  glpp::buffer_arena::range indices_;
+  std::vector<mesh_range> meshes_;
+  glpp::textures<1> palettes_;
+  GLint height_range_uniform_;
+  GLint ocean_altitude_uniform_;
+  GLint palettes_uniform_;
+  GLint palette_range_uniform_;
+  GLint model_attrib_;
+  GLint body_attrib_;
+  glpp::vertex_arrays<1> vao_;
+  glpp::ring_buffer instances_;
+  std::vector<std::uint32_t> levels_;
+  std::vector<gpu_instance> staged_;
+  size_t drawn_triangle_count_;
+  size_t draw_call_count_;
+};
+
+}
@@ -0,0 +1,412 @@
+#include "cdlod.h"
+#include "culling.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ds {
+
+namespace {
+
+/**
+ * How far the surface may stray from the samples taken for the bounds,
+ * relative to the size of the patch. Each cut crossing a patch makes a step
+ * of twice its amount; this is enough for the few hundred cuts of a planet.
+ */
+const float SURFACE_SLOPE = 0.25f;
+
+/**
+ * Bounds get computed again past that many nodes, so that memory doesn't
+ * grow forever as the camera moves around.
+ */
+const size_t MAX_CACHED_BOUNDS = 1 << 18;
+
+const size_t FACE_BITS = 5;
+const size_t LEVEL_BITS = 5;
+
+std::uint64_t get_path(std::uint64_t key) {
+  return key >> (FACE_BITS + LEVEL_BITS);
+}
+
+geodesic::vec3 get_middle(const geodesic::vec3& a, const geodesic::vec3& b) {
+  return {(a.x + b.x) / 2, (a.y + b.y) / 2, (a.z + b.z) / 2};
+}
+
+/**
+ * Point of the unit sphere at barycentric coordinates `weights` of
+ * base face `face`.
+ */
+glm::vec3 get_direction(unsigned face, const geodesic::vec3& weights) {
+  const auto& corners = geodesic::BASE.faces[face];
+  auto result = geodesic::interpolate(
+    geodesic::BASE.corners[corners[0]], weights.x,
+    geodesic::BASE.corners[corners[1]], weights.y,
+    geodesic::BASE.corners[corners[2]], weights.z
+  );
+  return glm::vec3(
+    static_cast<float>(result.x),
+    static_cast<float>(result.y),
+    static_cast<float>(result.z)
+  );
+}
+
+/**
+ * Triangles of a patch grid of `frequency` subdivisions, laid out as the
+ * vertices of `get_cdlod_patch_vertex()`.
+ */
+std::vector<std::uint16_t> get_patch_indices(size_t frequency) {
+  std::vector<std::uint16_t> result;
+  result.reserve(frequency * frequency * 3);
+  auto add = [&result](size_t a, size_t b, size_t c) {
+    result.push_back(static_cast<std::uint16_t>(a));
+    result.push_back(static_cast<std::uint16_t>(b));
+    result.push_back(static_cast<std::uint16_t>(c));
+  };
+  for (size_t i = 0; i < frequency; ++i) {
+    for (size_t j = 0; j <= i; ++j) {
+      add(
+        get_cdlod_patch_vertex(i, j),
+        get_cdlod_patch_vertex(i + 1, j),
+        get_cdlod_patch_vertex(i + 1, j + 1)
+      );
+      if (j < i) {
+        add(
+          get_cdlod_patch_vertex(i, j),
+          get_cdlod_patch_vertex(i + 1, j + 1),
+          get_cdlod_patch_vertex(i, j + 1)
+        );
+      }
+    }
+  }
+  return result;
+}
+
+/**
+ * Patches get carved with one more ring of vertices all around, so that the
+ * normals of their edges see the triangles of the neighbouring patches too.
+ * Vertex `(i, j)` of the patch is vertex `(i + 2, j + 1)` of that larger
+ * grid, whose corners stick out of the patch by two steps along each edge.
+ */
+const size_t BORDERED_FREQUENCY = CDLOD_PATCH_FREQUENCY + 3;
+const size_t BORDERED_VERTEX_COUNT =
+  (BORDERED_FREQUENCY + 1) * (BORDERED_FREQUENCY + 2) / 2;
+
+size_t get_bordered_vertex(size_t i, size_t j) {
+  return get_cdlod_patch_vertex(i + 2, j + 1);
+}
+
+/**
+ * Area-weighted average of the normals of the triangles around each vertex,
+ * see `compute_normals()`.
+ */
+void set_area_weighted_normals(
+  const std::vector<std::uint16_t>& indices,
+  std::vector<vertex>& vertices
+) {
+  for (auto& vertex: vertices) {
+    vertex.normal = glm::vec3();
+  }
+  for (size_t t = 0; t < indices.size(); t += 3) {
+    auto& a = vertices[indices[t]];
+    auto& b = vertices[indices[t + 1]];
+    auto& c = vertices[indices[t + 2]];
+    // Twice the area of the triangle.
+    auto normal =
+      glm::cross(b.position - a.position, c.position - a.position);
+    a.normal += normal;
+    b.normal += normal;
+    c.normal += normal;
+  }
+  for (auto& vertex: vertices) {
+    auto length = glm::length(vertex.normal);
+    if (length > 0) {
+      vertex.normal /= length;
+    } else {
+      vertex.normal = glm::normalize(vertex.position);
+    }
+  }
+}
+
+}
+
+std::uint64_t get_cdlod_key(
+  unsigned face,
+  unsigned level,
+  std::uint64_t path
+) {
+  return face |
+    static_cast<std::uint64_t>(level) << FACE_BITS |
+    path << (FACE_BITS + LEVEL_BITS);
+}
+
+std::uint64_t get_cdlod_ancestor_key(const cdlod_node& node, unsigned level) {
+  auto mask = (static_cast<std::uint64_t>(1) << (level * 2)) - 1;
+  return get_cdlod_key(node.face, level, get_path(node.key) & mask);
+}
+
+std::vector<std::uint16_t> get_cdlod_patch_indices() {
+  return get_patch_indices(CDLOD_PATCH_FREQUENCY);
+}
+
+cdlod_quadtree::cdlod_quadtree(const planet& planet, size_t max_level):
+  planet_(planet),
+  max_level_(std::min(max_level, CDLOD_MAX_LEVEL)),
+  bordered_indices_(get_patch_indices(BORDERED_FREQUENCY)),
+  scratch_(SCRATCH_BLOCK_SIZE) {
+  for (unsigned face = 0; face < geodesic::FACE_COUNT; ++face) {
+    auto& root = roots_[face];
+    root.key = get_cdlod_key(face, 0, 0);
+    root.face = face;
+    root.level = 0;
+    root.corners[0] = {1, 0, 0};
+    root.corners[1] = {0, 1, 0};
+    root.corners[2] = {0, 0, 1};
+    set_bounds_(root);
+  }
+}
+
+/**
+ * Children keep the winding of their parent: three of them at its corners,
+ * the last one made of the middles of its edges.
+ */
+cdlod_node cdlod_quadtree::get_child(
+  const cdlod_node& node,
+  unsigned child
+) {
+  const auto& a = node.corners[0];
+  const auto& b = node.corners[1];
+  const auto& c = node.corners[2];
+  auto ab = get_middle(a, b);
+  auto bc = get_middle(b, c);
+  auto ca = get_middle(c, a);
+  cdlod_node result;
+  result.face = node.face;
+  result.level = node.level + 1;
+  result.key = get_cdlod_key(
+    node.face,
+    result.level,
+    get_path(node.key) | static_cast<std::uint64_t>(child) << (node.level * 2)
+  );
+  switch (child) {
+    case 0:
+      result.corners[0] = a, result.corners[1] = ab, result.corners[2] = ca;
+      break;
+    case 1:
+      result.corners[0] = ab, result.corners[1] = b, result.corners[2] = bc;
+      break;
+    case 2:
+      result.corners[0] = ca, result.corners[1] = bc, result.corners[2] = c;
+      break;
+    default:
+      result.corners[0] = bc, result.corners[1] = ca, result.corners[2] = ab;
+      break;
+  }
+  set_bounds_(result);
+  return result;
+}
+
+/**
+ * Sample the surface at the corners, the middle of the edges and the center
+ * of the patch, and bound these with a margin for what happens in between.
+ */
+void cdlod_quadtree::set_bounds_(cdlod_node& node) {
+  auto found = bounds_.find(node.key);
+  if (found != bounds_.end()) {
+    node.center = found->second.center;
+    node.radius = found->second.radius;
+    return;
+  }
+  const auto& a = node.corners[0];
+  const auto& b = node.corners[1];
+  const auto& c = node.corners[2];
+  const double third = 1.0 / 3;
+  const geodesic::vec3 weights[] = {
+    a, b, c, get_middle(a, b), get_middle(b, c), get_middle(c, a),
+    {
+      (a.x + b.x + c.x) * third,
+      (a.y + b.y + c.y) * third,
+      (a.z + b.z + c.z) * third,
+    },
+  };
+  std::vector<vertex> samples(sizeof(weights) / sizeof(weights[0]));
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i].position = get_direction(node.face, weights[i]);
+  }
+  std::vector<float> altitudes;
+  displace_to_surface(planet_, samples, altitudes, scratch_);
+
+  glm::vec3 center;
+  for (const auto& sample: samples) {
+    center += sample.position;
+  }
+  center /= static_cast<float>(samples.size());
+  float radius = 0;
+  for (const auto& sample: samples) {
+    radius = std::max(radius, glm::distance(sample.position, center));
+  }
+  auto edge = glm::distance(
+    get_direction(node.face, a),
+    get_direction(node.face, b)
+  );
+  node.center = center;
+  node.radius = radius + edge * SURFACE_SLOPE;
+
+  if (bounds_.size() >= MAX_CACHED_BOUNDS) {
+    bounds_.clear();
+  }
+  bounds_[node.key] = {node.center, node.radius};
+}
+
+void cdlod_quadtree::gen_patch(
+  const cdlod_node& node,
+  std::vector<cdlod_vertex>& vertices
+) {
+  DS_TRACE_ZONE("cdlod_gen_patch");
+  const auto n = CDLOD_PATCH_FREQUENCY;
+  const auto f = static_cast<double>(n);
+  const auto& a = node.corners[0];
+  const auto& b = node.corners[1];
+  const auto& c = node.corners[2];
+  // The border has negative weights. Being dyadic as well, the vertices it
+  // shares with the neighbouring patches of the same face and level come
+  // out exactly the same.
+  std::vector<vertex> surface(BORDERED_VERTEX_COUNT);
+  for (size_t bi = 0; bi <= BORDERED_FREQUENCY; ++bi) {
+    for (size_t bj = 0; bj <= bi; ++bj) {
+      auto i = static_cast<double>(bi) - 2;
+      auto j = static_cast<double>(bj) - 1;
+      auto wa = (f - i) / f;
+      auto wb = (i - j) / f;
+      auto wc = j / f;
+      auto direction = get_direction(node.face, {
+        a.x * wa + b.x * wb + c.x * wc,
+        a.y * wa + b.y * wb + c.y * wc,
+        a.z * wa + b.z * wb + c.z * wc,
+      });
+      surface[get_cdlod_patch_vertex(bi, bj)].position = direction;
+    }
+  }
+  std::vector<float> altitudes;
+  displace_to_surface(planet_, surface, altitudes, scratch_);
+  set_area_weighted_normals(bordered_indices_, surface);
+
+  vertices.resize(CDLOD_PATCH_VERTEX_COUNT);
+  for (size_t i = 0; i <= n; ++i) {
+    for (size_t j = 0; j <= i; ++j) {
+      auto ix = get_bordered_vertex(i, j);
+      auto& result = vertices[get_cdlod_patch_vertex(i, j)];
+      result.position = surface[ix].position;
+      result.normal = surface[ix].normal;
+      result.altitude = altitudes[ix];
+      // Vertices at odd coordinates are in the middle of an edge of the
+      // parent grid, that goes along the axis they are odd on.
+      auto di = i % 2, dj = j % 2;
+      result.coarse_position = (
+        surface[get_bordered_vertex(i - di, j - dj)].position +
+        surface[get_bordered_vertex(i + di, j + dj)].position
+      ) * 0.5f;
+    }
+  }
+}
+
+void cdlod_quadtree::select(
+  const glm::vec3& camera,
+  const glm::mat4& model_view_projection,
+  float fovy,
+  float viewport_height,
+  float pixel_error,
+  std::vector<cdlod_selection>& result
+) {
+  DS_TRACE_ZONE("cdlod_select");
+  result.clear();
+  auto frustum = culling::get_frustum(model_view_projection);
+
+  // `ranges[level]` is the distance under which a level is used at all,
+  // that is where the spacing of its parent gets too large on screen.
+  auto pixels_per_unit = viewport_height / (2 * std::tan(fovy / 2));
+  auto base_edge = static_cast<float>(glm::distance(
+    get_direction(0, {1, 0, 0}),
+    get_direction(0, {0, 1, 0})
+  ));
+  float ranges[CDLOD_MAX_LEVEL + 2];
+  ranges[0] = std::numeric_limits<float>::max();
+  auto spacing = base_edge / CDLOD_PATCH_FREQUENCY;
+  for (size_t level = 1; level <= max_level_; ++level) {
+    ranges[level] = spacing * pixels_per_unit / pixel_error;
+    spacing /= 2;
+  }
+  ranges[max_level_ + 1] = 0;
+
+  for (const auto& root: roots_) {
+    select_(root, camera, frustum, ranges, result);
+  }
+}
+
+/**
+ * Return `false` if the node is entirely out of the range of its level, in
+ * which case the caller takes care of the area.
+ */
+bool cdlod_quadtree::select_(
+  const cdlod_node& node,
+  const glm::vec3& camera,
+  const culling::frustum& frustum,
+  const float* ranges,
+  std::vector<cdlod_selection>& result
+) {
+  auto distance = glm::distance(camera, node.center) - node.radius;
+  if (distance >= ranges[node.level]) {
+    return false;
+  }
+  if (
+    culling::is_outside_frustum(frustum, node.center, node.radius) ||
+    culling::is_below_horizon(
+      camera,
+      planet_.ocean_altitude,
+      node.center,
+      node.radius
+    )
+  ) {
+    return true;
+  }
+  if (node.level == max_level_ || distance >= ranges[node.level + 1]) {
+    add_(node, camera, frustum, ranges, result);
+    return true;
+  }
+  for (unsigned k = 0; k < 4; ++k) {
+    auto child = get_child(node, k);
+    if (!select_(child, camera, frustum, ranges, result)) {
+      // The child is fully morphed into this level over its whole area.
+      add_(child, camera, frustum, ranges, result);
+    }
+  }
+  return true;
+}
+
+void cdlod_quadtree::add_(
+  const cdlod_node& node,
+  const glm::vec3& camera,
+  const culling::frustum& frustum,
+  const float* ranges,
+  std::vector<cdlod_selection>& result
+) const {
+  if (
+    culling::is_outside_frustum(frustum, node.center, node.radius) ||
+    culling::is_below_horizon(
+      camera,
+      planet_.ocean_altitude,
+      node.center,
+      node.radius
+    )
+  ) {
+    return;
+  }
+  auto range = ranges[node.level];
+  result.push_back({
+    .node = node,
+    .morph_start = range * CDLOD_MORPH_START,
+    .morph_end = range,
+  });
+}
+
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include "culling.h"
+#include "geodesic.h"
+#include "planet.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Continuous distance-dependent level of detail (CDLOD) for the planet
+ * surface. Each of the 20 faces of the icosahedron is the root of a quadtree
+ * of triangular patches, each child covering a quarter of its parent. All the
+ * patches are the same grid of `CDLOD_PATCH_FREQUENCY` subdivisions, so
+ * deeper patches have smaller triangles, and they share a single index
+ * buffer.
+ *
+ * Every level is used up to a distance from the camera where its grid
+ * spacing would still be seen larger than the allowed screen-space error,
+ * and these ranges double from one level to its parent. Over the last part
+ * of its range, a patch morphs into the grid of its parent, so that there is
+ * no popping when switching levels nor cracks between patches of
+ * neighbouring levels.
+ */
+const size_t CDLOD_PATCH_FREQUENCY = 16;
+const size_t CDLOD_PATCH_VERTEX_COUNT =
+  (CDLOD_PATCH_FREQUENCY + 1) * (CDLOD_PATCH_FREQUENCY + 2) / 2;
+const size_t CDLOD_PATCH_TRIANGLE_COUNT =
+  CDLOD_PATCH_FREQUENCY * CDLOD_PATCH_FREQUENCY;
+
+/**
+ * The path of a node is packed with 2 bits per level, hence the limit.
+ */
+const size_t CDLOD_MAX_LEVEL = 24;
+
+/**
+ * Fraction of the range of a level after which patches start morphing into
+ * their parent.
+ */
+const float CDLOD_MORPH_START = 0.7f;
+
+struct cdlod_node {
+  /**
+   * Unique across all the quadtrees, see `get_cdlod_key()`.
+   */
+  std::uint64_t key;
+  unsigned face;
+  unsigned level;
+  /**
+   * Barycentric coordinates of the corners of the patch within its base
+   * face, in the same order as the face corners. Being dyadic fractions,
+   * they are exact, so that patches sharing an edge have the exact same
+   * vertices along it.
+   */
+  geodesic::vec3 corners[3];
+  /**
+   * Bounding sphere of the displaced patch, in model space.
+   */
+  glm::vec3 center;
+  float radius;
+};
+
+struct cdlod_vertex {
+  glm::vec3 position;
+  /**
+   * Where the vertex lies on the grid of the parent patch, that it morphs
+   * into. Same as `position` for the vertices the parent has as well.
+   */
+  glm::vec3 coarse_position;
+  glm::vec3 normal;
+  /**
+   * Distance from the center before clamping to the ocean level, that the
+   * color gets looked up from, see `palette`.
+   */
+  float altitude;
+};
+
+struct cdlod_selection {
+  cdlod_node node;
+  /**
+   * Distances from the camera between which the patch morphs into its
+   * parent, in model space.
+   */
+  float morph_start;
+  float morph_end;
+};
+
+/**
+ * Vertex `(i, j)` of a patch, with `0 <= j <= i <= CDLOD_PATCH_FREQUENCY`,
+ * is laid out the same way as the face vertices of `geodesic::build()`.
+ */
+constexpr size_t get_cdlod_patch_vertex(size_t i, size_t j) {
+  return i * (i + 1) / 2 + j;
+}
+
+/**
+ * Pack the base face, the level and the path of a node, that is the child
+ * taken at each level from the root, 2 bits per level.
+ */
+std::uint64_t get_cdlod_key(unsigned face, unsigned level, std::uint64_t path);
+
+/**
+ * Key of the ancestor of `node` at `level`, that must not be deeper.
+ */
+std::uint64_t get_cdlod_ancestor_key(const cdlod_node& node, unsigned level);
+
+/**
+ * Triangles of any patch, indexing its vertices.
+ */
+std::vector<std::uint16_t> get_cdlod_patch_indices();
+
+class cdlod_quadtree {
+public:
+  /**
+   * `max_level` is clamped to `CDLOD_MAX_LEVEL`.
+   */
+  cdlod_quadtree(const planet& planet, size_t max_level);
+
+  size_t max_level() const {
+    return max_level_;
+  }
+
+  const cdlod_node& get_root(size_t face) const {
+    return roots_[face];
+  }
+
+  cdlod_node get_child(const cdlod_node& node, unsigned child);
+
+  /**
+   * Displaced vertices of the patch, `CDLOD_PATCH_VERTEX_COUNT` of them.
+   * Normals are area-weighted over the terrain, including the triangles of
+   * the neighbouring patches along the edges.
+   */
+  void gen_patch(
+    const cdlod_node& node,
+    std::vector<cdlod_vertex>& vertices
+  );
+
+  /**
+   * Select the patches to draw for a camera at `camera`, in model space,
+   * that gets clip coordinates with `model_view_projection`. A level is
+   * refined as long as its grid spacing would be projected larger than
+   * `pixel_error` on a viewport `viewport_height` pixels high, with a
+   * vertical field of view of `fovy` radians. Patches outside of the frustum
+   * or hidden below the horizon are skipped. The result is cleared first.
+   */
+  void select(
+    const glm::vec3& camera,
+    const glm::mat4& model_view_projection,
+    float fovy,
+    float viewport_height,
+    float pixel_error,
+    std::vector<cdlod_selection>& result
+  );
+
+private:
+  struct bounds {
+    glm::vec3 center;
+    float radius;
+  };
+
+  void set_bounds_(cdlod_node& node);
+  bool select_(
+    const cdlod_node& node,
+    const glm::vec3& camera,
+    const culling::frustum& frustum,
+    const float* ranges,
+    std::vector<cdlod_selection>& result
+  );
+  void add_(
+    const cdlod_node& node,
+    const glm::vec3& camera,
+    const culling::frustum& frustum,
+    const float* ranges,
+    std::vector<cdlod_selection>& result
+  ) const;
+
+  const planet& planet_;
+  size_t max_level_;
+  cdlod_node roots_[geodesic::FACE_COUNT];
+  /**
+   * Computing bounds involves carving the terrain, so they are kept around
+   * for the next frames.
+   */
+  std::unordered_map<std::uint64_t, bounds> bounds_;
+  /**
+   * Triangles of the patch grid along with its border, see `gen_patch()`.
+   */
+  std::vector<std::uint16_t> bordered_indices_;
+  /**
+   * For the terrain kernels, reused from patch to patch.
+   */
+  scratch_arena scratch_;
+};
+
+}
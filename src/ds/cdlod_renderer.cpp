@@ -0,0 +1,265 @@
+#include "cdlod_renderer.h"
+#include "palette.h"
+#include "trace.h"
+#include <cstddef>
+#include <glm/gtc/type_ptr.hpp>
+#include <limits>
+#include <stdexcept>
+
+namespace ds {
+
+namespace {
+
+const size_t NO_SLOT = std::numeric_limits<size_t>::max();
+
+void set_attrib_pointer(
+  glpp::program& program,
+  const char* name,
+  GLint size,
+  size_t offset
+) {
+  GLint location = program.get_attrib_location(name);
+  glVertexAttribPointer(
+    location,
+    size,
+    GL_FLOAT,
+    GL_FALSE,
+    sizeof(cdlod_vertex),
+    reinterpret_cast<void*>(offset)
+  );
+  glEnableVertexAttribArray(location);
+}
+
+}
+
+cdlod_renderer::cdlod_renderer(
+  const planet& planet,
+  glpp::program& program,
+  size_t max_level,
+  size_t capacity
+):
+  quadtree_(planet, max_level),
+  program_(program),
+  ocean_altitude_(planet.ocean_altitude),
+  camera_uniform_(program.get_uniform_location("Camera")),
+  morph_range_uniform_(program.get_uniform_location("MorphRange")),
+  ocean_altitude_uniform_(program.get_uniform_location("OceanAltitude")),
+  palette_uniform_(program.get_uniform_location("Palette")),
+  palette_range_uniform_(program.get_uniform_location("PaletteRange")),
+  slots_(capacity, {0, 0, 0, false}),
+  frame_(0),
+  generated_patch_count_(0) {
+  if (capacity < geodesic::FACE_COUNT) {
+    throw std::runtime_error("the LOD patch capacity must fit the roots");
+  }
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glpp::state::bind_buffer(GL_ARRAY_BUFFER, buffers_.handles()[0]);
+  glBufferData(
+    GL_ARRAY_BUFFER,
+    capacity * CDLOD_PATCH_VERTEX_COUNT * sizeof(cdlod_vertex),
+    nullptr,
+    GL_DYNAMIC_DRAW
+  );
+  set_attrib_pointer(
+    program,
+    "position",
+    3,
+    offsetof(cdlod_vertex, position)
+  );
+  set_attrib_pointer(
+    program,
+    "coarse_position",
+    3,
+    offsetof(cdlod_vertex, coarse_position)
+  );
+  set_attrib_pointer(program, "normal", 3, offsetof(cdlod_vertex, normal));
+  set_attrib_pointer(
+    program,
+    "altitude",
+    1,
+    offsetof(cdlod_vertex, altitude)
+  );
+
+  auto indices = get_cdlod_patch_indices();
+  glpp::state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, buffers_.handles()[1]);
+  glBufferData(
+    GL_ELEMENT_ARRAY_BUFFER,
+    indices.size() * sizeof(indices[0]),
+    indices.data(),
+    GL_STATIC_DRAW
+  );
+
+  glpp::state::bind_texture(GL_TEXTURE_2D, palette_.handles()[0]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  {
+    DS_TRACE_ZONE("upload_palette");
+    auto palette = get_planet_palette(ocean_altitude_);
+    glTexImage2D(
+      GL_TEXTURE_2D,
+      0,
+      GL_RGBA8,
+      PALETTE_ALTITUDE_SIZE,
+      PALETTE_LATITUDE_SIZE,
+      0,
+      GL_RGBA,
+      GL_UNSIGNED_BYTE,
+      palette.texels.data()
+    );
+  }
+
+  // The roots take the first slots, that never get recycled.
+  for (size_t face = 0; face < geodesic::FACE_COUNT; ++face) {
+    const auto& root = quadtree_.get_root(face);
+    upload_(acquire_slot_(root.key), root);
+  }
+}
+
+void cdlod_renderer::update(
+  const glm::vec3& camera,
+  const glm::mat4& model_view_projection,
+  float fovy,
+  float viewport_height,
+  float pixel_error
+) {
+  DS_TRACE_ZONE("cdlod_update");
+  ++frame_;
+  camera_ = camera;
+  quadtree_.select(
+    camera,
+    model_view_projection,
+    fovy,
+    viewport_height,
+    pixel_error,
+    selection_
+  );
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glpp::state::bind_buffer(GL_ARRAY_BUFFER, buffers_.handles()[0]);
+  drawn_.clear();
+  size_t budget = GENERATION_BUDGET;
+  for (const auto& selected: selection_) {
+    const auto& node = selected.node;
+    auto found = slot_by_key_.find(node.key);
+    auto slot = found == slot_by_key_.end() ? NO_SLOT : found->second;
+    if (slot == NO_SLOT && budget > 0) {
+      slot = acquire_slot_(node.key);
+      if (slot != NO_SLOT) {
+        upload_(slot, node);
+        --budget;
+      }
+    }
+    if (slot == NO_SLOT) {
+      add_ancestor_(node);
+      continue;
+    }
+    add_draw_item_(slot, selected.morph_start, selected.morph_end);
+  }
+}
+
+void cdlod_renderer::draw() {
+  DS_TRACE_ZONE("cdlod_draw");
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  program_.use();
+  program_.uniform_3fv(camera_uniform_, glm::value_ptr(camera_));
+  program_.uniform_1f(ocean_altitude_uniform_, ocean_altitude_);
+  program_.uniform_2f(
+    palette_range_uniform_,
+    ocean_altitude_ + PALETTE_MIN_ALTITUDE,
+    ocean_altitude_ + PALETTE_MAX_ALTITUDE
+  );
+  glpp::state::active_texture(GL_TEXTURE0);
+  glpp::state::bind_texture(GL_TEXTURE_2D, palette_.handles()[0]);
+  program_.uniform_1i(palette_uniform_, 0);
+  for (const auto& item: drawn_) {
+    program_.uniform_2f(
+      morph_range_uniform_,
+      item.morph_start,
+      item.morph_end
+    );
+    glDrawElementsBaseVertex(
+      GL_TRIANGLES,
+      CDLOD_PATCH_TRIANGLE_COUNT * 3,
+      GL_UNSIGNED_SHORT,
+      nullptr,
+      item.slot * CDLOD_PATCH_VERTEX_COUNT
+    );
+  }
+}
+
+/**
+ * Take a free slot or else the least recently used one, provided it wasn't
+ * used by the current frame.
+ */
+size_t cdlod_renderer::acquire_slot_(std::uint64_t key) {
+  auto result = NO_SLOT;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    const auto& slot = slots_[i];
+    if (!slot.used) {
+      result = i;
+      break;
+    }
+    if (i < geodesic::FACE_COUNT || slot.last_used_frame == frame_) {
+      continue;
+    }
+    if (
+      result == NO_SLOT ||
+      slot.last_used_frame < slots_[result].last_used_frame
+    ) {
+      result = i;
+    }
+  }
+  if (result == NO_SLOT) {
+    return result;
+  }
+  auto& slot = slots_[result];
+  if (slot.used) {
+    slot_by_key_.erase(slot.key);
+  }
+  slot = {key, frame_, 0, true};
+  slot_by_key_[key] = result;
+  return result;
+}
+
+void cdlod_renderer::upload_(size_t slot, const cdlod_node& node) {
+  quadtree_.gen_patch(node, patch_);
+  glBufferSubData(
+    GL_ARRAY_BUFFER,
+    slot * CDLOD_PATCH_VERTEX_COUNT * sizeof(cdlod_vertex),
+    patch_.size() * sizeof(cdlod_vertex),
+    patch_.data()
+  );
+  ++generated_patch_count_;
+}
+
+void cdlod_renderer::add_draw_item_(
+  size_t slot,
+  float morph_start,
+  float morph_end
+) {
+  auto& entry = slots_[slot];
+  entry.last_used_frame = frame_;
+  if (entry.drawn_frame == frame_) {
+    return;
+  }
+  entry.drawn_frame = frame_;
+  drawn_.push_back({slot, morph_start, morph_end});
+}
+
+/**
+ * Stand-ins are drawn without morphing, as they are only there for the few
+ * frames it takes to generate the actual patches.
+ */
+void cdlod_renderer::add_ancestor_(const cdlod_node& node) {
+  const auto no_morph = std::numeric_limits<float>::max();
+  for (auto level = node.level; level-- > 0;) {
+    auto found = slot_by_key_.find(get_cdlod_ancestor_key(node, level));
+    if (found != slot_by_key_.end()) {
+      add_draw_item_(found->second, no_morph / 2, no_morph);
+      return;
+    }
+  }
+}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "../glpp/buffers.h"
+#include "../glpp/program.h"
+#include "../glpp/textures.h"
+#include "../glpp/vertex_arrays.h"
+#include "cdlod.h"
+#include <unordered_map>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Draw the planet with a `cdlod_quadtree`. Patches are generated on demand
+ * and kept in a fixed number of slots of a single vertex buffer, the least
+ * recently used ones being recycled. As generating a patch takes a while,
+ * only a few of them are generated each frame. Until then, missing patches
+ * are replaced by their closest ancestor that is available; the roots always
+ * are. Vertices get their color from the palette of the planet on the GPU,
+ * as with `meshlet_renderer`.
+ *
+ * The program must have the attributes and uniforms of `lod.vs`.
+ */
+class cdlod_renderer {
+public:
+  cdlod_renderer(
+    const planet& planet,
+    glpp::program& program,
+    size_t max_level,
+    size_t capacity
+  );
+  cdlod_renderer(cdlod_renderer&) = delete;
+
+  /**
+   * Select the patches for the current frame, see `cdlod_quadtree::select`,
+   * and generate missing ones within the budget.
+   */
+  void update(
+    const glm::vec3& camera,
+    const glm::mat4& model_view_projection,
+    float fovy,
+    float viewport_height,
+    float pixel_error
+  );
+
+  /**
+   * Draw the patches of the last update, with the program.
+   */
+  void draw();
+
+  size_t drawn_patch_count() const {
+    return drawn_.size();
+  }
+
+  size_t drawn_triangle_count() const {
+    return drawn_.size() * CDLOD_PATCH_TRIANGLE_COUNT;
+  }
+
+  /**
+   * Patches generated since construction, including the roots.
+   */
+  size_t generated_patch_count() const {
+    return generated_patch_count_;
+  }
+
+private:
+  /**
+   * Patches generated at most per frame, beyond the roots.
+   */
+  static const size_t GENERATION_BUDGET = 32;
+
+  struct slot {
+    std::uint64_t key;
+    size_t last_used_frame;
+    size_t drawn_frame;
+    bool used;
+  };
+
+  struct draw_item {
+    size_t slot;
+    float morph_start;
+    float morph_end;
+  };
+
+  size_t acquire_slot_(std::uint64_t key);
+  void upload_(size_t slot, const cdlod_node& node);
+  void add_draw_item_(size_t slot, float morph_start, float morph_end);
+  void add_ancestor_(const cdlod_node& node);
+
+  cdlod_quadtree quadtree_;
+  glpp::program& program_;
+  glpp::vertex_arrays<1> vao_;
+  glpp::buffers<2> buffers_;
+  glpp::textures<1> palette_;
+  float ocean_altitude_;
+  GLint camera_uniform_;
+  GLint morph_range_uniform_;
+  GLint ocean_altitude_uniform_;
+  GLint palette_uniform_;
+  GLint palette_range_uniform_;
+  std::vector<slot> slots_;
+  std::unordered_map<std::uint64_t, size_t> slot_by_key_;
+  std::vector<cdlod_selection> selection_;
+  std::vector<draw_item> drawn_;
+  std::vector<cdlod_vertex> patch_;
+  glm::vec3 camera_;
+  size_t frame_;
+  size_t generated_patch_count_;
+};
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace ds {
+
+/**
+ * 64-bit FNV-1a, for cache files to catch corruption and stale keys. It's
+ * not meant to resist tampering.
+ */
+class checksum {
+public:
+  checksum(): hash_(14695981039346656037ull) {}
+
+  void add(const void* data, size_t size) {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * 1099511628211ull;
+    }
+  }
+
+  std::uint64_t get() const {
+    return hash_;
+  }
+
+private:
+  std::uint64_t hash_;
+};
+
+}
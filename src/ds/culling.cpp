@@ -0,0 +1,85 @@
+#include "culling.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ds {
+namespace culling {
+
+frustum get_frustum(const glm::mat4& mvp) {
+  frustum result;
+  for (int i = 0; i < 3; ++i) {
+    for (int side = 0; side < 2; ++side) {
+      auto sign = side == 0 ? 1.0f : -1.0f;
+      glm::vec4 plane(
+        mvp[0][3] + sign * mvp[0][i],
+        mvp[1][3] + sign * mvp[1][i],
+        mvp[2][3] + sign * mvp[2][i],
+        mvp[3][3] + sign * mvp[3][i]
+      );
+      auto length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+      result.planes[i * 2 + side] = plane * (1 / length);
+    }
+  }
+  return result;
+}
+
+bool is_outside_frustum(
+  const frustum& frustum,
+  const glm::vec3& center,
+  float radius
+) {
+  for (const auto& plane: frustum.planes) {
+    auto distance =
+      glm::dot(glm::vec3(plane.x, plane.y, plane.z), center) + plane.w;
+    if (distance < -radius) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool is_below_horizon(
+  const glm::vec3& camera,
+  float occluder,
+  const glm::vec3& center,
+  float radius
+) {
+  auto camera_distance = glm::length(camera);
+  auto to_center = center - camera;
+  auto center_distance = glm::length(to_center);
+  if (camera_distance <= occluder || center_distance <= radius) {
+    return false;
+  }
+  auto up = camera * (1 / camera_distance);
+  if (
+    glm::dot(center, up) + radius >
+    occluder * occluder / camera_distance
+  ) {
+    return false;
+  }
+  auto cos_angle = -glm::dot(to_center, up) / center_distance;
+  auto angle = std::acos(std::min(std::max(cos_angle, -1.0f), 1.0f));
+  return
+    angle + std::asin(radius / center_distance) <=
+    std::asin(occluder / camera_distance);
+}
+
+/**
+ * Backfacing from every point of the sphere, see "Optimizing the Graphics
+ * Pipeline with Compute" (Wihlidal) for the derivation.
+ */
+bool is_backfacing(
+  const glm::vec3& camera,
+  const glm::vec3& center,
+  float radius,
+  const glm::vec3& cone_axis,
+  float cone_cutoff
+) {
+  auto to_center = center - camera;
+  return
+    glm::dot(to_center, cone_axis) >=
+    cone_cutoff * glm::length(to_center) + radius;
+}
+
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace ds {
+
+/**
+ * Conservative visibility tests of bounding spheres, all in the same space
+ * as `camera`, usually model space. They only return `true` when the whole
+ * sphere is certainly invisible.
+ */
+namespace culling {
+
+struct frustum {
+  /**
+   * Planes with normals of unit length pointing inwards.
+   */
+  glm::vec4 planes[6];
+};
+
+/**
+ * Frustum in the space `model_view_projection` transforms from.
+ */
+frustum get_frustum(const glm::mat4& model_view_projection);
+
+bool is_outside_frustum(
+  const frustum& frustum,
+  const glm::vec3& center,
+  float radius
+);
+
+/**
+ * Whether the sphere is entirely hidden by a sphere of radius `occluder`
+ * centered on the origin, that is within the cone of its shadow and beyond
+ * the plane of the horizon.
+ */
+bool is_below_horizon(
+  const glm::vec3& camera,
+  float occluder,
+  const glm::vec3& center,
+  float radius
+);
+
+/**
+ * Whether all the triangles whose normals are within a cone are facing away
+ * from the camera. `cone_cutoff` is the sine of the angle of the cone, or 1
+ * if it's wider than 90 degrees, in which case this is always false.
+ */
+bool is_backfacing(
+  const glm::vec3& camera,
+  const glm::vec3& center,
+  float radius,
+  const glm::vec3& cone_axis,
+  float cone_cutoff
+);
+
+}
+
+}
@@ -0,0 +1,117 @@
+#include "dynamic_resolution.h"
+#include "system_error.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ds {
+
+dynamic_resolution::dynamic_resolution(
+  int width,
+  int height,
+  double target_time,
+  float min_scale
+):
+  width_(width),
+  height_(height),
+  frame_width_(width),
+  frame_height_(height),
+  scaler_(target_time, min_scale, 1),
+  min_used_scale_(1),
+  pending_(),
+  next_(0),
+  dropped_count_(0) {
+  update_frame_size_();
+  auto color = renderbuffers_.handles()[0];
+  auto depth = renderbuffers_.handles()[1];
+  glBindRenderbuffer(GL_RENDERBUFFER, color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.handles()[0]);
+  glFramebufferRenderbuffer(
+    GL_FRAMEBUFFER,
+    GL_COLOR_ATTACHMENT0,
+    GL_RENDERBUFFER,
+    color
+  );
+  glFramebufferRenderbuffer(
+    GL_FRAMEBUFFER,
+    GL_DEPTH_ATTACHMENT,
+    GL_RENDERBUFFER,
+    depth
+  );
+  auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    throw system_error("the driver doesn't support the offscreen framebuffer");
+  }
+}
+
+void dynamic_resolution::begin_frame() {
+  min_used_scale_ = std::min(min_used_scale_, scaler_.scale());
+  if (pending_[next_] && !collect_(next_)) {
+    ++dropped_count_;
+    pending_[next_] = false;
+  }
+  glQueryCounter(queries_.handles()[next_ * 2], GL_TIMESTAMP);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.handles()[0]);
+  glViewport(0, 0, frame_width_, frame_height_);
+}
+
+void dynamic_resolution::end_frame() {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_.handles()[0]);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glBlitFramebuffer(
+    0,
+    0,
+    frame_width_,
+    frame_height_,
+    0,
+    0,
+    width_,
+    height_,
+    GL_COLOR_BUFFER_BIT,
+    GL_LINEAR
+  );
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, width_, height_);
+  glQueryCounter(queries_.handles()[next_ * 2 + 1], GL_TIMESTAMP);
+  pending_[next_] = true;
+  next_ = (next_ + 1) % RING_SIZE;
+}
+
+void dynamic_resolution::poll() {
+  // Oldest first, so that the scaler gets the times in order.
+  for (size_t i = 0; i < RING_SIZE; ++i) {
+    auto index = (next_ + i) % RING_SIZE;
+    if (pending_[index] && !collect_(index)) {
+      break;
+    }
+  }
+  update_frame_size_();
+}
+
+void dynamic_resolution::update_frame_size_() {
+  auto scale = scaler_.scale();
+  frame_width_ = std::max(1, static_cast<int>(std::lround(width_ * scale)));
+  frame_height_ = std::max(1, static_cast<int>(std::lround(height_ * scale)));
+}
+
+bool dynamic_resolution::collect_(size_t index) {
+  auto end = queries_.handles()[index * 2 + 1];
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(end, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return false;
+  }
+  auto start = queries_.handles()[index * 2];
+  GLuint64 start_ns, end_ns;
+  glGetQueryObjectui64v(start, GL_QUERY_RESULT, &start_ns);
+  glGetQueryObjectui64v(end, GL_QUERY_RESULT, &end_ns);
+  scaler_.add_gpu_time(static_cast<double>(end_ns - start_ns) / 1e9);
+  pending_[index] = false;
+  return true;
+}
+
+}
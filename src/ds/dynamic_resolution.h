@@ -0,0 +1,108 @@
+#pragma once
+#include "../glpp/framebuffers.h"
+#include "../glpp/queries.h"
+#include "../glpp/renderbuffers.h"
+#include "resolution_scaler.h"
+
+namespace ds {
+
+/**
+ * Render frames offscreen at a resolution that follows the GPU time, then
+ * upscale them to the default framebuffer, see `resolution_scaler`.
+ *
+ * The offscreen framebuffer has the size of the default one, and frames
+ * only use the part of it at the current scale, so that changing the scale
+ * doesn't allocate anything. Upscaling is a linear-filtered blit. GPU time
+ * is measured from timestamps, that can't conflict with the elapsed time
+ * queries of `gpu_timer`, and collected several frames later so that it
+ * never stalls.
+ */
+class dynamic_resolution {
+public:
+  /**
+   * `width` and `height` are those of the default framebuffer, and
+   * `target_time` the GPU time to stay under, in seconds.
+   */
+  dynamic_resolution(
+    int width,
+    int height,
+    double target_time,
+    float min_scale
+  );
+  dynamic_resolution(dynamic_resolution&) = delete;
+
+  /**
+   * Bind the offscreen framebuffer and set the viewport to the current
+   * scale. Frames get drawn between this and `end_frame()`, that are the
+   * bounds of the GPU time measured: call it after the uploads and the CPU
+   * work of the frame, right before clearing and drawing.
+   */
+  void begin_frame();
+
+  /**
+   * Upscale the frame to the default framebuffer, left bound along with a
+   * full viewport.
+   */
+  void end_frame();
+
+  /**
+   * Collect the GPU times that are available, without waiting, and adjust
+   * the scale for the next frames.
+   */
+  void poll();
+
+  float scale() const {
+    return scaler_.scale();
+  }
+
+  /**
+   * Size the next frame gets drawn at, for the level of detail to follow
+   * the pixels actually rendered.
+   */
+  int frame_width() const {
+    return frame_width_;
+  }
+
+  int frame_height() const {
+    return frame_height_;
+  }
+
+  /**
+   * Lowest scale a frame got rendered at so far.
+   */
+  float min_used_scale() const {
+    return min_used_scale_;
+  }
+
+  const resolution_scaler& scaler() const {
+    return scaler_;
+  }
+
+  size_t dropped_count() const {
+    return dropped_count_;
+  }
+
+private:
+  static const int RING_SIZE = 4;
+
+  bool collect_(size_t index);
+  void update_frame_size_();
+
+  int width_;
+  int height_;
+  int frame_width_;
+  int frame_height_;
+  resolution_scaler scaler_;
+  float min_used_scale_;
+  glpp::framebuffers<1> framebuffer_;
+  glpp::renderbuffers<2> renderbuffers_;
+  /**
+   * Timestamps at the start and the end of each frame of the ring.
+   */
+  glpp::queries<RING_SIZE * 2> queries_;
+  bool pending_[RING_SIZE];
+  size_t next_;
+  size_t dropped_count_;
+};
+
+}
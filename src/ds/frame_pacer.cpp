@@ -0,0 +1,95 @@
+#include "frame_pacer.h"
+#include "trace.h"
+#include <chrono>
+#include <thread>
+
+namespace ds {
+
+namespace {
+
+/**
+ * How long before the deadline the hybrid policy stops sleeping.
+ */
+const double SPIN_MARGIN = 0.002;
+
+/**
+ * Steps run at most in a frame.
+ */
+const size_t MAX_STEPS = 8;
+
+}
+
+double get_time() {
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+frame_pacer::frame_pacer(
+  pacing_policy policy,
+  double frame_delta,
+  double step_delta
+):
+  policy_(policy),
+  frame_delta_(frame_delta),
+  step_delta_(step_delta),
+  accumulator_(0),
+  deadline_(get_time()),
+  last_present_(deadline_) {}
+
+void frame_pacer::wait() {
+  if (policy_ != pacing_policy::HYBRID) {
+    return;
+  }
+  DS_TRACE_ZONE("wait_frame");
+  deadline_ += frame_delta_;
+  auto now = get_time();
+  // Start over from now when a frame is missed, rather than rush the next
+  // ones to catch up.
+  if (deadline_ < now - frame_delta_) {
+    deadline_ = now;
+    return;
+  }
+  if (deadline_ - now > SPIN_MARGIN) {
+    std::this_thread::sleep_for(
+      std::chrono::duration<double>(deadline_ - now - SPIN_MARGIN)
+    );
+  }
+  while (get_time() < deadline_) {}
+}
+
+size_t frame_pacer::advance(double elapsed) {
+  accumulator_ += elapsed;
+  size_t steps = 0;
+  while (accumulator_ >= step_delta_) {
+    accumulator_ -= step_delta_;
+    ++steps;
+  }
+  if (steps > MAX_STEPS) {
+    steps = MAX_STEPS;
+  }
+  return steps;
+}
+
+void frame_pacer::end_frame(double input_time, double present_time) {
+  frames_.add(present_time - last_present_);
+  latencies_.add(present_time - input_time);
+  recent_frames_.add(present_time - last_present_);
+  recent_latencies_.add(present_time - input_time);
+  last_present_ = present_time;
+}
+
+void frame_pacer::reset_recent() {
+  recent_frames_ = frame_stats();
+  recent_latencies_ = frame_stats();
+}
+
+void frame_pacer::print(std::ostream& os) const {
+  frames_.print(os);
+  os << "input to present p50 " << latencies_.get_percentile(0.5) * 1000
+    << "ms, p95 " << latencies_.get_percentile(0.95) * 1000
+    << "ms, p99 " << latencies_.get_percentile(0.99) * 1000 << "ms"
+    << std::endl;
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "frame_stats.h"
+#include <ostream>
+
+namespace ds {
+
+enum class pacing_policy {
+  /**
+   * Let the swap block until the display refresh.
+   */
+  VSYNC,
+  /**
+   * Sleep until shortly before the frame deadline, then spin, as sleeping
+   * alone oversleeps by up to a scheduler tick.
+   */
+  HYBRID,
+  /**
+   * Start the next frame right away.
+   */
+  UNCAPPED,
+};
+
+/**
+ * Paces the frames, and steps the simulation at a fixed rate, decoupled from
+ * the frame rate: each frame runs as many steps as the time elapsed allows,
+ * and gets drawn interpolated between the last two steps. A frame is:
+ *
+ *  1. `wait()` for the frame to start, as late as possible,
+ *  2. sample the input, then run `advance()` steps,
+ *  3. draw with `get_alpha()`, present, and `end_frame()`.
+ *
+ * Tracks frame times, and the latency from sampling the input to presenting
+ * the frame.
+ */
+class frame_pacer {
+public:
+  frame_pacer(pacing_policy policy, double frame_delta, double step_delta);
+
+  pacing_policy policy() const {
+    return policy_;
+  }
+
+  /**
+   * Block until the next frame should start. Only the hybrid policy waits
+   * here.
+   */
+  void wait();
+
+  /**
+   * Number of steps to run for `elapsed` more seconds. After a stall, steps
+   * beyond a few are dropped rather than run all at once.
+   */
+  size_t advance(double elapsed);
+
+  /**
+   * How far from the previous step to the last one to draw, in [0, 1].
+   */
+  float get_alpha() const {
+    return static_cast<float>(accumulator_ / step_delta_);
+  }
+
+  double step_delta() const {
+    return step_delta_;
+  }
+
+  /**
+   * Record a frame presented at `present_time`, whose input got sampled at
+   * `input_time`, as from `get_time()`.
+   */
+  void end_frame(double input_time, double present_time);
+
+  size_t frame_count() const {
+    return frames_.count();
+  }
+
+  /**
+   * The frames since the last `reset_recent()`, to report them while
+   * running.
+   */
+  const frame_stats& recent_frames() const {
+    return recent_frames_;
+  }
+
+  const frame_stats& recent_latencies() const {
+    return recent_latencies_;
+  }
+
+  void reset_recent();
+
+  /**
+   * Print the statistics of all the frames, see `frame_stats::print()`, and
+   * the input latency percentiles.
+   */
+  void print(std::ostream& os) const;
+
+private:
+  pacing_policy policy_;
+  double frame_delta_;
+  double step_delta_;
+  double accumulator_;
+  double deadline_;
+  double last_present_;
+  frame_stats frames_;
+  frame_stats latencies_;
+  frame_stats recent_frames_;
+  frame_stats recent_latencies_;
+};
+
+/**
+ * Seconds on a monotonic clock.
+ */
+double get_time();
+
+}
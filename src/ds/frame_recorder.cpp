@@ -0,0 +1,254 @@
+#include "frame_recorder.h"
+#include "system_error.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ds {
+
+namespace {
+
+/**
+ * Frames waiting for the writer beyond which new ones get dropped.
+ */
+const size_t MAX_QUEUED_FRAMES = 8;
+
+const GLuint64 FINISH_TIMEOUT_NS = 1000000000;
+
+bool ends_with(const std::string& value, const std::string& suffix) {
+  return
+    value.size() >= suffix.size() &&
+    value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::uint8_t to_byte(int value) {
+  return static_cast<std::uint8_t>(std::min(std::max(value, 0), 255));
+}
+
+}
+
+frame_recorder::frame_recorder(
+  const std::string& path,
+  int width,
+  int height,
+  int frame_rate
+):
+  width_(width),
+  height_(height),
+  frame_bytes_(static_cast<size_t>(width) * height * 4),
+  y4m_(ends_with(path, ".y4m")),
+  os_(path, std::ios::binary),
+  fences_(),
+  first_(0),
+  count_(0),
+  captured_count_(0),
+  dropped_count_(0),
+  backpressure_count_(0),
+  written_count_(0),
+  max_queued_count_(0),
+  finishing_(false),
+  failed_(false) {
+  if (y4m_) {
+    os_ << "YUV4MPEG2 W" << width << " H" << height << " F" << frame_rate
+      << ":1 Ip A1:1 C444\n";
+  }
+  if (!os_) {
+    throw system_error("cannot write the recording `" + path + "`");
+  }
+  for (size_t i = 0; i < RING_SIZE; ++i) {
+    glpp::state::bind_buffer(GL_PIXEL_PACK_BUFFER, buffers_.handles()[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, frame_bytes_, nullptr, GL_STREAM_READ);
+  }
+  glpp::state::bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  writer_ = std::thread([this]() { write_loop_(); });
+}
+
+frame_recorder::~frame_recorder() {
+  if (writer_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finishing_ = true;
+    }
+    changed_.notify_all();
+    writer_.join();
+  }
+  for (auto fence: fences_) {
+    if (fence != nullptr) {
+      glDeleteSync(fence);
+    }
+  }
+}
+
+void frame_recorder::capture() {
+  DS_TRACE_ZONE("capture_frame");
+  poll();
+  if (count_ == RING_SIZE) {
+    ++dropped_count_;
+    return;
+  }
+  auto index = (first_ + count_) % RING_SIZE;
+  glpp::state::bind_buffer(GL_PIXEL_PACK_BUFFER, buffers_.handles()[index]);
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glpp::state::bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  fences_[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  ++count_;
+  ++captured_count_;
+}
+
+void frame_recorder::poll() {
+  while (count_ > 0) {
+    auto status = glClientWaitSync(fences_[first_], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      return;
+    }
+    retire_(first_, false);
+  }
+}
+
+void frame_recorder::finish() {
+  DS_TRACE_ZONE("finish_recording");
+  while (count_ > 0) {
+    auto status = glClientWaitSync(
+      fences_[first_],
+      GL_SYNC_FLUSH_COMMANDS_BIT,
+      FINISH_TIMEOUT_NS
+    );
+    if (status == GL_WAIT_FAILED) {
+      throw system_error("cannot wait for the recorded frames");
+    }
+    if (status != GL_TIMEOUT_EXPIRED) {
+      retire_(first_, true);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finishing_ = true;
+  }
+  changed_.notify_all();
+  writer_.join();
+  os_.close();
+  if (failed_ || !os_) {
+    throw system_error("cannot write the recording");
+  }
+}
+
+size_t frame_recorder::written_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_count_;
+}
+
+size_t frame_recorder::max_queued_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_queued_count_;
+}
+
+/**
+ * Only waits for the writer when `wait` is set, otherwise the frame gets
+ * dropped if it is behind.
+ */
+void frame_recorder::retire_(size_t index, bool wait) {
+  glDeleteSync(fences_[index]);
+  fences_[index] = nullptr;
+  first_ = (first_ + 1) % RING_SIZE;
+  --count_;
+
+  std::vector<std::uint8_t> frame;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wait) {
+      changed_.wait(lock, [this]() {
+        return queue_.size() < MAX_QUEUED_FRAMES;
+      });
+    } else if (queue_.size() >= MAX_QUEUED_FRAMES) {
+      ++backpressure_count_;
+      return;
+    }
+    if (!free_frames_.empty()) {
+      frame = std::move(free_frames_.back());
+      free_frames_.pop_back();
+    }
+  }
+  frame.resize(frame_bytes_);
+  glpp::state::bind_buffer(GL_PIXEL_PACK_BUFFER, buffers_.handles()[index]);
+  const auto* pixels =
+    glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_bytes_, GL_MAP_READ_BIT);
+  if (pixels != nullptr) {
+    std::memcpy(frame.data(), pixels, frame_bytes_);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glpp::state::bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (pixels == nullptr) {
+    throw system_error("cannot map the recorded frame");
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(frame));
+    max_queued_count_ = std::max(max_queued_count_, queue_.size());
+  }
+  changed_.notify_all();
+}
+
+void frame_recorder::write_loop_() {
+  std::vector<std::uint8_t> frame;
+  bool has_frame = false;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (has_frame) {
+        free_frames_.push_back(std::move(frame));
+        ++written_count_;
+        has_frame = false;
+      }
+      changed_.wait(lock, [this]() { return !queue_.empty() || finishing_; });
+      if (queue_.empty()) {
+        return;
+      }
+      frame = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    // The queue has room for the render thread again.
+    changed_.notify_all();
+    write_frame_(frame);
+    has_frame = true;
+  }
+}
+
+/**
+ * Frames are read bottom row first, as OpenGL has them.
+ */
+void frame_recorder::write_frame_(const std::vector<std::uint8_t>& rgba) {
+  DS_TRACE_ZONE("write_frame");
+  auto row_bytes = static_cast<size_t>(width_) * 4;
+  if (!y4m_) {
+    for (int y = height_ - 1; y >= 0; --y) {
+      os_.write(
+        reinterpret_cast<const char*>(rgba.data() + y * row_bytes),
+        row_bytes
+      );
+    }
+  } else {
+    auto plane_size = static_cast<size_t>(width_) * height_;
+    planes_.resize(plane_size * 3);
+    auto* luma = planes_.data();
+    auto* cb = luma + plane_size;
+    auto* cr = cb + plane_size;
+    size_t i = 0;
+    for (int y = height_ - 1; y >= 0; --y) {
+      const auto* pixel = rgba.data() + y * row_bytes;
+      for (int x = 0; x < width_; ++x, ++i, pixel += 4) {
+        int r = pixel[0], g = pixel[1], b = pixel[2];
+        luma[i] = to_byte(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        cb[i] = to_byte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        cr[i] = to_byte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+      }
+    }
+    os_.write("FRAME\n", 6);
+    os_.write(reinterpret_cast<const char*>(planes_.data()), planes_.size());
+  }
+  if (!os_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = true;
+  }
+}
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "../glpp/buffers.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Record the frames of the default framebuffer to a file without stalling
+ * the pipeline. Each frame is read into a ring of pixel buffers, and only
+ * mapped a few frames later once its fence signals, then handed to a writer
+ * thread that converts and writes it.
+ *
+ * Paths ending in `.y4m` get a YUV4MPEG2 video, 4:4:4 with BT.601 limited
+ * range, that most encoders take as is. Anything else gets raw RGBA8 frames,
+ * top row first.
+ *
+ * Frames are dropped rather than waited for: when the pixel buffers are all
+ * still being read by the GPU, or when the writer is behind by more than a
+ * few frames, which counts as backpressure.
+ */
+class frame_recorder {
+public:
+  /**
+   * `width` and `height` are those of the default framebuffer, and
+   * `frame_rate` what the video header claims.
+   */
+  frame_recorder(
+    const std::string& path,
+    int width,
+    int height,
+    int frame_rate
+  );
+  ~frame_recorder();
+  frame_recorder(frame_recorder&) = delete;
+
+  /**
+   * Start reading the frame drawn so far, before it gets presented.
+   */
+  void capture();
+
+  /**
+   * Hand the frames whose fence signaled to the writer, without waiting.
+   */
+  void poll();
+
+  /**
+   * Wait for the frames in flight, write them and close the file. Throws if
+   * writing failed.
+   */
+  void finish();
+
+  size_t captured_count() const {
+    return captured_count_;
+  }
+
+  size_t written_count() const;
+
+  /**
+   * Frames dropped because all the pixel buffers were still in flight.
+   */
+  size_t dropped_count() const {
+    return dropped_count_;
+  }
+
+  /**
+   * Frames dropped because the writer was behind.
+   */
+  size_t backpressure_count() const {
+    return backpressure_count_;
+  }
+
+  /**
+   * Most frames ever waiting for the writer at once.
+   */
+  size_t max_queued_count() const;
+
+private:
+  static const int RING_SIZE = 3;
+
+  void retire_(size_t index, bool wait);
+  void write_loop_();
+  void write_frame_(const std::vector<std::uint8_t>& rgba);
+
+  int width_;
+  int height_;
+  size_t frame_bytes_;
+  bool y4m_;
+  std::ofstream os_;
+  glpp::buffers<RING_SIZE> buffers_;
+  GLsync fences_[RING_SIZE];
+  /**
+   * Oldest pixel buffer in flight, and how many are in flight.
+   */
+  size_t first_;
+  size_t count_;
+  size_t captured_count_;
+  size_t dropped_count_;
+  size_t backpressure_count_;
+
+  /**
+   * Shared with the writer thread.
+   */
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<std::vector<std::uint8_t>> queue_;
+  std::vector<std::vector<std::uint8_t>> free_frames_;
+  size_t written_count_;
+  size_t max_queued_count_;
+  bool finishing_;
+  bool failed_;
+  /**
+   * Only used by the writer thread.
+   */
+  std::vector<std::uint8_t> planes_;
+  std::thread writer_;
+};
+
+}
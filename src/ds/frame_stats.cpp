@@ -0,0 +1,61 @@
+#include "frame_stats.h"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <string>
+
+namespace ds {
+
+double frame_stats::get_total() const {
+  return std::accumulate(durations_.begin(), durations_.end(), 0.0);
+}
+
+double frame_stats::get_percentile(double rank) const {
+  if (durations_.empty()) {
+    return 0;
+  }
+  auto sorted = durations_;
+  auto ix = std::min(
+    static_cast<size_t>(rank * static_cast<double>(sorted.size())),
+    sorted.size() - 1
+  );
+  std::nth_element(sorted.begin(), sorted.begin() + ix, sorted.end());
+  return sorted[ix];
+}
+
+void frame_stats::print(std::ostream& os) const {
+  auto total = get_total();
+  os << count() << " frames in " << total << "s, "
+    << (total > 0 ? static_cast<double>(count()) / total : 0) << " fps"
+    << std::endl;
+  os << "frame time p50 " << get_percentile(0.5) * 1000
+    << "ms, p95 " << get_percentile(0.95) * 1000
+    << "ms, p99 " << get_percentile(0.99) * 1000 << "ms" << std::endl;
+
+  const double BOUNDS_MS[] = {1, 2, 4, 8, 16, 33, 66};
+  const size_t BUCKET_COUNT = sizeof(BOUNDS_MS) / sizeof(BOUNDS_MS[0]) + 1;
+  size_t buckets[BUCKET_COUNT] = {};
+  for (auto duration: durations_) {
+    auto ms = duration * 1000;
+    size_t ix = 0;
+    while (ix < BUCKET_COUNT - 1 && ms >= BOUNDS_MS[ix]) {
+      ++ix;
+    }
+    ++buckets[ix];
+  }
+  size_t max_bucket = *std::max_element(buckets, buckets + BUCKET_COUNT);
+  const size_t BAR_WIDTH = 40;
+  for (size_t ix = 0; ix < BUCKET_COUNT; ++ix) {
+    if (ix < BUCKET_COUNT - 1) {
+      os << "  < " << std::setw(3) << BOUNDS_MS[ix] << "ms ";
+    } else {
+      os << " >= " << std::setw(3) << BOUNDS_MS[ix - 1] << "ms ";
+    }
+    auto width = max_bucket == 0 ? 0 : buckets[ix] * BAR_WIDTH / max_bucket;
+    os << "|" << std::string(width, '#')
+      << std::string(BAR_WIDTH - width, ' ') << "| " << buckets[ix]
+      << std::endl;
+  }
+}
+
+}
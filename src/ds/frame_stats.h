@@ -0,0 +1,38 @@
+#pragma once
+#include <ostream>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Durations of successive frames, to report throughput and how frame times
+ * are distributed.
+ */
+struct frame_stats {
+  void add(double seconds) {
+    durations_.push_back(seconds);
+  }
+
+  size_t count() const {
+    return durations_.size();
+  }
+
+  double get_total() const;
+
+  /**
+   * Duration below which `rank` of the frames fall, ex. `0.99` for the 99th
+   * percentile. Zero if there are no frames.
+   */
+  double get_percentile(double rank) const;
+
+  /**
+   * Print frames per second, percentiles, and a histogram of the frame times
+   * in buckets doubling in width.
+   */
+  void print(std::ostream& os) const;
+
+private:
+  std::vector<double> durations_;
+};
+
+}
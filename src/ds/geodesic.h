@@ -0,0 +1,246 @@
+#pragma once
+#include <stddef.h>
+
+namespace ds {
+
+/**
+ * Geodesic grids built from the faces of a unit icosahedron. Every function
+ * here is `constexpr`, so that the same code produces the compile-time
+ * `icosphere` tables and the runtime meshes, bit-for-bit identical.
+ */
+namespace geodesic {
+
+const size_t CORNER_COUNT = 12;
+const size_t EDGE_COUNT = 30;
+const size_t FACE_COUNT = 20;
+
+constexpr size_t get_vertex_count(size_t frequency) {
+  return 10 * frequency * frequency + 2;
+}
+
+constexpr size_t get_triangle_count(size_t frequency) {
+  return FACE_COUNT * frequency * frequency;
+}
+
+/**
+ * Square root by Newton's method. Starting above the root, iterates decrease
+ * strictly until they converge, so we stop as soon as they don't.
+ */
+constexpr double sqrt(double value) {
+  double guess = value > 1 ? value : 1;
+  while (true) {
+    double next = 0.5 * (guess + value / guess);
+    if (!(next < guess)) {
+      return guess;
+    }
+    guess = next;
+  }
+}
+
+struct vec3 {
+  double x;
+  double y;
+  double z;
+};
+
+constexpr vec3 normalize(vec3 v) {
+  double length = sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+  return {v.x / length, v.y / length, v.z / length};
+}
+
+/**
+ * The icosahedron the grids are built from. Corners are unit vectors, faces
+ * are counter-clockwise seen from the outside, and edges go from their lowest
+ * corner to their highest one. `edge_ids[a][b]` is one plus the index of the
+ * edge between corners `a` and `b`, in either order, or zero.
+ */
+struct base {
+  vec3 corners[CORNER_COUNT];
+  unsigned faces[FACE_COUNT][3];
+  unsigned edges[EDGE_COUNT][2];
+  unsigned edge_ids[CORNER_COUNT][CORNER_COUNT];
+};
+
+constexpr base make_base() {
+  const double t = 1.6180339887498948482;
+  base result = {
+    {
+      {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+      {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+      {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+    },
+    {
+      {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+      {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+      {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+      {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1},
+    },
+    {},
+    {},
+  };
+  for (size_t i = 0; i < CORNER_COUNT; ++i) {
+    result.corners[i] = normalize(result.corners[i]);
+  }
+  size_t edge_count = 0;
+  for (size_t i = 0; i < FACE_COUNT; ++i) {
+    for (size_t k = 0; k < 3; ++k) {
+      auto from = result.faces[i][k];
+      auto to = result.faces[i][(k + 1) % 3];
+      if (to < from) {
+        auto swap = from;
+        from = to;
+        to = swap;
+      }
+      if (result.edge_ids[from][to] == 0) {
+        result.edges[edge_count][0] = from;
+        result.edges[edge_count][1] = to;
+        ++edge_count;
+        result.edge_ids[from][to] = edge_count;
+        result.edge_ids[to][from] = edge_count;
+      }
+    }
+  }
+  return result;
+}
+
+constexpr base BASE = make_base();
+
+/**
+ * Vertices are laid out as the 12 corners, then the `frequency - 1` inner
+ * vertices of each edge, then the inner vertices of each face, row by row.
+ * This is the index of the `step`-th vertex starting from corner `from` on
+ * the edge going to corner `to`, with `0 < step < frequency`.
+ */
+constexpr size_t get_edge_vertex(
+  size_t frequency,
+  unsigned from,
+  unsigned to,
+  size_t step
+) {
+  auto edge_ix = BASE.edge_ids[from][to] - 1;
+  auto offset = from < to ? step : frequency - step;
+  return CORNER_COUNT + edge_ix * (frequency - 1) + offset - 1;
+}
+
+/**
+ * Within face `(a, b, c)`, the vertex at row `i` and column `j`, with
+ * `0 <= j <= i <= frequency`, is `(a * (f - i) + b * (i - j) + c * j) / f`
+ * projected onto the sphere. Row zero is `a`, the last row goes from `b`
+ * to `c`.
+ */
+constexpr size_t get_face_vertex(
+  size_t frequency,
+  size_t face_ix,
+  size_t i,
+  size_t j
+) {
+  const auto& face = BASE.faces[face_ix];
+  if (i == 0) {
+    return face[0];
+  }
+  if (j == 0) {
+    return i == frequency
+      ? face[1]
+      : get_edge_vertex(frequency, face[0], face[1], i);
+  }
+  if (i == frequency) {
+    return j == frequency
+      ? face[2]
+      : get_edge_vertex(frequency, face[1], face[2], j);
+  }
+  if (i == j) {
+    return get_edge_vertex(frequency, face[0], face[2], i);
+  }
+  auto face_inner_count = (frequency - 1) * (frequency - 2) / 2;
+  return CORNER_COUNT + EDGE_COUNT * (frequency - 1) +
+    face_ix * face_inner_count + (i - 2) * (i - 1) / 2 + j - 1;
+}
+
+constexpr vec3 interpolate(
+  const vec3& a, double wa,
+  const vec3& b, double wb
+) {
+  return normalize({
+    a.x * wa + b.x * wb,
+    a.y * wa + b.y * wb,
+    a.z * wa + b.z * wb,
+  });
+}
+
+constexpr vec3 interpolate(
+  const vec3& a, double wa,
+  const vec3& b, double wb,
+  const vec3& c, double wc
+) {
+  return normalize({
+    a.x * wa + b.x * wb + c.x * wc,
+    a.y * wa + b.y * wb + c.y * wc,
+    a.z * wa + b.z * wb + c.z * wc,
+  });
+}
+
+/**
+ * Write the whole grid into `sink`, that must provide `set_vertex(index,
+ * position)` and `set_triangle(index, a, b, c)`. Vertices are written in
+ * index order, so a sink may as well append them.
+ */
+template <typename Sink>
+constexpr void build(size_t frequency, Sink& sink) {
+  const auto f = static_cast<double>(frequency);
+  size_t vertex_ix = 0;
+  for (size_t i = 0; i < CORNER_COUNT; ++i) {
+    sink.set_vertex(vertex_ix++, BASE.corners[i]);
+  }
+  for (size_t i = 0; i < EDGE_COUNT; ++i) {
+    const auto& from = BASE.corners[BASE.edges[i][0]];
+    const auto& to = BASE.corners[BASE.edges[i][1]];
+    for (size_t step = 1; step < frequency; ++step) {
+      auto s = static_cast<double>(step);
+      sink.set_vertex(
+        vertex_ix++,
+        interpolate(from, (f - s) / f, to, s / f)
+      );
+    }
+  }
+  for (size_t face_ix = 0; face_ix < FACE_COUNT; ++face_ix) {
+    const auto& face = BASE.faces[face_ix];
+    const auto& a = BASE.corners[face[0]];
+    const auto& b = BASE.corners[face[1]];
+    const auto& c = BASE.corners[face[2]];
+    for (size_t i = 2; i < frequency; ++i) {
+      for (size_t j = 1; j < i; ++j) {
+        auto di = static_cast<double>(i);
+        auto dj = static_cast<double>(j);
+        sink.set_vertex(
+          vertex_ix++,
+          interpolate(a, (f - di) / f, b, (di - dj) / f, c, dj / f)
+        );
+      }
+    }
+  }
+  size_t triangle_ix = 0;
+  for (size_t face_ix = 0; face_ix < FACE_COUNT; ++face_ix) {
+    for (size_t i = 0; i < frequency; ++i) {
+      for (size_t j = 0; j <= i; ++j) {
+        sink.set_triangle(
+          triangle_ix++,
+          get_face_vertex(frequency, face_ix, i, j),
+          get_face_vertex(frequency, face_ix, i + 1, j),
+          get_face_vertex(frequency, face_ix, i + 1, j + 1)
+        );
+        if (j < i) {
+          sink.set_triangle(
+            triangle_ix++,
+            get_face_vertex(frequency, face_ix, i, j),
+            get_face_vertex(frequency, face_ix, i + 1, j + 1),
+            get_face_vertex(frequency, face_ix, i, j + 1)
+          );
+        }
+      }
+    }
+  }
+}
+
+}
+
+}
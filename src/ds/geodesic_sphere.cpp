@@ -0,0 +1,44 @@
+#include "geodesic_sphere.h"
+#include "geodesic.h"
+#include "trace.h"
+#include <stdexcept>
+
+namespace ds {
+
+namespace {
+
+struct mesh_sink {
+  mesh_sink(mesh& target): target(target) {}
+
+  void set_vertex(size_t index, const geodesic::vec3& position) {
+    glm::vec3 unit(
+      static_cast<float>(position.x),
+      static_cast<float>(position.y),
+      static_cast<float>(position.z)
+    );
+    target.vertices.push_back({ .position = unit, .normal = unit });
+  }
+
+  void set_triangle(size_t index, size_t a, size_t b, size_t c) {
+    target.triangles.push_back(glm::uvec3(a, b, c));
+  }
+
+  mesh& target;
+};
+
+}
+
+mesh get_geodesic_sphere(size_t frequency) {
+  DS_TRACE_ZONE("geodesic_sphere");
+  if (frequency == 0) {
+    throw std::runtime_error("geodesic sphere frequency must be positive");
+  }
+  mesh result;
+  result.vertices.reserve(geodesic::get_vertex_count(frequency));
+  result.triangles.reserve(geodesic::get_triangle_count(frequency));
+  mesh_sink sink(result);
+  geodesic::build(frequency, sink);
+  return result;
+}
+
+}
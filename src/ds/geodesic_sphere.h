@@ -0,0 +1,20 @@
+#pragma once
+#include "mesh.h"
+
+namespace ds {
+
+/**
+ * Build a unit geodesic sphere by splitting each edge of the icosahedron in
+ * `frequency` segments and each face in `frequency * frequency` triangles,
+ * then projecting all the vertices onto the sphere. A frequency of `2^n` has
+ * the same topology as `n` passes of 1-to-4 subdivision.
+ *
+ * Vertices are laid out as the 12 corners, then the inner vertices of each
+ * of the 30 edges, then the inner vertices of each of the 20 faces, so that
+ * every shared vertex has a closed-form index and is computed only once (see
+ * `geodesic.h`). For small powers of two, prefer the compile-time
+ * `icosphere` tables.
+ */
+mesh get_geodesic_sphere(size_t frequency);
+
+}
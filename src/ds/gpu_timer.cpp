@@ -0,0 +1,61 @@
+#include "gpu_timer.h"
+#include "trace.h"
+
+namespace ds {
+
+gpu_timer::gpu_timer(): slots_(), next_(0), dropped_count_(0) {}
+
+void gpu_timer::begin(const char* name) {
+  if (!trace::is_enabled()) {
+    return;
+  }
+  auto& slot = slots_[next_];
+  if (slot.pending && !collect_(next_)) {
+    ++dropped_count_;
+  }
+  slot.name = name;
+  slot.submit_time = trace::now();
+  slot.pending = true;
+  glBeginQuery(GL_TIME_ELAPSED, queries_.handles()[next_]);
+}
+
+void gpu_timer::end() {
+  if (!trace::is_enabled()) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  next_ = (next_ + 1) % RING_SIZE;
+}
+
+void gpu_timer::poll() {
+  if (!trace::is_enabled()) {
+    return;
+  }
+  for (size_t i = 0; i < RING_SIZE; ++i) {
+    if (slots_[i].pending) {
+      collect_(i);
+    }
+  }
+}
+
+bool gpu_timer::collect_(size_t index) {
+  auto& slot = slots_[index];
+  auto handle = queries_.handles()[index];
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(handle, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return false;
+  }
+  GLuint64 elapsed_ns;
+  glGetQueryObjectui64v(handle, GL_QUERY_RESULT, &elapsed_ns);
+  trace::add_event(
+    slot.name,
+    trace::GPU_TRACK,
+    slot.submit_time,
+    static_cast<double>(elapsed_ns) / 1000
+  );
+  slot.pending = false;
+  return true;
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "../glpp/queries.h"
+#include <stddef.h>
+
+namespace ds {
+
+/**
+ * Measure GPU time spent on sections of the command stream with
+ * `GL_TIME_ELAPSED` queries, and add them to the trace on the GPU track.
+ *
+ * Queries are taken from a ring and their results are only collected once
+ * available, several frames later, so this never stalls the pipeline. If the
+ * ring wraps around a query that is still pending, its result is dropped.
+ * Events are placed at the CPU time the section was submitted, as elapsed
+ * time queries don't give the time the GPU actually started.
+ *
+ * Does nothing unless tracing is enabled.
+ */
+struct gpu_timer {
+  gpu_timer();
+  gpu_timer(gpu_timer&) = delete;
+
+  /**
+   * Queries can't be nested, `end()` must be called before the next
+   * `begin()`. `name` must outlive the tracing session.
+   */
+  void begin(const char* name);
+  void end();
+
+  /**
+   * Collect the results that are available, without waiting. Must not be
+   * called between `begin()` and `end()`.
+   */
+  void poll();
+
+  size_t dropped_count() const {
+    return dropped_count_;
+  }
+
+private:
+  static const int RING_SIZE = 32;
+
+  struct slot {
+    const char* name;
+    double submit_time;
+    bool pending;
+  };
+
+  bool collect_(size_t index);
+
+  glpp::queries<RING_SIZE> queries_;
+  slot slots_[RING_SIZE];
+  size_t next_;
+  size_t dropped_count_;
+};
+
+}
@@ -1,8 +0,0 @@
-#pragma once
-#include "mesh.h"
-
-namespace ds {
-
-extern mesh icosahedron;
-
-};
@@ -0,0 +1,123 @@
+#pragma once
+#include "geodesic.h"
+#include "geodesic_sphere.h"
+#include "mesh.h"
+#include <memory>
+
+namespace ds {
+
+/**
+ * Levels up to this one are computed entirely at compile time. Beyond it,
+ * the default constexpr evaluation budgets of compilers get exhausted.
+ */
+const size_t MAX_CONSTEXPR_ICOSPHERE_LEVEL = 3;
+
+/**
+ * Flat vertex positions and triangle indices of a geodesic sphere.
+ */
+template <size_t VertexCount, size_t TriangleCount>
+struct icosphere_tables {
+  float positions[VertexCount][3];
+  unsigned triangles[TriangleCount][3];
+
+  constexpr void set_vertex(size_t index, const geodesic::vec3& position) {
+    positions[index][0] = static_cast<float>(position.x);
+    positions[index][1] = static_cast<float>(position.y);
+    positions[index][2] = static_cast<float>(position.z);
+  }
+
+  constexpr void set_triangle(size_t index, size_t a, size_t b, size_t c) {
+    triangles[index][0] = static_cast<unsigned>(a);
+    triangles[index][1] = static_cast<unsigned>(b);
+    triangles[index][2] = static_cast<unsigned>(c);
+  }
+
+  mesh to_mesh() const {
+    mesh result;
+    result.vertices.reserve(VertexCount);
+    for (const auto& position: positions) {
+      glm::vec3 unit(position[0], position[1], position[2]);
+      result.vertices.push_back({ .position = unit, .normal = unit });
+    }
+    result.triangles.reserve(TriangleCount);
+    for (const auto& triangle: triangles) {
+      result.triangles.push_back(
+        glm::uvec3(triangle[0], triangle[1], triangle[2])
+      );
+    }
+    return result;
+  }
+};
+
+template <size_t VertexCount, size_t TriangleCount>
+constexpr icosphere_tables<VertexCount, TriangleCount>
+make_icosphere_tables(size_t frequency) {
+  icosphere_tables<VertexCount, TriangleCount> result = {};
+  geodesic::build(frequency, result);
+  return result;
+}
+
+/**
+ * Unit sphere made of the icosahedron with each face split in `4^Level`
+ * triangles, the same as `get_geodesic_sphere(2^Level)`. `get_tables()`
+ * gives the flat data, and `to_mesh()` a new `mesh` for it.
+ *
+ * Up to `MAX_CONSTEXPR_ICOSPHERE_LEVEL` the tables are compile-time constants
+ * living in read-only data. Beyond, they are computed on first access.
+ */
+template <size_t Level, bool = (Level <= MAX_CONSTEXPR_ICOSPHERE_LEVEL)>
+struct icosphere;
+
+template <size_t Level>
+struct icosphere<Level, true> {
+  static constexpr size_t frequency = size_t(1) << Level;
+  static constexpr size_t vertex_count =
+    geodesic::get_vertex_count(frequency);
+  static constexpr size_t triangle_count =
+    geodesic::get_triangle_count(frequency);
+  typedef icosphere_tables<vertex_count, triangle_count> tables;
+
+  static constexpr const tables& get_tables() {
+    return TABLES;
+  }
+
+  static mesh to_mesh() {
+    return TABLES.to_mesh();
+  }
+
+private:
+  static constexpr tables TABLES =
+    make_icosphere_tables<vertex_count, triangle_count>(frequency);
+};
+
+template <size_t Level>
+constexpr typename icosphere<Level, true>::tables
+icosphere<Level, true>::TABLES;
+
+template <size_t Level>
+struct icosphere<Level, false> {
+  static constexpr size_t frequency = size_t(1) << Level;
+  static constexpr size_t vertex_count =
+    geodesic::get_vertex_count(frequency);
+  static constexpr size_t triangle_count =
+    geodesic::get_triangle_count(frequency);
+  typedef icosphere_tables<vertex_count, triangle_count> tables;
+
+  static const tables& get_tables() {
+    static const std::unique_ptr<tables> instance = make_tables_();
+    return *instance;
+  }
+
+  static mesh to_mesh() {
+    return get_geodesic_sphere(frequency);
+  }
+
+private:
+  static std::unique_ptr<tables> make_tables_() {
+    std::unique_ptr<tables> result(new tables());
+    geodesic::build(frequency, *result);
+    return result;
+  }
+};
+
+}
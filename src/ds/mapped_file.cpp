@@ -0,0 +1,35 @@
+#include "mapped_file.h"
+#include "system_error.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ds {
+
+std::unique_ptr<mapped_file> mapped_file::open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  auto size = static_cast<size_t>(info.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw system_error("cannot map `" + path + "` in memory");
+  }
+  return std::unique_ptr<mapped_file>(
+    new mapped_file(static_cast<const std::uint8_t*>(data), size)
+  );
+}
+
+mapped_file::~mapped_file() {
+  munmap(const_cast<std::uint8_t*>(data_), size_);
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ds {
+
+/**
+ * Read-only memory mapping of a whole file, so that its content can be used
+ * in place without reading it first.
+ */
+class mapped_file {
+public:
+  /**
+   * Return null if the file cannot be opened, ex. it doesn't exist.
+   */
+  static std::unique_ptr<mapped_file> open(const std::string& path);
+
+  ~mapped_file();
+  mapped_file(mapped_file&) = delete;
+
+  const std::uint8_t* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  mapped_file(const std::uint8_t* data, size_t size):
+    data_(data), size_(size) {}
+
+  const std::uint8_t* data_;
+  size_t size_;
+};
+
+}
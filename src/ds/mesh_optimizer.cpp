@@ -0,0 +1,323 @@
+#include "mesh_optimizer.h"
+#include "trace.h"
+#include <algorithm>
+#include <limits>
+
+namespace ds {
+
+namespace {
+
+const std::uint32_t NO_VERTEX = std::numeric_limits<std::uint32_t>::max();
+
+/**
+ * FIFO post-transform cache. Each vertex remembers when it got in, so that
+ * it's still there if fewer than `size` vertices got in since.
+ */
+class fifo_cache {
+public:
+  fifo_cache(size_t vertex_count, size_t size):
+    stamps_(vertex_count, 0), time_(size + 1), size_(size) {}
+
+  /**
+   * Return whether the vertex had to be transformed.
+   */
+  bool access(std::uint32_t vertex) {
+    if (time_ - stamps_[vertex] <= size_) {
+      return false;
+    }
+    stamps_[vertex] = time_++;
+    return true;
+  }
+
+  /**
+   * Evict everything.
+   */
+  void flush() {
+    time_ += size_ + 1;
+  }
+
+  unsigned access(const glm::uvec3& triangle) {
+    return
+      (access(triangle.x) ? 1 : 0) +
+      (access(triangle.y) ? 1 : 0) +
+      (access(triangle.z) ? 1 : 0);
+  }
+
+private:
+  std::vector<size_t> stamps_;
+  size_t time_;
+  size_t size_;
+};
+
+/**
+ * Area-weighted normal, of twice the area of the triangle.
+ */
+glm::vec3 get_scaled_normal(const mesh& mesh, const glm::uvec3& triangle) {
+  const auto& a = mesh.vertices[triangle.x].position;
+  const auto& b = mesh.vertices[triangle.y].position;
+  const auto& c = mesh.vertices[triangle.z].position;
+  return glm::cross(b - a, c - a);
+}
+
+glm::vec3 get_centroid(const mesh& mesh, const glm::uvec3& triangle) {
+  return (
+    mesh.vertices[triangle.x].position +
+    mesh.vertices[triangle.y].position +
+    mesh.vertices[triangle.z].position
+  ) / 3.0f;
+}
+
+struct cluster {
+  size_t begin;
+  size_t end;
+  float sort_key;
+};
+
+/**
+ * Clusters start where all the vertices of a triangle miss the cache, as
+ * that's where Tipsify jumped elsewhere, and then wherever the miss ratio of
+ * the cluster so far, starting from an empty cache, is low enough that
+ * starting over costs little.
+ */
+std::vector<cluster> get_clusters(
+  const mesh& mesh,
+  size_t cache_size,
+  float threshold
+) {
+  const auto& triangles = mesh.triangles;
+  fifo_cache cache(mesh.vertices.size(), cache_size);
+  std::vector<unsigned> misses(triangles.size());
+  size_t total_misses = 0;
+  for (size_t t = 0; t < triangles.size(); ++t) {
+    misses[t] = cache.access(triangles[t]);
+    total_misses += misses[t];
+  }
+  auto max_acmr =
+    threshold * static_cast<float>(total_misses) / triangles.size();
+
+  std::vector<cluster> result;
+  size_t begin = 0;
+  size_t cluster_misses = 0;
+  cache.flush();
+  for (size_t t = 0; t < triangles.size(); ++t) {
+    if (t > begin && misses[t] == 3) {
+      result.push_back({begin, t, 0});
+      begin = t;
+      cluster_misses = 0;
+      cache.flush();
+    }
+    cluster_misses += cache.access(triangles[t]);
+    auto acmr = static_cast<float>(cluster_misses) / (t + 1 - begin);
+    if (t + 1 < triangles.size() && acmr <= max_acmr) {
+      result.push_back({begin, t + 1, 0});
+      begin = t + 1;
+      cluster_misses = 0;
+      cache.flush();
+    }
+  }
+  result.push_back({begin, triangles.size(), 0});
+  return result;
+}
+
+}
+
+vertex_adjacency get_vertex_adjacency(const mesh& mesh) {
+  vertex_adjacency result;
+  result.offsets.resize(mesh.vertices.size() + 1, 0);
+  for (const auto& triangle: mesh.triangles) {
+    for (int k = 0; k < 3; ++k) {
+      ++result.offsets[triangle[k] + 1];
+    }
+  }
+  for (size_t i = 1; i < result.offsets.size(); ++i) {
+    result.offsets[i] += result.offsets[i - 1];
+  }
+  result.triangles.resize(mesh.triangles.size() * 3);
+  auto next = result.offsets;
+  for (size_t t = 0; t < mesh.triangles.size(); ++t) {
+    for (int k = 0; k < 3; ++k) {
+      result.triangles[next[mesh.triangles[t][k]]++] =
+        static_cast<std::uint32_t>(t);
+    }
+  }
+  return result;
+}
+
+vertex_cache_stats get_vertex_cache_stats(
+  const std::vector<glm::uvec3>& triangles,
+  size_t vertex_count,
+  size_t cache_size
+) {
+  fifo_cache cache(vertex_count, cache_size);
+  size_t misses = 0;
+  for (const auto& triangle: triangles) {
+    misses += cache.access(triangle);
+  }
+  return {
+    .acmr = triangles.empty() ? 0 :
+      static_cast<float>(misses) / triangles.size(),
+    .atvr = vertex_count == 0 ? 0 :
+      static_cast<float>(misses) / vertex_count,
+  };
+}
+
+void optimize_vertex_cache(mesh& mesh, size_t cache_size) {
+  DS_TRACE_ZONE("optimize_vertex_cache");
+  const auto vertex_count = mesh.vertices.size();
+  auto adjacency = get_vertex_adjacency(mesh);
+  std::vector<std::uint32_t> live_counts(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    live_counts[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  }
+  std::vector<size_t> stamps(vertex_count, 0);
+  std::vector<bool> emitted(mesh.triangles.size(), false);
+  std::vector<std::uint32_t> dead_ends;
+  std::vector<std::uint32_t> candidates;
+  std::vector<glm::uvec3> result;
+  result.reserve(mesh.triangles.size());
+  size_t time = cache_size + 1;
+  std::uint32_t cursor = 0;
+
+  auto fanning = vertex_count > 0 ? 0 : NO_VERTEX;
+  while (fanning != NO_VERTEX) {
+    candidates.clear();
+    for (
+      auto a = adjacency.offsets[fanning];
+      a < adjacency.offsets[fanning + 1];
+      ++a
+    ) {
+      auto t = adjacency.triangles[a];
+      if (emitted[t]) {
+        continue;
+      }
+      const auto& triangle = mesh.triangles[t];
+      for (int k = 0; k < 3; ++k) {
+        auto vertex = triangle[k];
+        dead_ends.push_back(vertex);
+        candidates.push_back(vertex);
+        --live_counts[vertex];
+        if (time - stamps[vertex] > cache_size) {
+          stamps[vertex] = time++;
+        }
+      }
+      emitted[t] = true;
+      result.push_back(triangle);
+    }
+
+    // The oldest candidate that stays in the cache while fanning around it.
+    fanning = NO_VERTEX;
+    long best_priority = -1;
+    for (auto vertex: candidates) {
+      if (live_counts[vertex] == 0) {
+        continue;
+      }
+      long priority = 0;
+      if (time - stamps[vertex] + 2 * live_counts[vertex] <= cache_size) {
+        priority = static_cast<long>(time - stamps[vertex]);
+      }
+      if (priority > best_priority) {
+        fanning = vertex;
+        best_priority = priority;
+      }
+    }
+    while (fanning == NO_VERTEX && !dead_ends.empty()) {
+      auto vertex = dead_ends.back();
+      dead_ends.pop_back();
+      if (live_counts[vertex] > 0) {
+        fanning = vertex;
+      }
+    }
+    while (fanning == NO_VERTEX && cursor < vertex_count) {
+      if (live_counts[cursor] > 0) {
+        fanning = cursor;
+      }
+      ++cursor;
+    }
+  }
+  mesh.triangles = std::move(result);
+}
+
+void optimize_overdraw(mesh& mesh, size_t cache_size, float threshold) {
+  DS_TRACE_ZONE("optimize_overdraw");
+  if (mesh.triangles.empty()) {
+    return;
+  }
+  auto clusters = get_clusters(mesh, cache_size, threshold);
+  glm::vec3 center;
+  float total_area = 0;
+  for (const auto& triangle: mesh.triangles) {
+    auto area = glm::length(get_scaled_normal(mesh, triangle));
+    center += get_centroid(mesh, triangle) * area;
+    total_area += area;
+  }
+  if (total_area > 0) {
+    center /= total_area;
+  }
+
+  // Clusters far out along their normal are on the outside of the mesh.
+  for (auto& cluster: clusters) {
+    glm::vec3 normal;
+    glm::vec3 centroid;
+    float area = 0;
+    for (auto t = cluster.begin; t < cluster.end; ++t) {
+      auto scaled_normal = get_scaled_normal(mesh, mesh.triangles[t]);
+      auto triangle_area = glm::length(scaled_normal);
+      normal += scaled_normal;
+      centroid += get_centroid(mesh, mesh.triangles[t]) * triangle_area;
+      area += triangle_area;
+    }
+    auto length = glm::length(normal);
+    if (area > 0 && length > 0) {
+      cluster.sort_key = glm::dot(centroid / area - center, normal / length);
+    }
+  }
+  std::stable_sort(
+    clusters.begin(),
+    clusters.end(),
+    [](const cluster& left, const cluster& right) {
+      return left.sort_key > right.sort_key;
+    }
+  );
+
+  std::vector<glm::uvec3> result;
+  result.reserve(mesh.triangles.size());
+  for (const auto& cluster: clusters) {
+    result.insert(
+      result.end(),
+      mesh.triangles.begin() + cluster.begin,
+      mesh.triangles.begin() + cluster.end
+    );
+  }
+  mesh.triangles = std::move(result);
+}
+
+std::vector<std::uint32_t> optimize_vertex_fetch(mesh& mesh) {
+  DS_TRACE_ZONE("optimize_vertex_fetch");
+  std::vector<std::uint32_t> remap(mesh.vertices.size(), NO_VERTEX);
+  std::vector<std::uint32_t> result;
+  result.reserve(mesh.vertices.size());
+  for (auto& triangle: mesh.triangles) {
+    for (int k = 0; k < 3; ++k) {
+      auto& vertex = remap[triangle[k]];
+      if (vertex == NO_VERTEX) {
+        vertex = static_cast<std::uint32_t>(result.size());
+        result.push_back(triangle[k]);
+      }
+      triangle[k] = vertex;
+    }
+  }
+  // Unused vertices go last.
+  for (size_t v = 0; v < remap.size(); ++v) {
+    if (remap[v] == NO_VERTEX) {
+      result.push_back(static_cast<std::uint32_t>(v));
+    }
+  }
+  std::vector<vertex> vertices(mesh.vertices.size());
+  for (size_t v = 0; v < result.size(); ++v) {
+    vertices[v] = mesh.vertices[result[v]];
+  }
+  mesh.vertices = std::move(vertices);
+  return result;
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "mesh.h"
+#include <cstdint>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Entries of the post-transform cache assumed by the optimizations. Actual
+ * GPUs don't behave as a FIFO of a fixed size, but orders that do well with
+ * 16 entries do well on all of them.
+ */
+const size_t VERTEX_CACHE_SIZE = 16;
+
+/**
+ * Triangles using each vertex, `triangles[offsets[v]]` to
+ * `triangles[offsets[v + 1]]` excluded.
+ */
+struct vertex_adjacency {
+  std::vector<std::uint32_t> offsets;
+  std::vector<std::uint32_t> triangles;
+};
+
+vertex_adjacency get_vertex_adjacency(const mesh& mesh);
+
+struct vertex_cache_stats {
+  /**
+   * Average cache miss ratio: vertices transformed per triangle, between 0.5
+   * for an ideal order on a large grid and 3.
+   */
+  float acmr;
+  /**
+   * Average transform to vertex ratio: how many times each vertex gets
+   * transformed, 1 at best.
+   */
+  float atvr;
+};
+
+/**
+ * Simulate drawing the triangles in order through a FIFO cache of
+ * `cache_size` entries.
+ */
+vertex_cache_stats get_vertex_cache_stats(
+  const std::vector<glm::uvec3>& triangles,
+  size_t vertex_count,
+  size_t cache_size
+);
+
+/**
+ * Reorder the triangles so that consecutive ones reuse vertices still in the
+ * cache, with the Tipsify algorithm (Sander et al. 2007): fan around a
+ * vertex, then move on to the vertex of the fan that is the most recent in
+ * the cache and still has triangles left, as long as it would stay in the
+ * cache for all of them. Linear time.
+ */
+void optimize_vertex_cache(mesh& mesh, size_t cache_size);
+
+/**
+ * Reorder clusters of triangles, without breaking their order inside each
+ * of them, so that those facing outwards from the center of the mesh come
+ * first and occlude the others (also from Sander et al.). Clusters end
+ * where the cache starts over anyway, and wherever the miss ratio of the
+ * cluster so far is within `threshold` times that of the whole mesh, ex.
+ * 1.05, so that it changes little overall. Meant to run after
+ * `optimize_vertex_cache()`.
+ */
+void optimize_overdraw(mesh& mesh, size_t cache_size, float threshold);
+
+/**
+ * Reorder the vertices in the order the triangles first use them, so that
+ * they get fetched sequentially. Return the former index of each vertex, to
+ * reorder any data kept alongside them.
+ */
+std::vector<std::uint32_t> optimize_vertex_fetch(mesh& mesh);
+
+}
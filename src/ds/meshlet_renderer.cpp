@@ -0,0 +1,176 @@
+#include "meshlet_renderer.h"
+#include "trace.h"
+#include <algorithm>
+
+namespace ds {
+
+namespace {
+
+/**
+ * Attributes are made of 16-bit components.
+ */
+const size_t VERTEX_ALIGNMENT = 4;
+
+}
+
+meshlet_renderer::meshlet_renderer(
+  planet_mesh mesh,
+  glpp::program& program,
+  glpp::buffer_arena& arena
+):
+  meshlets_(std::move(mesh.meshlets)),
+  inner_radius_(mesh.inner_radius),
+  heights_(mesh.heights),
+  ocean_altitude_(mesh.ocean_altitude),
+  cache_stats_(mesh.cache_stats),
+  unoptimized_cache_stats_(mesh.unoptimized_cache_stats),
+  vertex_count_(mesh.vertex_count),
+  triangle_count_(mesh.index_count / 3),
+  program_(program),
+  arena_(arena),
+  vertices_(arena.allocate(
+    mesh.vertex_count * sizeof(packed_vertex),
+    VERTEX_ALIGNMENT
+  )),
+  indices_(arena.allocate(mesh.index_count, 1)),
+  height_range_uniform_(program.get_uniform_location("HeightRange")),
+  ocean_altitude_uniform_(program.get_uniform_location("OceanAltitude")),
+  palette_uniform_(program.get_uniform_location("Palette")),
+  palette_range_uniform_(program.get_uniform_location("PaletteRange")),
+  pending_(std::move(mesh)),
+  uploaded_bytes_(0),
+  submitted_triangle_count_(0) {
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glpp::state::bind_buffer(GL_ARRAY_BUFFER, vertices_.buffer);
+  set_packed_vertex_attribs(program, vertices_.offset);
+  glpp::state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, indices_.buffer);
+  glpp::state::bind_vertex_array(0);
+  glpp::state::bind_texture(GL_TEXTURE_2D, palette_.handles()[0]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  {
+    DS_TRACE_ZONE("upload_palette");
+    auto palette = get_planet_palette(ocean_altitude_);
+    glTexImage2D(
+      GL_TEXTURE_2D,
+      0,
+      GL_RGBA8,
+      PALETTE_ALTITUDE_SIZE,
+      PALETTE_LATITUDE_SIZE,
+      0,
+      GL_RGBA,
+      GL_UNSIGNED_BYTE,
+      palette.texels.data()
+    );
+  }
+
+  visible_.reserve(meshlets_.size());
+  counts_.reserve(meshlets_.size());
+  offsets_.reserve(meshlets_.size());
+  base_vertices_.reserve(meshlets_.size());
+}
+
+meshlet_renderer::~meshlet_renderer() {
+  arena_.free(vertices_);
+  arena_.free(indices_);
+}
+
+bool meshlet_renderer::upload(size_t budget) {
+  const auto vertex_bytes = vertex_count_ * sizeof(packed_vertex);
+  const auto total_bytes = vertex_bytes + triangle_count_ * 3;
+  if (uploaded_bytes_ == total_bytes) {
+    return true;
+  }
+  DS_TRACE_ZONE("upload_planet_mesh");
+  // The copy target doesn't touch the element buffer binding of whatever
+  // vertex array is bound.
+  while (budget > 0 && uploaded_bytes_ < total_bytes) {
+    auto in_vertices = uploaded_bytes_ < vertex_bytes;
+    auto offset =
+      in_vertices ? uploaded_bytes_ : uploaded_bytes_ - vertex_bytes;
+    auto size = std::min(
+      budget,
+      (in_vertices ? vertex_bytes : total_bytes) - uploaded_bytes_
+    );
+    const auto* source = in_vertices
+      ? reinterpret_cast<const std::uint8_t*>(pending_.vertices)
+      : pending_.indices;
+    const auto& target = in_vertices ? vertices_ : indices_;
+    glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, target.buffer);
+    glBufferSubData(
+      GL_COPY_WRITE_BUFFER,
+      target.offset + offset,
+      size,
+      source + offset
+    );
+    uploaded_bytes_ += size;
+    budget -= size;
+  }
+  glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+  if (uploaded_bytes_ < total_bytes) {
+    return false;
+  }
+  pending_ = planet_mesh();
+  return true;
+}
+
+void meshlet_renderer::update(
+  const glm::vec3& camera,
+  const glm::mat4& model_view_projection,
+  bool cull
+) {
+  visible_.clear();
+  if (cull) {
+    cull_meshlets(
+      meshlets_,
+      inner_radius_,
+      camera,
+      culling::get_frustum(model_view_projection),
+      visible_
+    );
+  } else {
+    for (size_t i = 0; i < meshlets_.size(); ++i) {
+      visible_.push_back(static_cast<std::uint32_t>(i));
+    }
+  }
+  counts_.clear();
+  offsets_.clear();
+  base_vertices_.clear();
+  submitted_triangle_count_ = 0;
+  for (auto i: visible_) {
+    const auto& meshlet = meshlets_[i];
+    counts_.push_back(static_cast<GLsizei>(meshlet.triangle_count * 3));
+    offsets_.push_back(reinterpret_cast<const GLvoid*>(
+      indices_.offset + static_cast<size_t>(meshlet.triangle_offset) * 3
+    ));
+    base_vertices_.push_back(static_cast<GLint>(meshlet.vertex_offset));
+    submitted_triangle_count_ += meshlet.triangle_count;
+  }
+}
+
+void meshlet_renderer::draw() {
+  program_.use();
+  program_.uniform_2f(height_range_uniform_, heights_.min, heights_.max);
+  program_.uniform_1f(ocean_altitude_uniform_, ocean_altitude_);
+  program_.uniform_2f(
+    palette_range_uniform_,
+    ocean_altitude_ + PALETTE_MIN_ALTITUDE,
+    ocean_altitude_ + PALETTE_MAX_ALTITUDE
+  );
+  glpp::state::active_texture(GL_TEXTURE0);
+  glpp::state::bind_texture(GL_TEXTURE_2D, palette_.handles()[0]);
+  program_.uniform_1i(palette_uniform_, 0);
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glMultiDrawElementsBaseVertex(
+    GL_TRIANGLES,
+    counts_.data(),
+    GL_UNSIGNED_BYTE,
+    offsets_.data(),
+    static_cast<GLsizei>(counts_.size()),
+    base_vertices_.data()
+  );
+}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "../glpp/buffer_arena.h"
+#include "../glpp/program.h"
+#include "../glpp/textures.h"
+#include "../glpp/vertex_arrays.h"
+#include "palette.h"
+#include "planet_mesh.h"
+#include <vector>
+
+namespace ds {
+
+/**
+ * Draw the planet mesh split in meshlets, skipping those that can't be seen
+ * with a single `glMultiDrawElementsBaseVertex`. Vertices are laid out
+ * meshlet after meshlet so that the 8-bit local indices can be used as is,
+ * with the offset of the meshlet as base vertex. Vertices are packed, see
+ * `ds::packed_vertex`, and get their color from the palette of the planet on
+ * the GPU.
+ *
+ * The program must have the attributes of `basic.vs`.
+ */
+class meshlet_renderer {
+public:
+  /**
+   * Allocate room for `mesh` in the arena, that must outlive the renderer.
+   * The mesh then gets uploaded by `upload()`.
+   */
+  meshlet_renderer(
+    planet_mesh mesh,
+    glpp::program& program,
+    glpp::buffer_arena& arena
+  );
+  ~meshlet_renderer();
+  meshlet_renderer(meshlet_renderer&) = delete;
+
+  /**
+   * Upload up to `budget` more bytes of the mesh, so that it can be spread
+   * over several frames while another one gets drawn. Return true once it
+   * is all uploaded, and the memory of the mesh freed. Only then can it be
+   * drawn.
+   */
+  bool upload(size_t budget);
+
+  /**
+   * Cull the meshlets for a camera at `camera`, in model space, that gets
+   * clip coordinates with `model_view_projection`. When `cull` is false,
+   * all the meshlets are kept.
+   */
+  void update(
+    const glm::vec3& camera,
+    const glm::mat4& model_view_projection,
+    bool cull
+  );
+
+  /**
+   * Draw the meshlets kept by the last update, with the program.
+   */
+  void draw();
+
+  size_t meshlet_count() const {
+    return meshlets_.size();
+  }
+
+  size_t triangle_count() const {
+    return triangle_count_;
+  }
+
+  /**
+   * See `meshlet_set::inner_radius`.
+   */
+  float inner_radius() const {
+    return inner_radius_;
+  }
+
+  /**
+   * Simulated vertex cache behavior of the meshlets as drawn, and as they
+   * were before being optimized.
+   */
+  const vertex_cache_stats& cache_stats() const {
+    return cache_stats_;
+  }
+
+  const vertex_cache_stats& unoptimized_cache_stats() const {
+    return unoptimized_cache_stats_;
+  }
+
+  size_t vertex_bytes() const {
+    return vertex_count_ * sizeof(packed_vertex);
+  }
+
+  size_t submitted_meshlet_count() const {
+    return visible_.size();
+  }
+
+  size_t submitted_triangle_count() const {
+    return submitted_triangle_count_;
+  }
+
+private:
+  std::vector<meshlet> meshlets_;
+  float inner_radius_;
+  height_range heights_;
+  float ocean_altitude_;
+  vertex_cache_stats cache_stats_;
+  vertex_cache_stats unoptimized_cache_stats_;
+  size_t vertex_count_;
+  size_t triangle_count_;
+  glpp::program& program_;
+  glpp::buffer_arena& arena_;
+  glpp::buffer_arena::range vertices_;
+  glpp::buffer_arena::range indices_;
+  glpp::textures<1> palette_;
+  GLint height_range_uniform_;
+  GLint ocean_altitude_uniform_;
+  GLint palette_uniform_;
+  GLint palette_range_uniform_;
+  glpp::vertex_arrays<1> vao_;
+  planet_mesh pending_;
+  size_t uploaded_bytes_;
+  std::vector<std::uint32_t> visible_;
+  std::vector<GLsizei> counts_;
+  std::vector<const GLvoid*> offsets_;
+  std::vector<GLint> base_vertices_;
+  size_t submitted_triangle_count_;
+};
+
+}
@@ -0,0 +1,319 @@
+#include "meshlets.h"
+#include "mesh_optimizer.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ds {
+
+namespace {
+
+const size_t NO_TRIANGLE = std::numeric_limits<size_t>::max();
+
+glm::vec3 get_centroid(const mesh& mesh, const glm::uvec3& triangle) {
+  return (
+    mesh.vertices[triangle.x].position +
+    mesh.vertices[triangle.y].position +
+    mesh.vertices[triangle.z].position
+  ) / 3.0f;
+}
+
+/**
+ * Zero-length for degenerate triangles.
+ */
+glm::vec3 get_normal(const mesh& mesh, const glm::uvec3& triangle) {
+  const auto& a = mesh.vertices[triangle.x].position;
+  const auto& b = mesh.vertices[triangle.y].position;
+  const auto& c = mesh.vertices[triangle.z].position;
+  auto normal = glm::cross(b - a, c - a);
+  auto length = glm::length(normal);
+  return length > 0 ? normal / length : glm::vec3();
+}
+
+/**
+ * The cone axis is the average normal, and the cutoff comes from the normal
+ * that is the furthest from it.
+ */
+void set_bounds(const mesh& mesh, const meshlet_set& set, meshlet& meshlet) {
+  glm::vec3 center;
+  for (size_t i = 0; i < meshlet.vertex_count; ++i) {
+    center += mesh.vertices[set.vertices[meshlet.vertex_offset + i]].position;
+  }
+  center /= static_cast<float>(meshlet.vertex_count);
+  float radius = 0;
+  for (size_t i = 0; i < meshlet.vertex_count; ++i) {
+    const auto& position =
+      mesh.vertices[set.vertices[meshlet.vertex_offset + i]].position;
+    radius = std::max(radius, glm::distance(position, center));
+  }
+  meshlet.center = center;
+  meshlet.radius = radius;
+
+  std::vector<glm::vec3> normals(meshlet.triangle_count);
+  glm::vec3 axis;
+  for (size_t i = 0; i < meshlet.triangle_count; ++i) {
+    const auto* local = &set.indices[(meshlet.triangle_offset + i) * 3];
+    glm::uvec3 triangle(
+      set.vertices[meshlet.vertex_offset + local[0]],
+      set.vertices[meshlet.vertex_offset + local[1]],
+      set.vertices[meshlet.vertex_offset + local[2]]
+    );
+    normals[i] = get_normal(mesh, triangle);
+    axis += normals[i];
+  }
+  auto length = glm::length(axis);
+  meshlet.cone_axis = length > 0 ? axis / length : glm::vec3(1, 0, 0);
+  meshlet.cone_cutoff = 1;
+  if (length == 0) {
+    return;
+  }
+  float min_dot = 1;
+  for (const auto& normal: normals) {
+    if (glm::length(normal) > 0) {
+      min_dot = std::min(min_dot, glm::dot(normal, meshlet.cone_axis));
+    }
+  }
+  if (min_dot > 0) {
+    meshlet.cone_cutoff = std::sqrt(1 - min_dot * min_dot);
+  }
+}
+
+/**
+ * A ray from the origin crosses the mesh on some triangle, no closer than
+ * the plane of that triangle.
+ */
+float get_inner_radius(const mesh& mesh) {
+  auto result = std::numeric_limits<float>::max();
+  for (const auto& triangle: mesh.triangles) {
+    auto normal = get_normal(mesh, triangle);
+    if (glm::length(normal) > 0) {
+      auto distance = glm::dot(normal, mesh.vertices[triangle.x].position);
+      result = std::min(result, std::abs(distance));
+    }
+  }
+  return mesh.triangles.empty() ? 0 : result;
+}
+
+}
+
+meshlet_set build_meshlets(const mesh& mesh) {
+  DS_TRACE_ZONE("build_meshlets");
+  const auto triangle_count = mesh.triangles.size();
+  auto adjacency = get_vertex_adjacency(mesh);
+  std::vector<bool> emitted(triangle_count, false);
+  // Index of each vertex within the meshlet being built, or -1.
+  std::vector<int> local(mesh.vertices.size(), -1);
+  meshlet_set result;
+  result.indices.reserve(triangle_count * 3);
+  result.inner_radius = get_inner_radius(mesh);
+
+  size_t seed = 0;
+  while (true) {
+    while (seed < triangle_count && emitted[seed]) {
+      ++seed;
+    }
+    if (seed == triangle_count) {
+      break;
+    }
+    meshlet current = {};
+    current.vertex_offset = static_cast<std::uint32_t>(result.vertices.size());
+    current.triangle_offset =
+      static_cast<std::uint32_t>(result.indices.size() / 3);
+    glm::vec3 position_sum;
+    auto add_triangle = [&](size_t t) {
+      for (int k = 0; k < 3; ++k) {
+        auto vertex = mesh.triangles[t][k];
+        if (local[vertex] < 0) {
+          local[vertex] = static_cast<int>(current.vertex_count++);
+          result.vertices.push_back(vertex);
+          position_sum += mesh.vertices[vertex].position;
+        }
+        result.indices.push_back(static_cast<std::uint8_t>(local[vertex]));
+      }
+      emitted[t] = true;
+      ++current.triangle_count;
+    };
+    add_triangle(seed);
+
+    while (current.triangle_count < MESHLET_MAX_TRIANGLES) {
+      auto center = position_sum / static_cast<float>(current.vertex_count);
+      auto best = NO_TRIANGLE;
+      size_t best_new_count = 0;
+      float best_distance = 0;
+      for (auto i = current.vertex_offset; i < result.vertices.size(); ++i) {
+        auto vertex = result.vertices[i];
+        for (
+          auto a = adjacency.offsets[vertex];
+          a < adjacency.offsets[vertex + 1];
+          ++a
+        ) {
+          auto t = adjacency.triangles[a];
+          if (emitted[t]) {
+            continue;
+          }
+          const auto& triangle = mesh.triangles[t];
+          size_t new_count = 0;
+          for (int k = 0; k < 3; ++k) {
+            new_count += local[triangle[k]] < 0 ? 1 : 0;
+          }
+          if (current.vertex_count + new_count > MESHLET_MAX_VERTICES) {
+            continue;
+          }
+          auto distance = glm::distance(get_centroid(mesh, triangle), center);
+          if (
+            best == NO_TRIANGLE ||
+            new_count < best_new_count ||
+            (new_count == best_new_count && distance < best_distance)
+          ) {
+            best = t;
+            best_new_count = new_count;
+            best_distance = distance;
+          }
+        }
+      }
+      if (best == NO_TRIANGLE) {
+        break;
+      }
+      add_triangle(best);
+    }
+
+    for (auto i = current.vertex_offset; i < result.vertices.size(); ++i) {
+      local[result.vertices[i]] = -1;
+    }
+    set_bounds(mesh, result, current);
+    result.meshlets.push_back(current);
+  }
+  return result;
+}
+
+void optimize_meshlets(meshlet_set& set, const mesh& mesh) {
+  DS_TRACE_ZONE("optimize_meshlets");
+  ds::mesh local;
+  std::vector<std::uint32_t> vertices;
+  for (const auto& meshlet: set.meshlets) {
+    local.vertices.clear();
+    local.triangles.clear();
+    for (size_t i = 0; i < meshlet.vertex_count; ++i) {
+      local.vertices.push_back(
+        mesh.vertices[set.vertices[meshlet.vertex_offset + i]]
+      );
+    }
+    for (size_t i = 0; i < meshlet.triangle_count; ++i) {
+      const auto* indices = &set.indices[(meshlet.triangle_offset + i) * 3];
+      local.triangles.push_back(glm::uvec3(indices[0], indices[1], indices[2]));
+    }
+    optimize_vertex_cache(local, VERTEX_CACHE_SIZE);
+    auto order = optimize_vertex_fetch(local);
+
+    vertices.assign(
+      set.vertices.begin() + meshlet.vertex_offset,
+      set.vertices.begin() + meshlet.vertex_offset + meshlet.vertex_count
+    );
+    for (size_t i = 0; i < meshlet.vertex_count; ++i) {
+      set.vertices[meshlet.vertex_offset + i] = vertices[order[i]];
+    }
+    for (size_t i = 0; i < meshlet.triangle_count; ++i) {
+      auto* indices = &set.indices[(meshlet.triangle_offset + i) * 3];
+      for (int k = 0; k < 3; ++k) {
+        indices[k] = static_cast<std::uint8_t>(local.triangles[i][k]);
+      }
+    }
+  }
+
+  glm::vec3 center;
+  for (const auto& meshlet: set.meshlets) {
+    center += meshlet.center;
+  }
+  if (!set.meshlets.empty()) {
+    center /= static_cast<float>(set.meshlets.size());
+  }
+  std::stable_sort(
+    set.meshlets.begin(),
+    set.meshlets.end(),
+    [&center](const meshlet& left, const meshlet& right) {
+      return
+        glm::dot(left.center - center, left.cone_axis) >
+        glm::dot(right.center - center, right.cone_axis);
+    }
+  );
+
+  meshlet_set result;
+  result.meshlets.reserve(set.meshlets.size());
+  result.vertices.reserve(set.vertices.size());
+  result.indices.reserve(set.indices.size());
+  result.inner_radius = set.inner_radius;
+  for (auto meshlet: set.meshlets) {
+    auto vertex_offset = static_cast<std::uint32_t>(result.vertices.size());
+    auto triangle_offset =
+      static_cast<std::uint32_t>(result.indices.size() / 3);
+    result.vertices.insert(
+      result.vertices.end(),
+      set.vertices.begin() + meshlet.vertex_offset,
+      set.vertices.begin() + meshlet.vertex_offset + meshlet.vertex_count
+    );
+    auto indices = set.indices.begin() + meshlet.triangle_offset * 3;
+    result.indices.insert(
+      result.indices.end(),
+      indices,
+      indices + meshlet.triangle_count * 3
+    );
+    meshlet.vertex_offset = vertex_offset;
+    meshlet.triangle_offset = triangle_offset;
+    result.meshlets.push_back(meshlet);
+  }
+  set = std::move(result);
+}
+
+vertex_cache_stats get_vertex_cache_stats(
+  const meshlet_set& set,
+  size_t cache_size
+) {
+  std::vector<glm::uvec3> triangles;
+  triangles.reserve(set.indices.size() / 3);
+  for (const auto& meshlet: set.meshlets) {
+    for (size_t i = 0; i < meshlet.triangle_count; ++i) {
+      const auto* indices = &set.indices[(meshlet.triangle_offset + i) * 3];
+      triangles.push_back(glm::uvec3(
+        meshlet.vertex_offset + indices[0],
+        meshlet.vertex_offset + indices[1],
+        meshlet.vertex_offset + indices[2]
+      ));
+    }
+  }
+  return get_vertex_cache_stats(triangles, set.vertices.size(), cache_size);
+}
+
+void cull_meshlets(
+  const std::vector<meshlet>& meshlets,
+  float inner_radius,
+  const glm::vec3& camera,
+  const culling::frustum& frustum,
+  std::vector<std::uint32_t>& result
+) {
+  DS_TRACE_ZONE("cull_meshlets");
+  for (size_t i = 0; i < meshlets.size(); ++i) {
+    const auto& meshlet = meshlets[i];
+    if (
+      culling::is_backfacing(
+        camera,
+        meshlet.center,
+        meshlet.radius,
+        meshlet.cone_axis,
+        meshlet.cone_cutoff
+      ) ||
+      culling::is_outside_frustum(frustum, meshlet.center, meshlet.radius) ||
+      culling::is_below_horizon(
+        camera,
+        inner_radius,
+        meshlet.center,
+        meshlet.radius
+      )
+    ) {
+      continue;
+    }
+    result.push_back(static_cast<std::uint32_t>(i));
+  }
+}
+
+}
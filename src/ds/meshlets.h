@@ -0,0 +1,96 @@
+#pragma once
+#include "culling.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include <cstdint>
+#include <vector>
+
+namespace ds {
+
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+/**
+ * A small cluster of neighbouring triangles, that gets culled as a whole.
+ */
+struct meshlet {
+  /**
+   * First vertex in `meshlet_set::vertices`, and the number of them.
+   */
+  std::uint32_t vertex_offset;
+  std::uint32_t vertex_count;
+  /**
+   * First triangle in `meshlet_set::indices`, counted in triangles.
+   */
+  std::uint32_t triangle_offset;
+  std::uint32_t triangle_count;
+  /**
+   * Bounding sphere of the vertices.
+   */
+  glm::vec3 center;
+  float radius;
+  /**
+   * All the triangle normals are within this cone, see
+   * `culling::is_backfacing()`.
+   */
+  glm::vec3 cone_axis;
+  float cone_cutoff;
+};
+
+struct meshlet_set {
+  std::vector<meshlet> meshlets;
+  /**
+   * Indices into the original mesh vertices, meshlet after meshlet. Vertices
+   * shared across meshlets appear once for each of them.
+   */
+  std::vector<std::uint32_t> vertices;
+  /**
+   * Three per triangle, local to the meshlet: `vertices[vertex_offset + i]`
+   * is the vertex `i` of a meshlet.
+   */
+  std::vector<std::uint8_t> indices;
+  /**
+   * Radius of a sphere centered on the origin that the mesh fully encloses,
+   * provided any ray from the origin crosses it once, as for planets.
+   */
+  float inner_radius;
+};
+
+/**
+ * Split the mesh into meshlets. Each one grows from a seed triangle by
+ * adding, of the triangles sharing a vertex with it, the one that brings in
+ * the fewest new vertices, and then the closest one to its center, until it
+ * hits one of the limits.
+ */
+meshlet_set build_meshlets(const mesh& mesh);
+
+/**
+ * Reorder the triangles of each meshlet for the vertex cache, and its
+ * vertices to match. Then reorder the meshlets themselves, those facing
+ * outwards first against overdraw, and lay them out in that order.
+ */
+void optimize_meshlets(meshlet_set& set, const mesh& mesh);
+
+/**
+ * Simulate drawing all the meshlets in order, as in one draw call.
+ */
+vertex_cache_stats get_vertex_cache_stats(
+  const meshlet_set& set,
+  size_t cache_size
+);
+
+/**
+ * Append to `result` the index of the meshlets that may be visible from
+ * `camera`, in model space: those that are not entirely backfacing, outside
+ * the frustum, or below the horizon of the sphere of `inner_radius`, see
+ * `meshlet_set`.
+ */
+void cull_meshlets(
+  const std::vector<meshlet>& meshlets,
+  float inner_radius,
+  const glm::vec3& camera,
+  const culling::frustum& frustum,
+  std::vector<std::uint32_t>& result
+);
+
+}
@@ -0,0 +1,482 @@
+#include "noise_terrain.h"
+#include "run_split.h"
+#include "soa_positions.h"
+#include "trace.h"
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DS_NOISE_TERRAIN_X86 1
+#endif
+
+namespace ds {
+
+namespace {
+
+/**
+ * Skewing factors between space and the simplex grid in 3D.
+ */
+const float F3 = 1.0f / 3.0f;
+const float G3 = 1.0f / 6.0f;
+const float G3_2 = 2.0f / 6.0f;
+const float G3_3 = 3.0f / 6.0f;
+
+/**
+ * Scales the sum of the corner contributions to about [-1, 1].
+ */
+const float SIMPLEX_SCALE = 32;
+
+const float LACUNARITY = 2;
+const float GAIN = 0.5f;
+
+const size_t CONTINENT_OCTAVES = 6;
+const float CONTINENT_FREQUENCY = 1.2f;
+const float CONTINENT_AMPLITUDE = 0.06f;
+
+const size_t RIDGE_OCTAVES = 5;
+const float RIDGE_FREQUENCY = 3;
+const float RIDGE_AMPLITUDE = 0.03f;
+
+/**
+ * Decorrelate octaves and layers, that otherwise share the same lattice.
+ */
+const std::uint32_t OCTAVE_SEED_STEP = 0x9e3779b9u;
+const std::uint32_t RIDGE_SEED = 0x85ebca6bu;
+
+const std::uint32_t HASH_X = 0x8da6b343u;
+const std::uint32_t HASH_Y = 0xd8163841u;
+const std::uint32_t HASH_Z = 0xcb1ab31fu;
+const std::uint32_t HASH_MIX = 0x2c1b3c6du;
+
+/**
+ * Points evaluated together by a single call to a block kernel, the width
+ * of AVX2 registers.
+ */
+const size_t BLOCK_SIZE = 8;
+
+std::uint32_t hash(
+  std::int32_t i,
+  std::int32_t j,
+  std::int32_t k,
+  std::uint32_t seed
+) {
+  std::uint32_t h = seed;
+  h ^= static_cast<std::uint32_t>(i) * HASH_X;
+  h ^= static_cast<std::uint32_t>(j) * HASH_Y;
+  h ^= static_cast<std::uint32_t>(k) * HASH_Z;
+  h ^= h >> 15;
+  h *= HASH_MIX;
+  h ^= h >> 12;
+  return h;
+}
+
+/**
+ * Dot product with one of 12 gradients, the middles of the edges of a
+ * cube, picked by the low bits of the hash.
+ */
+float gradient(std::uint32_t hash, float x, float y, float z) {
+  auto h = hash & 15;
+  float u = h < 8 ? x : y;
+  float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+  return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+/**
+ * Here and below, one product per statement, so that the compiler is not
+ * allowed to contract them into fused multiply-adds on the instruction sets
+ * that have them. This is what keeps heights identical across platforms and
+ * to the vectorized kernel.
+ */
+float get_corner(std::uint32_t hash, float x, float y, float z) {
+  float xx = x * x;
+  float yy = y * y;
+  float zz = z * z;
+  float t = 0.6f - xx;
+  t -= yy;
+  t -= zz;
+  float t2 = t * t;
+  float n = t2 * t2 * gradient(hash, x, y, z);
+  return t < 0 ? 0 : n;
+}
+
+float get_simplex(float x, float y, float z, std::uint32_t seed) {
+  float s = (x + y + z) * F3;
+  auto i = static_cast<std::int32_t>(std::floor(x + s));
+  auto j = static_cast<std::int32_t>(std::floor(y + s));
+  auto k = static_cast<std::int32_t>(std::floor(z + s));
+  float t = static_cast<float>(i + j + k) * G3;
+  float x0 = x - (static_cast<float>(i) - t);
+  float y0 = y - (static_cast<float>(j) - t);
+  float z0 = z - (static_cast<float>(k) - t);
+
+  // Which simplex of the skewed cube the point is in, without branches so
+  // that it matches the vectorized version.
+  bool xy = x0 >= y0;
+  bool xz = x0 >= z0;
+  bool yz = y0 >= z0;
+  std::int32_t i1 = xy && xz;
+  std::int32_t j1 = !xy && yz;
+  std::int32_t k1 = !xz && !yz;
+  std::int32_t i2 = xy || xz;
+  std::int32_t j2 = !xy || yz;
+  std::int32_t k2 = !(xz && yz);
+
+  float x1 = (x0 - static_cast<float>(i1)) + G3;
+  float y1 = (y0 - static_cast<float>(j1)) + G3;
+  float z1 = (z0 - static_cast<float>(k1)) + G3;
+  float x2 = (x0 - static_cast<float>(i2)) + G3_2;
+  float y2 = (y0 - static_cast<float>(j2)) + G3_2;
+  float z2 = (z0 - static_cast<float>(k2)) + G3_2;
+  float x3 = (x0 - 1.0f) + G3_3;
+  float y3 = (y0 - 1.0f) + G3_3;
+  float z3 = (z0 - 1.0f) + G3_3;
+
+  float n = get_corner(hash(i, j, k, seed), x0, y0, z0);
+  n += get_corner(hash(i + i1, j + j1, k + k1, seed), x1, y1, z1);
+  n += get_corner(hash(i + i2, j + j2, k + k2, seed), x2, y2, z2);
+  n += get_corner(hash(i + 1, j + 1, k + 1, seed), x3, y3, z3);
+  return n * SIMPLEX_SCALE;
+}
+
+float get_height_scalar(float x, float y, float z, std::uint32_t seed) {
+  float continent = 0;
+  float amplitude = 1;
+  float frequency = CONTINENT_FREQUENCY;
+  for (size_t octave = 0; octave < CONTINENT_OCTAVES; ++octave) {
+    float n = get_simplex(
+      x * frequency,
+      y * frequency,
+      z * frequency,
+      seed + static_cast<std::uint32_t>(octave) * OCTAVE_SEED_STEP
+    );
+    float octave_height = amplitude * n;
+    continent += octave_height;
+    amplitude *= GAIN;
+    frequency *= LACUNARITY;
+  }
+
+  float ridges = 0;
+  amplitude = 1;
+  frequency = RIDGE_FREQUENCY;
+  for (size_t octave = 0; octave < RIDGE_OCTAVES; ++octave) {
+    float ridge = 1 - std::fabs(get_simplex(
+      x * frequency,
+      y * frequency,
+      z * frequency,
+      (seed ^ RIDGE_SEED) +
+        static_cast<std::uint32_t>(octave) * OCTAVE_SEED_STEP
+    ));
+    float ridge_2 = ridge * ridge;
+    float octave_height = amplitude * ridge_2;
+    ridges += octave_height;
+    amplitude *= GAIN;
+    frequency *= LACUNARITY;
+  }
+
+  // Mountains rise on land only, more so inland.
+  float land = continent > 0 ? continent : 0;
+  float base = CONTINENT_AMPLITUDE * continent;
+  float mountains = RIDGE_AMPLITUDE * ridges;
+  mountains *= land;
+  return base + mountains;
+}
+
+typedef void (*block_kernel)(std::uint32_t, float*, float*, float*);
+
+void displace_block_scalar(
+  std::uint32_t seed,
+  float* xs,
+  float* ys,
+  float* zs
+) {
+  for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+    float radius = 1 + get_height_scalar(xs[i], ys[i], zs[i], seed);
+    xs[i] *= radius;
+    ys[i] *= radius;
+    zs[i] *= radius;
+  }
+}
+
+#ifdef DS_NOISE_TERRAIN_X86
+
+/**
+ * The vectorized versions below mirror the scalar ones operation by
+ * operation. Masks are all ones for true, as comparisons return them.
+ */
+
+__attribute__((target("avx2")))
+__m256i hash_avx2(__m256i i, __m256i j, __m256i k, __m256i seed) {
+  __m256i h = seed;
+  h = _mm256_xor_si256(h, _mm256_mullo_epi32(i, _mm256_set1_epi32(HASH_X)));
+  h = _mm256_xor_si256(h, _mm256_mullo_epi32(j, _mm256_set1_epi32(HASH_Y)));
+  h = _mm256_xor_si256(h, _mm256_mullo_epi32(k, _mm256_set1_epi32(HASH_Z)));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+  h = _mm256_mullo_epi32(h, _mm256_set1_epi32(HASH_MIX));
+  h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+  return h;
+}
+
+__attribute__((target("avx2")))
+__m256 gradient_avx2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+  __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+  __m256 below_8 =
+    _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+  __m256 below_4 =
+    _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+  __m256 is_12_or_14 = _mm256_castsi256_ps(_mm256_or_si256(
+    _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+    _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))
+  ));
+  __m256 u = _mm256_blendv_ps(y, x, below_8);
+  __m256 v = _mm256_blendv_ps(
+    _mm256_blendv_ps(z, x, is_12_or_14),
+    y,
+    below_4
+  );
+  // Negating is flipping the sign bit.
+  __m256 sign_u = _mm256_castsi256_ps(
+    _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31)
+  );
+  __m256 sign_v = _mm256_castsi256_ps(
+    _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30)
+  );
+  return _mm256_add_ps(_mm256_xor_ps(u, sign_u), _mm256_xor_ps(v, sign_v));
+}
+
+__attribute__((target("avx2")))
+__m256 get_corner_avx2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+  __m256 t = _mm256_sub_ps(
+    _mm256_sub_ps(
+      _mm256_sub_ps(_mm256_set1_ps(0.6f), _mm256_mul_ps(x, x)),
+      _mm256_mul_ps(y, y)
+    ),
+    _mm256_mul_ps(z, z)
+  );
+  __m256 t2 = _mm256_mul_ps(t, t);
+  __m256 n = _mm256_mul_ps(
+    _mm256_mul_ps(t2, t2),
+    gradient_avx2(hash, x, y, z)
+  );
+  __m256 negative = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_LT_OQ);
+  return _mm256_andnot_ps(negative, n);
+}
+
+/**
+ * `v - 1 + g` where `mask` is set, `v + g` elsewhere.
+ */
+__attribute__((target("avx2")))
+__m256 offset(__m256 v, __m256i mask, float g) {
+  __m256 step = _mm256_and_ps(_mm256_castsi256_ps(mask), _mm256_set1_ps(1));
+  return _mm256_add_ps(_mm256_sub_ps(v, step), _mm256_set1_ps(g));
+}
+
+__attribute__((target("avx2")))
+__m256 get_simplex_avx2(__m256 x, __m256 y, __m256 z, __m256i seed) {
+  const __m256i ones = _mm256_set1_epi32(-1);
+  __m256 s = _mm256_mul_ps(
+    _mm256_add_ps(_mm256_add_ps(x, y), z),
+    _mm256_set1_ps(F3)
+  );
+  __m256i i = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(x, s)));
+  __m256i j = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(y, s)));
+  __m256i k = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(z, s)));
+  __m256 t = _mm256_mul_ps(
+    _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(i, j), k)),
+    _mm256_set1_ps(G3)
+  );
+  __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+  __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+  __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(_mm256_cvtepi32_ps(k), t));
+
+  __m256i xy = _mm256_castps_si256(_mm256_cmp_ps(x0, y0, _CMP_GE_OQ));
+  __m256i xz = _mm256_castps_si256(_mm256_cmp_ps(x0, z0, _CMP_GE_OQ));
+  __m256i yz = _mm256_castps_si256(_mm256_cmp_ps(y0, z0, _CMP_GE_OQ));
+  __m256i i1 = _mm256_and_si256(xy, xz);
+  __m256i j1 = _mm256_andnot_si256(xy, yz);
+  __m256i k1 = _mm256_andnot_si256(_mm256_or_si256(xz, yz), ones);
+  __m256i i2 = _mm256_or_si256(xy, xz);
+  __m256i j2 = _mm256_or_si256(_mm256_andnot_si256(xy, ones), yz);
+  __m256i k2 = _mm256_andnot_si256(_mm256_and_si256(xz, yz), ones);
+
+  __m256 x1 = offset(x0, i1, G3);
+  __m256 y1 = offset(y0, j1, G3);
+  __m256 z1 = offset(z0, k1, G3);
+  __m256 x2 = offset(x0, i2, G3_2);
+  __m256 y2 = offset(y0, j2, G3_2);
+  __m256 z2 = offset(z0, k2, G3_2);
+  __m256 x3 = offset(x0, ones, G3_3);
+  __m256 y3 = offset(y0, ones, G3_3);
+  __m256 z3 = offset(z0, ones, G3_3);
+
+  // Masks are -1 where the offset is 1.
+  __m256 n = get_corner_avx2(hash_avx2(i, j, k, seed), x0, y0, z0);
+  n = _mm256_add_ps(n, get_corner_avx2(
+    hash_avx2(
+      _mm256_sub_epi32(i, i1),
+      _mm256_sub_epi32(j, j1),
+      _mm256_sub_epi32(k, k1),
+      seed
+    ),
+    x1, y1, z1
+  ));
+  n = _mm256_add_ps(n, get_corner_avx2(
+    hash_avx2(
+      _mm256_sub_epi32(i, i2),
+      _mm256_sub_epi32(j, j2),
+      _mm256_sub_epi32(k, k2),
+      seed
+    ),
+    x2, y2, z2
+  ));
+  n = _mm256_add_ps(n, get_corner_avx2(
+    hash_avx2(
+      _mm256_sub_epi32(i, ones),
+      _mm256_sub_epi32(j, ones),
+      _mm256_sub_epi32(k, ones),
+      seed
+    ),
+    x3, y3, z3
+  ));
+  return _mm256_mul_ps(n, _mm256_set1_ps(SIMPLEX_SCALE));
+}
+
+__attribute__((target("avx2")))
+void displace_block_avx2(
+  std::uint32_t seed,
+  float* xs,
+  float* ys,
+  float* zs
+) {
+  __m256 x = _mm256_loadu_ps(xs);
+  __m256 y = _mm256_loadu_ps(ys);
+  __m256 z = _mm256_loadu_ps(zs);
+
+  __m256 continent = _mm256_setzero_ps();
+  float amplitude = 1;
+  float frequency = CONTINENT_FREQUENCY;
+  for (size_t octave = 0; octave < CONTINENT_OCTAVES; ++octave) {
+    __m256 f = _mm256_set1_ps(frequency);
+    __m256 n = get_simplex_avx2(
+      _mm256_mul_ps(x, f),
+      _mm256_mul_ps(y, f),
+      _mm256_mul_ps(z, f),
+      _mm256_set1_epi32(
+        seed + static_cast<std::uint32_t>(octave) * OCTAVE_SEED_STEP
+      )
+    );
+    continent = _mm256_add_ps(
+      continent,
+      _mm256_mul_ps(_mm256_set1_ps(amplitude), n)
+    );
+    amplitude *= GAIN;
+    frequency *= LACUNARITY;
+  }
+
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  __m256 ridges = _mm256_setzero_ps();
+  amplitude = 1;
+  frequency = RIDGE_FREQUENCY;
+  for (size_t octave = 0; octave < RIDGE_OCTAVES; ++octave) {
+    __m256 f = _mm256_set1_ps(frequency);
+    __m256 n = get_simplex_avx2(
+      _mm256_mul_ps(x, f),
+      _mm256_mul_ps(y, f),
+      _mm256_mul_ps(z, f),
+      _mm256_set1_epi32(
+        (seed ^ RIDGE_SEED) + static_cast<std::uint32_t>(octave) *
+          OCTAVE_SEED_STEP
+      )
+    );
+    __m256 ridge =
+      _mm256_sub_ps(_mm256_set1_ps(1), _mm256_andnot_ps(sign, n));
+    ridges = _mm256_add_ps(
+      ridges,
+      _mm256_mul_ps(_mm256_set1_ps(amplitude), _mm256_mul_ps(ridge, ridge))
+    );
+    amplitude *= GAIN;
+    frequency *= LACUNARITY;
+  }
+
+  // `max` returns its second operand unless the first is greater, as the
+  // scalar comparison does.
+  __m256 land = _mm256_max_ps(continent, _mm256_setzero_ps());
+  __m256 height = _mm256_add_ps(
+    _mm256_mul_ps(_mm256_set1_ps(CONTINENT_AMPLITUDE), continent),
+    _mm256_mul_ps(
+      _mm256_mul_ps(_mm256_set1_ps(RIDGE_AMPLITUDE), ridges),
+      land
+    )
+  );
+  __m256 radius = _mm256_add_ps(_mm256_set1_ps(1), height);
+  _mm256_storeu_ps(xs, _mm256_mul_ps(x, radius));
+  _mm256_storeu_ps(ys, _mm256_mul_ps(y, radius));
+  _mm256_storeu_ps(zs, _mm256_mul_ps(z, radius));
+}
+
+#endif
+
+block_kernel get_block_kernel(terrain_kernel kernel) {
+#ifdef DS_NOISE_TERRAIN_X86
+  if (
+    kernel == terrain_kernel::SIMD &&
+    __builtin_cpu_supports("avx2")
+  ) {
+    return displace_block_avx2;
+  }
+#endif
+  return displace_block_scalar;
+}
+
+void run_blocks(
+  block_kernel kernel,
+  std::uint32_t seed,
+  const soa_positions& positions,
+  size_t first_block,
+  size_t last_block
+) {
+  DS_TRACE_ZONE("noise_terrain_blocks");
+  for (size_t block = first_block; block < last_block; ++block) {
+    auto offset = block * BLOCK_SIZE;
+    kernel(
+      seed,
+      positions.x + offset,
+      positions.y + offset,
+      positions.z + offset
+    );
+  }
+}
+
+}
+
+float noise_terrain::get_height(const glm::vec3& direction) const {
+  return get_height_scalar(direction.x, direction.y, direction.z, seed_);
+}
+
+void noise_terrain::displace(
+  terrain_kernel kernel,
+  std::vector<vertex>& vertices,
+  size_t thread_count,
+  scratch_arena& scratch
+) const {
+  DS_TRACE_ZONE("noise_terrain");
+  scratch_arena::scope scope(scratch);
+  auto block_count = (vertices.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  auto positions =
+    split_positions(vertices, block_count * BLOCK_SIZE, scratch);
+
+  if (kernel == terrain_kernel::REFERENCE) {
+    thread_count = 1;
+  }
+  auto block_kernel = get_block_kernel(kernel);
+  auto seed = seed_;
+  run_split(
+    block_count,
+    get_thread_count(thread_count, block_count),
+    [block_kernel, seed, &positions](size_t first, size_t last) {
+      run_blocks(block_kernel, seed, positions, first, last);
+    }
+  );
+
+  merge_positions(positions, vertices);
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "mesh.h"
+#include "scratch_arena.h"
+#include "terrain_kernel.h"
+#include <cstdint>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Terrain made of seeded 3D simplex noise: fBm for the continents, plus
+ * ridged noise for the mountains on top of them. Unlike plane cuts, any
+ * point of the surface costs the same few octaves to evaluate, whatever
+ * the resolution of the mesh, so single points can be looked up on demand.
+ *
+ * Results are bit-for-bit identical whatever the kernel, the instruction
+ * set and the thread count: the vectorized code does the same operations in
+ * the same order as the scalar one, without FMA.
+ */
+class noise_terrain {
+public:
+  noise_terrain(): seed_(0) {}
+  noise_terrain(std::uint32_t seed): seed_(seed) {}
+
+  /**
+   * Height above the unit sphere at `direction`, of length 1. It stays
+   * within about 0.2 of it.
+   */
+  float get_height(const glm::vec3& direction) const;
+
+  /**
+   * Move points of the unit sphere to the surface. `REFERENCE` evaluates
+   * one point at a time; `SIMD` evaluates 8 at a time with AVX2 when the
+   * CPU has it, and splits them across `thread_count` threads (zero means
+   * one per hardware thread). The arrays come from `scratch`.
+   */
+  void displace(
+    terrain_kernel kernel,
+    std::vector<vertex>& vertices,
+    size_t thread_count,
+    scratch_arena& scratch
+  ) const;
+
+private:
+  std::uint32_t seed_;
+};
+
+}
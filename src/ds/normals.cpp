@@ -0,0 +1,86 @@
+#include "normals.h"
+#include "run_split.h"
+#include "trace.h"
+
+namespace ds {
+
+namespace {
+
+void compute_triangle_normals(
+  const mesh& mesh,
+  glm::vec3* normals,
+  size_t first,
+  size_t last
+) {
+  DS_TRACE_ZONE("triangle_normals");
+  for (size_t t = first; t < last; ++t) {
+    const auto& triangle = mesh.triangles[t];
+    const auto& a = mesh.vertices[triangle.x].position;
+    const auto& b = mesh.vertices[triangle.y].position;
+    const auto& c = mesh.vertices[triangle.z].position;
+    // Twice the area of the triangle.
+    normals[t] = glm::cross(b - a, c - a);
+  }
+}
+
+void gather_vertex_normals(
+  const vertex_adjacency& adjacency,
+  const glm::vec3* normals,
+  std::vector<vertex>& vertices,
+  size_t first,
+  size_t last
+) {
+  DS_TRACE_ZONE("gather_vertex_normals");
+  for (size_t v = first; v < last; ++v) {
+    glm::vec3 sum;
+    for (auto i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; ++i) {
+      sum += normals[adjacency.triangles[i]];
+    }
+    auto& vertex = vertices[v];
+    auto length = glm::length(sum);
+    if (length > 0) {
+      vertex.normal = sum / length;
+    } else {
+      vertex.normal = glm::normalize(vertex.position);
+    }
+  }
+}
+
+/**
+ * Below that many triangles per thread, starting threads costs more than
+ * it saves.
+ */
+const size_t MIN_TRIANGLES_PER_THREAD = 4096;
+
+}
+
+void compute_normals(
+  mesh& mesh,
+  const vertex_adjacency& adjacency,
+  size_t thread_count,
+  scratch_arena& scratch
+) {
+  DS_TRACE_ZONE("compute_normals");
+  thread_count = get_thread_count(
+    thread_count,
+    mesh.triangles.size() / MIN_TRIANGLES_PER_THREAD
+  );
+  scratch_arena::scope scope(scratch);
+  auto normals = scratch.allocate<glm::vec3>(mesh.triangles.size());
+  run_split(
+    mesh.triangles.size(),
+    thread_count,
+    [&mesh, normals](size_t first, size_t last) {
+      compute_triangle_normals(mesh, normals, first, last);
+    }
+  );
+  run_split(
+    mesh.vertices.size(),
+    thread_count,
+    [&adjacency, normals, &mesh](size_t first, size_t last) {
+      gather_vertex_normals(adjacency, normals, mesh.vertices, first, last);
+    }
+  );
+}
+
+}
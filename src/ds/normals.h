@@ -0,0 +1,27 @@
+#pragma once
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "scratch_arena.h"
+
+namespace ds {
+
+/**
+ * Set each normal to the area-weighted average of the normals of the
+ * triangles around the vertex. Triangle normals get computed first, then
+ * each vertex gathers those of its triangles, so that threads never write
+ * to the same place. Both passes are split across `thread_count` threads
+ * (zero means one per hardware thread), with the triangle normals in
+ * `scratch`. Vertices without any area around keep pointing away from the
+ * origin.
+ *
+ * The adjacency only depends on the topology, so it can be kept across
+ * terrain edits.
+ */
+void compute_normals(
+  mesh& mesh,
+  const vertex_adjacency& adjacency,
+  size_t thread_count,
+  scratch_arena& scratch
+);
+
+}
@@ -0,0 +1,185 @@
+#include "ocean_renderer.h"
+#include "icosphere.h"
+#include "palette.h"
+#include "trace.h"
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace ds {
+
+namespace {
+
+/**
+ * Fine enough that few fragments outside of the ocean get shaded, and low
+ * enough for its tables to be compile-time constants, uploaded as is.
+ */
+typedef icosphere<3> proxy_sphere;
+
+glm::vec3 get_position(const proxy_sphere::tables& tables, unsigned index) {
+  const auto& position = tables.positions[index];
+  return glm::vec3(position[0], position[1], position[2]);
+}
+
+/**
+ * How much the unit geodesic sphere must be scaled up for its faces to be
+ * all outside of the unit sphere: the inverse distance of the closest face
+ * plane to the center.
+ */
+float get_circumscribing_scale(const proxy_sphere::tables& tables) {
+  float distance = 1;
+  for (const auto& triangle: tables.triangles) {
+    auto a = get_position(tables, triangle[0]);
+    auto b = get_position(tables, triangle[1]);
+    auto c = get_position(tables, triangle[2]);
+    auto normal = glm::normalize(glm::cross(b - a, c - a));
+    distance = std::min(distance, std::abs(glm::dot(normal, a)));
+  }
+  return 1 / distance;
+}
+
+void set_texture_parameters() {
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+}
+
+ocean_renderer::ocean_renderer(
+  const planet_mesh& mesh,
+  glpp::program& program,
+  glpp::buffer_arena& arena
+):
+  ocean_altitude_(mesh.ocean_altitude),
+  heights_(mesh.heights),
+  program_(program),
+  arena_(arena),
+  model_uniform_(program.get_uniform_location("Model")),
+  view_uniform_(program.get_uniform_location("View")),
+  projection_uniform_(program.get_uniform_location("Projection")),
+  camera_uniform_(program.get_uniform_location("Camera")),
+  radii_uniform_(program.get_uniform_location("Radii")),
+  height_range_uniform_(program.get_uniform_location("HeightRange")),
+  sea_floor_uniform_(program.get_uniform_location("SeaFloor")),
+  palette_uniform_(program.get_uniform_location("Palette")),
+  palette_range_uniform_(program.get_uniform_location("PaletteRange")) {
+  DS_TRACE_ZONE("upload_ocean");
+  const auto& sphere = proxy_sphere::get_tables();
+  proxy_radius_ = ocean_altitude_ * get_circumscribing_scale(sphere);
+  index_count_ = proxy_sphere::triangle_count * 3;
+  vertices_ = arena.allocate(sizeof(sphere.positions), sizeof(float));
+  indices_ = arena.allocate(sizeof(sphere.triangles), sizeof(unsigned));
+  glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, vertices_.buffer);
+  glBufferSubData(
+    GL_COPY_WRITE_BUFFER,
+    vertices_.offset,
+    sizeof(sphere.positions),
+    sphere.positions
+  );
+  glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, indices_.buffer);
+  glBufferSubData(
+    GL_COPY_WRITE_BUFFER,
+    indices_.offset,
+    sizeof(sphere.triangles),
+    sphere.triangles
+  );
+  glpp::state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glpp::state::bind_buffer(GL_ARRAY_BUFFER, vertices_.buffer);
+  GLint location = program.get_attrib_location("position");
+  glVertexAttribPointer(
+    location,
+    3,
+    GL_FLOAT,
+    GL_FALSE,
+    sizeof(sphere.positions[0]),
+    reinterpret_cast<void*>(vertices_.offset)
+  );
+  glEnableVertexAttribArray(location);
+  glpp::state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, indices_.buffer);
+  glpp::state::bind_vertex_array(0);
+
+  glpp::state::bind_texture(GL_TEXTURE_2D, textures_.handles()[0]);
+  set_texture_parameters();
+  auto palette = get_planet_palette(ocean_altitude_);
+  glTexImage2D(
+    GL_TEXTURE_2D,
+    0,
+    GL_RGBA8,
+    PALETTE_ALTITUDE_SIZE,
+    PALETTE_LATITUDE_SIZE,
+    0,
+    GL_RGBA,
+    GL_UNSIGNED_BYTE,
+    palette.texels.data()
+  );
+  glpp::state::bind_texture(GL_TEXTURE_2D, textures_.handles()[1]);
+  set_texture_parameters();
+  glTexImage2D(
+    GL_TEXTURE_2D,
+    0,
+    GL_R16,
+    SEA_FLOOR_SIZE,
+    SEA_FLOOR_SIZE,
+    0,
+    GL_RED,
+    GL_UNSIGNED_SHORT,
+    mesh.sea_floor.data()
+  );
+}
+
+ocean_renderer::~ocean_renderer() {
+  arena_.free(vertices_);
+  arena_.free(indices_);
+}
+
+void ocean_renderer::draw(
+  const glm::vec3& camera,
+  const glm::mat4& model,
+  const glm::mat4& view,
+  const glm::mat4& projection
+) {
+  program_.use();
+  program_.uniform_matrix_4fv(model_uniform_, glm::value_ptr(model));
+  program_.uniform_matrix_4fv(view_uniform_, glm::value_ptr(view));
+  program_.uniform_matrix_4fv(
+    projection_uniform_,
+    glm::value_ptr(projection)
+  );
+  program_.uniform_3fv(camera_uniform_, glm::value_ptr(camera));
+  program_.uniform_2f(radii_uniform_, ocean_altitude_, proxy_radius_);
+  program_.uniform_2f(height_range_uniform_, heights_.min, heights_.max);
+  program_.uniform_2f(
+    palette_range_uniform_,
+    ocean_altitude_ + PALETTE_MIN_ALTITUDE,
+    ocean_altitude_ + PALETTE_MAX_ALTITUDE
+  );
+  glpp::state::active_texture(GL_TEXTURE0);
+  glpp::state::bind_texture(GL_TEXTURE_2D, textures_.handles()[0]);
+  program_.uniform_1i(palette_uniform_, 0);
+  glpp::state::active_texture(GL_TEXTURE1);
+  glpp::state::bind_texture(GL_TEXTURE_2D, textures_.handles()[1]);
+  program_.uniform_1i(sea_floor_uniform_, 1);
+  glpp::state::active_texture(GL_TEXTURE0);
+
+  // From within the proxy, only its far side can be rasterized.
+  auto inside = glm::length(camera) < proxy_radius_;
+  if (inside) {
+    glCullFace(GL_FRONT);
+  }
+  glpp::state::bind_vertex_array(vao_.handles()[0]);
+  glDrawElements(
+    GL_TRIANGLES,
+    static_cast<GLsizei>(index_count_),
+    GL_UNSIGNED_INT,
+    reinterpret_cast<void*>(indices_.offset)
+  );
+  glpp::state::bind_vertex_array(0);
+  if (inside) {
+    glCullFace(GL_BACK);
+  }
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "../glpp/buffer_arena.h"
+#include "../glpp/program.h"
+#include "../glpp/textures.h"
+#include "../glpp/vertex_arrays.h"
+#include "planet_mesh.h"
+
+namespace ds {
+
+/**
+ * Draw the ocean of a planet as an exact sphere, rather than as terrain
+ * clamped to the ocean level. A coarse geodesic sphere just large enough
+ * to contain it gets rasterized, then each fragment intersects its view ray
+ * with the ocean sphere and writes the depth of the hit. The ocean is tinted
+ * by the depth of the sea floor, see `planet_mesh::sea_floor`.
+ *
+ * It is meant to be drawn before the terrain, so that the submerged parts
+ * of the terrain fail the depth test early.
+ *
+ * The program must have the attributes and uniforms of `ocean.vs` and
+ * `ocean.fs`.
+ */
+class ocean_renderer {
+public:
+  /**
+   * The arena must outlive the renderer.
+   */
+  ocean_renderer(
+    const planet_mesh& mesh,
+    glpp::program& program,
+    glpp::buffer_arena& arena
+  );
+  ~ocean_renderer();
+  ocean_renderer(ocean_renderer&) = delete;
+
+  /**
+   * Draw with the camera at `camera`, in model space. The transforms are
+   * those of the terrain.
+   */
+  void draw(
+    const glm::vec3& camera,
+    const glm::mat4& model,
+    const glm::mat4& view,
+    const glm::mat4& projection
+  );
+
+  size_t triangle_count() const {
+    return index_count_ / 3;
+  }
+
+private:
+  float ocean_altitude_;
+  float proxy_radius_;
+  height_range heights_;
+  size_t index_count_;
+  glpp::program& program_;
+  glpp::buffer_arena& arena_;
+  glpp::buffer_arena::range vertices_;
+  glpp::buffer_arena::range indices_;
+  glpp::textures<2> textures_;
+  GLint model_uniform_;
+  GLint view_uniform_;
+  GLint projection_uniform_;
+  GLint camera_uniform_;
+  GLint radii_uniform_;
+  GLint height_range_uniform_;
+  GLint sea_floor_uniform_;
+  GLint palette_uniform_;
+  GLint palette_range_uniform_;
+  glpp::vertex_arrays<1> vao_;
+};
+
+}
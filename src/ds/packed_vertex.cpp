@@ -0,0 +1,134 @@
+#include "packed_vertex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace ds {
+
+namespace {
+
+float sign_not_zero(float value) {
+  return value >= 0 ? 1.0f : -1.0f;
+}
+
+/**
+ * Components are all unsigned normalized, see `packed_vertex`.
+ */
+void set_attrib_pointer(
+  glpp::program& program,
+  const char* name,
+  GLint size,
+  size_t offset
+) {
+  GLint location = program.get_attrib_location(name);
+  glVertexAttribPointer(
+    location,
+    size,
+    GL_UNSIGNED_SHORT,
+    GL_TRUE,
+    sizeof(packed_vertex),
+    reinterpret_cast<void*>(offset)
+  );
+  glEnableVertexAttribArray(location);
+}
+
+std::uint16_t quantize(float value) {
+  auto clamped = std::min(std::max(value, 0.0f), 1.0f);
+  return static_cast<std::uint16_t>(std::lround(clamped * 0xffff));
+}
+
+/**
+ * From [-1, 1] to [0, 1].
+ */
+float to_unorm(float value) {
+  return value * 0.5f + 0.5f;
+}
+
+void pack_octahedral(const glm::vec3& direction, std::uint16_t* result) {
+  auto coordinates = encode_octahedral(direction);
+  result[0] = quantize(to_unorm(coordinates.x));
+  result[1] = quantize(to_unorm(coordinates.y));
+}
+
+}
+
+height_range get_height_range(const std::vector<float>& heights) {
+  if (heights.empty()) {
+    return {0, 1};
+  }
+  height_range result = {heights[0], heights[0]};
+  for (auto height: heights) {
+    result.min = std::min(result.min, height);
+    result.max = std::max(result.max, height);
+  }
+  return result;
+}
+
+glm::vec2 encode_octahedral(const glm::vec3& direction) {
+  auto norm =
+    std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+  glm::vec2 result(direction.x / norm, direction.y / norm);
+  if (direction.z < 0) {
+    return glm::vec2(
+      (1 - std::abs(result.y)) * sign_not_zero(result.x),
+      (1 - std::abs(result.x)) * sign_not_zero(result.y)
+    );
+  }
+  return result;
+}
+
+glm::vec3 decode_octahedral(const glm::vec2& coordinates) {
+  glm::vec3 result(
+    coordinates.x,
+    coordinates.y,
+    1 - std::abs(coordinates.x) - std::abs(coordinates.y)
+  );
+  if (result.z < 0) {
+    auto x = result.x;
+    result.x = (1 - std::abs(result.y)) * sign_not_zero(x);
+    result.y = (1 - std::abs(x)) * sign_not_zero(result.y);
+  }
+  return glm::normalize(result);
+}
+
+std::uint16_t pack_height(float height, const height_range& range) {
+  auto span = range.max - range.min;
+  return quantize(span > 0 ? (height - range.min) / span : 0.0f);
+}
+
+packed_vertex pack_vertex(
+  const glm::vec3& position,
+  float height,
+  const glm::vec3& normal,
+  const height_range& range
+) {
+  packed_vertex result;
+  pack_octahedral(position / glm::length(position), result.direction);
+  pack_octahedral(glm::normalize(normal), result.normal);
+  result.height = pack_height(height, range);
+  result.padding = 0;
+  return result;
+}
+
+void set_packed_vertex_attribs(glpp::program& program, size_t offset) {
+  set_attrib_pointer(
+    program,
+    "direction",
+    2,
+    offset + offsetof(packed_vertex, direction)
+  );
+  set_attrib_pointer(
+    program,
+    "normal",
+    2,
+    offset + offsetof(packed_vertex, normal)
+  );
+  set_attrib_pointer(
+    program,
+    "height",
+    1,
+    offset + offsetof(packed_vertex, height)
+  );
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "../glpp/program.h"
+#include "mesh.h"
+#include <cstdint>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Compact vertex format for the GPU, 12 bytes instead of 24 for a
+ * `ds::vertex`. Positions are a direction and a height between
+ * `height_range::min` and `max`, for meshes that are a displaced sphere.
+ *
+ * Only unsigned normalized formats are used: signed ones decode differently
+ * before and after OpenGL 4.2, and macOS is stuck at 4.1.
+ */
+struct packed_vertex {
+  /**
+   * Octahedral coordinates of the direction of the position, as
+   * `GL_UNSIGNED_SHORT` mapped from [-1, 1] to [0, 1].
+   */
+  std::uint16_t direction[2];
+  /**
+   * Octahedral coordinates of the normal, the same way.
+   */
+  std::uint16_t normal[2];
+  /**
+   * Distance from the origin, as `GL_UNSIGNED_SHORT` mapped from the height
+   * range to [0, 1]. The planet stores its altitudes before they get clamped
+   * to the ocean level, and leaves the clamping to the shader.
+   */
+  std::uint16_t height;
+  std::uint16_t padding;
+};
+
+static_assert(sizeof(packed_vertex) == 12, "packed vertices must be tight");
+
+struct height_range {
+  float min;
+  float max;
+};
+
+height_range get_height_range(const std::vector<float>& heights);
+
+/**
+ * Map a unit vector to the unit square, by projecting it on the octahedron
+ * then unfolding the lower half. Components are in [-1, 1].
+ */
+glm::vec2 encode_octahedral(const glm::vec3& direction);
+glm::vec3 decode_octahedral(const glm::vec2& coordinates);
+
+/**
+ * Map `height` from the range to the full span of 16 bits, clamped.
+ */
+std::uint16_t pack_height(float height, const height_range& range);
+
+/**
+ * Only the direction of `position` is kept, with `height` as its distance
+ * from the origin.
+ */
+packed_vertex pack_vertex(
+  const glm::vec3& position,
+  float height,
+  const glm::vec3& normal,
+  const height_range& range
+);
+
+/**
+ * Point the `direction`, `normal` and `height` attributes of `program` at
+ * packed vertices starting at `offset` in the bound `GL_ARRAY_BUFFER`. The
+ * vertex array to set them up for must be bound.
+ */
+void set_packed_vertex_attribs(glpp::program& program, size_t offset);
+
+}
@@ -0,0 +1,63 @@
+#include "palette.h"
+#include "planet.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ds {
+
+namespace {
+
+const glm::vec3 ICE_COLOR(0.85f, 0.9f, 0.95f);
+
+/**
+ * Sine of the latitude where ice starts at the ocean level, and where it
+ * covers everything. Ice reaches lower latitudes in the mountains.
+ */
+const float ICE_START = 0.88f;
+const float ICE_END = 0.94f;
+const float ICE_ALTITUDE_FACTOR = 1.5f;
+
+float smoothstep(float edge0, float edge1, float x) {
+  auto t = std::min(std::max((x - edge0) / (edge1 - edge0), 0.0f), 1.0f);
+  return t * t * (3 - 2 * t);
+}
+
+std::uint8_t to_unorm8(float value) {
+  auto clamped = std::min(std::max(value, 0.0f), 1.0f);
+  return static_cast<std::uint8_t>(std::lround(clamped * 255));
+}
+
+}
+
+palette get_planet_palette(float ocean_altitude) {
+  DS_TRACE_ZONE("planet_palette");
+  palette result;
+  result.texels.resize(PALETTE_ALTITUDE_SIZE * PALETTE_LATITUDE_SIZE * 4);
+  for (size_t i = 0; i < PALETTE_LATITUDE_SIZE; ++i) {
+    auto latitude = std::abs(
+      (static_cast<float>(i) + 0.5f) / PALETTE_LATITUDE_SIZE * 2 - 1
+    );
+    for (size_t j = 0; j < PALETTE_ALTITUDE_SIZE; ++j) {
+      auto altitude = PALETTE_MIN_ALTITUDE +
+        (static_cast<float>(j) + 0.5f) / PALETTE_ALTITUDE_SIZE *
+        (PALETTE_MAX_ALTITUDE - PALETTE_MIN_ALTITUDE);
+      auto color =
+        get_altitude_color(ocean_altitude, ocean_altitude + altitude);
+      auto ice = smoothstep(
+        ICE_START,
+        ICE_END,
+        latitude + std::max(altitude, 0.0f) * ICE_ALTITUDE_FACTOR
+      );
+      color = color * (1 - ice) + ICE_COLOR * ice;
+      auto* texel = &result.texels[(i * PALETTE_ALTITUDE_SIZE + j) * 4];
+      texel[0] = to_unorm8(color.x);
+      texel[1] = to_unorm8(color.y);
+      texel[2] = to_unorm8(color.z);
+      texel[3] = 0xff;
+    }
+  }
+  return result;
+}
+
+}
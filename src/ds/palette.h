@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ds {
+
+const size_t PALETTE_ALTITUDE_SIZE = 256;
+const size_t PALETTE_LATITUDE_SIZE = 64;
+
+/**
+ * Altitudes covered by the palette, relative to the ocean level. The colors
+ * of the edges extend beyond.
+ */
+const float PALETTE_MIN_ALTITUDE = -0.1f;
+const float PALETTE_MAX_ALTITUDE = 0.1f;
+
+/**
+ * Colors of the surface as a 2D texture, for the shaders to look up the color
+ * of a vertex from its altitude and latitude instead of storing it. Rows go
+ * from the south to the north pole, by the sine of the latitude, and texels
+ * from `PALETTE_MIN_ALTITUDE` to `PALETTE_MAX_ALTITUDE`.
+ */
+struct palette {
+  /**
+   * RGBA, 8 bits per component.
+   */
+  std::vector<std::uint8_t> texels;
+};
+
+/**
+ * The colors of `get_altitude_color()`, with ice caps towards the poles.
+ */
+palette get_planet_palette(float ocean_altitude);
+
+}
@@ -0,0 +1,295 @@
+#include "plane_cuts.h"
+#include "run_split.h"
+#include "soa_positions.h"
+#include "trace.h"
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DS_PLANE_CUTS_X86 1
+#endif
+
+namespace ds {
+
+namespace {
+
+void mod_altitude(glm::vec3& position, float amount) {
+  auto length = glm::length(position);
+  position *= (length + amount) / length;
+}
+
+void apply_plane_cuts_reference(
+  const std::vector<plane_cut>& cuts,
+  float amount,
+  std::vector<vertex>& vertices
+) {
+  for (const auto& cut: cuts) {
+    for (auto& vertex: vertices) {
+      if (glm::dot(vertex.position, cut.normal) >= cut.distance) {
+        mod_altitude(vertex.position, amount);
+      } else {
+        mod_altitude(vertex.position, -amount);
+      }
+    }
+  }
+}
+
+/**
+ * Number of vertices processed together by a single call to a block kernel.
+ * It is a multiple of every SIMD width, and large enough for several
+ * independent registers to hide the latency of the square root and division.
+ */
+const size_t BLOCK_SIZE = 32;
+
+struct soa_cuts {
+  std::vector<float> normal_x;
+  std::vector<float> normal_y;
+  std::vector<float> normal_z;
+  std::vector<float> distance;
+};
+
+typedef void (*block_kernel)(const soa_cuts&, float, float*, float*, float*);
+
+#ifndef DS_PLANE_CUTS_X86
+
+/**
+ * All the operations below are done in the exact same order as `glm::dot`,
+ * `glm::length` and `mod_altitude`, one product per statement so that the
+ * compiler is not allowed to contract them into fused multiply-adds. This is
+ * what makes the results bit-for-bit identical to the reference kernel.
+ */
+void cut_block_scalar(
+  const soa_cuts& cuts,
+  float amount,
+  float* xs,
+  float* ys,
+  float* zs
+) {
+  const auto cut_count = cuts.distance.size();
+  for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+    float x = xs[i], y = ys[i], z = zs[i];
+    for (size_t c = 0; c < cut_count; ++c) {
+      float dot_x = x * cuts.normal_x[c];
+      float dot_y = y * cuts.normal_y[c];
+      float dot_z = z * cuts.normal_z[c];
+      float dot = dot_x + dot_y + dot_z;
+      float sq_x = x * x;
+      float sq_y = y * y;
+      float sq_z = z * z;
+      float length = std::sqrt(sq_x + sq_y + sq_z);
+      float delta = dot >= cuts.distance[c] ? amount : -amount;
+      float scale = (length + delta) / length;
+      x *= scale;
+      y *= scale;
+      z *= scale;
+    }
+    xs[i] = x;
+    ys[i] = y;
+    zs[i] = z;
+  }
+}
+
+#else
+
+/**
+ * The operations are done in the exact same order as `glm::dot`,
+ * `glm::length` and `mod_altitude`, and SIMD square roots and divisions are
+ * correctly rounded, so the results are bit-for-bit identical to the
+ * reference kernel.
+ */
+void cut_block_sse(
+  const soa_cuts& cuts,
+  float amount,
+  float* xs,
+  float* ys,
+  float* zs
+) {
+  const size_t LANES = 4;
+  const size_t REGS = BLOCK_SIZE / LANES;
+  __m128 x[REGS], y[REGS], z[REGS];
+  for (size_t r = 0; r < REGS; ++r) {
+    x[r] = _mm_loadu_ps(xs + r * LANES);
+    y[r] = _mm_loadu_ps(ys + r * LANES);
+    z[r] = _mm_loadu_ps(zs + r * LANES);
+  }
+  const __m128 up = _mm_set1_ps(amount);
+  const __m128 down = _mm_set1_ps(-amount);
+  const auto cut_count = cuts.distance.size();
+  for (size_t c = 0; c < cut_count; ++c) {
+    const __m128 normal_x = _mm_set1_ps(cuts.normal_x[c]);
+    const __m128 normal_y = _mm_set1_ps(cuts.normal_y[c]);
+    const __m128 normal_z = _mm_set1_ps(cuts.normal_z[c]);
+    const __m128 distance = _mm_set1_ps(cuts.distance[c]);
+    for (size_t r = 0; r < REGS; ++r) {
+      __m128 dot = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(x[r], normal_x), _mm_mul_ps(y[r], normal_y)),
+        _mm_mul_ps(z[r], normal_z)
+      );
+      __m128 length = _mm_sqrt_ps(_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(x[r], x[r]), _mm_mul_ps(y[r], y[r])),
+        _mm_mul_ps(z[r], z[r])
+      ));
+      __m128 above = _mm_cmpge_ps(dot, distance);
+      __m128 delta = _mm_or_ps(
+        _mm_and_ps(above, up),
+        _mm_andnot_ps(above, down)
+      );
+      __m128 scale = _mm_div_ps(_mm_add_ps(length, delta), length);
+      x[r] = _mm_mul_ps(x[r], scale);
+      y[r] = _mm_mul_ps(y[r], scale);
+      z[r] = _mm_mul_ps(z[r], scale);
+    }
+  }
+  for (size_t r = 0; r < REGS; ++r) {
+    _mm_storeu_ps(xs + r * LANES, x[r]);
+    _mm_storeu_ps(ys + r * LANES, y[r]);
+    _mm_storeu_ps(zs + r * LANES, z[r]);
+  }
+}
+
+/**
+ * Same as the SSE version, 8 lanes wide. Note the target does not include
+ * FMA, that would break the equivalence with the reference kernel.
+ */
+__attribute__((target("avx2")))
+void cut_block_avx2(
+  const soa_cuts& cuts,
+  float amount,
+  float* xs,
+  float* ys,
+  float* zs
+) {
+  const size_t LANES = 8;
+  const size_t REGS = BLOCK_SIZE / LANES;
+  __m256 x[REGS], y[REGS], z[REGS];
+  for (size_t r = 0; r < REGS; ++r) {
+    x[r] = _mm256_loadu_ps(xs + r * LANES);
+    y[r] = _mm256_loadu_ps(ys + r * LANES);
+    z[r] = _mm256_loadu_ps(zs + r * LANES);
+  }
+  const __m256 up = _mm256_set1_ps(amount);
+  const __m256 down = _mm256_set1_ps(-amount);
+  const auto cut_count = cuts.distance.size();
+  for (size_t c = 0; c < cut_count; ++c) {
+    const __m256 normal_x = _mm256_set1_ps(cuts.normal_x[c]);
+    const __m256 normal_y = _mm256_set1_ps(cuts.normal_y[c]);
+    const __m256 normal_z = _mm256_set1_ps(cuts.normal_z[c]);
+    const __m256 distance = _mm256_set1_ps(cuts.distance[c]);
+    for (size_t r = 0; r < REGS; ++r) {
+      __m256 dot = _mm256_add_ps(
+        _mm256_add_ps(
+          _mm256_mul_ps(x[r], normal_x),
+          _mm256_mul_ps(y[r], normal_y)
+        ),
+        _mm256_mul_ps(z[r], normal_z)
+      );
+      __m256 length = _mm256_sqrt_ps(_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(x[r], x[r]), _mm256_mul_ps(y[r], y[r])),
+        _mm256_mul_ps(z[r], z[r])
+      ));
+      __m256 above = _mm256_cmp_ps(dot, distance, _CMP_GE_OQ);
+      __m256 delta = _mm256_blendv_ps(down, up, above);
+      __m256 scale = _mm256_div_ps(_mm256_add_ps(length, delta), length);
+      x[r] = _mm256_mul_ps(x[r], scale);
+      y[r] = _mm256_mul_ps(y[r], scale);
+      z[r] = _mm256_mul_ps(z[r], scale);
+    }
+  }
+  for (size_t r = 0; r < REGS; ++r) {
+    _mm256_storeu_ps(xs + r * LANES, x[r]);
+    _mm256_storeu_ps(ys + r * LANES, y[r]);
+    _mm256_storeu_ps(zs + r * LANES, z[r]);
+  }
+}
+
+#endif
+
+block_kernel get_block_kernel() {
+#ifdef DS_PLANE_CUTS_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return cut_block_avx2;
+  }
+  return cut_block_sse;
+#else
+  return cut_block_scalar;
+#endif
+}
+
+void run_blocks(
+  block_kernel kernel,
+  const soa_cuts& cuts,
+  float amount,
+  const soa_positions& positions,
+  size_t first_block,
+  size_t last_block
+) {
+  DS_TRACE_ZONE("plane_cuts_blocks");
+  for (size_t block = first_block; block < last_block; ++block) {
+    auto offset = block * BLOCK_SIZE;
+    kernel(
+      cuts,
+      amount,
+      positions.x + offset,
+      positions.y + offset,
+      positions.z + offset
+    );
+  }
+}
+
+void apply_plane_cuts_simd(
+  const std::vector<plane_cut>& cuts,
+  float amount,
+  std::vector<vertex>& vertices,
+  size_t thread_count,
+  scratch_arena& scratch
+) {
+  soa_cuts columns;
+  columns.normal_x.reserve(cuts.size());
+  columns.normal_y.reserve(cuts.size());
+  columns.normal_z.reserve(cuts.size());
+  columns.distance.reserve(cuts.size());
+  for (const auto& cut: cuts) {
+    columns.normal_x.push_back(cut.normal.x);
+    columns.normal_y.push_back(cut.normal.y);
+    columns.normal_z.push_back(cut.normal.z);
+    columns.distance.push_back(cut.distance);
+  }
+
+  scratch_arena::scope scope(scratch);
+  auto block_count = (vertices.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  auto positions =
+    split_positions(vertices, block_count * BLOCK_SIZE, scratch);
+
+  auto kernel = get_block_kernel();
+  run_split(
+    block_count,
+    get_thread_count(thread_count, block_count),
+    [kernel, &columns, amount, &positions](size_t first, size_t last) {
+      run_blocks(kernel, columns, amount, positions, first, last);
+    }
+  );
+
+  merge_positions(positions, vertices);
+}
+
+}
+
+void apply_plane_cuts(
+  terrain_kernel kernel,
+  const std::vector<plane_cut>& cuts,
+  float amount,
+  std::vector<vertex>& vertices,
+  size_t thread_count,
+  scratch_arena& scratch
+) {
+  DS_TRACE_ZONE("plane_cuts");
+  switch (kernel) {
+    case terrain_kernel::REFERENCE:
+      apply_plane_cuts_reference(cuts, amount, vertices);
+      return;
+    case terrain_kernel::SIMD:
+      apply_plane_cuts_simd(cuts, amount, vertices, thread_count, scratch);
+      return;
+  }
+}
+
+}
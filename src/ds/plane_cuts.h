@@ -0,0 +1,40 @@
+#pragma once
+#include "mesh.h"
+#include "scratch_arena.h"
+#include "terrain_kernel.h"
+#include <vector>
+
+namespace ds {
+
+/**
+ * An infinite plane splitting the space in two halves: points `p` for which
+ * `dot(p, normal) >= distance` are on the positive side.
+ */
+struct plane_cut {
+  glm::vec3 normal;
+  float distance;
+};
+
+/**
+ * For each cut in order, push every vertex away from the origin by `amount`
+ * if it lies on the positive side of the plane, or pull it by the same amount
+ * otherwise. The side is tested against the position as displaced by all the
+ * previous cuts.
+ *
+ * `REFERENCE` is the straightforward plane-major loop. `SIMD` converts the
+ * positions to structure-of-arrays, runs all the cuts on blocks of vertices
+ * held in AVX2 or SSE registers, and splits the blocks across
+ * `thread_count` threads (zero means one per hardware thread). Both kernels
+ * produce bit-for-bit identical positions. The arrays come from `scratch`,
+ * and are given back before returning.
+ */
+void apply_plane_cuts(
+  terrain_kernel kernel,
+  const std::vector<plane_cut>& cuts,
+  float amount,
+  std::vector<vertex>& vertices,
+  size_t thread_count,
+  scratch_arena& scratch
+);
+
+}
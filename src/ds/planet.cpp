@@ -0,0 +1,225 @@
+#include "planet.h"
+#include "geodesic_sphere.h"
+#include "normals.h"
+#include "trace.h"
+#include <algorithm>
+#include <random>
+
+namespace ds {
+
+glm::vec3 get_gravity_center(const std::vector<vertex>& vertices) {
+  glm::vec3 result;
+  size_t weight = 0;
+  for (const auto& vertex: vertices) {
+    result = (result * static_cast<float>(weight) + vertex.position) /
+      static_cast<float>(weight + 1);
+    weight++;
+  }
+  return result;
+}
+
+glm::vec3 recenter_vertices(std::vector<vertex>& vertices) {
+  DS_TRACE_ZONE("recenter_vertices");
+  auto center = get_gravity_center(vertices);
+  for (auto& vertex: vertices) {
+    vertex.position -= center;
+  }
+  return center;
+}
+
+float get_average_altitude(std::vector<vertex>& vertices) {
+  DS_TRACE_ZONE("get_average_altitude");
+  float result = 0;
+  size_t weight = 0;
+  for (const auto& vertex: vertices) {
+    result =
+      (result * static_cast<float>(weight) + glm::length(vertex.position)) /
+      static_cast<float>(weight + 1);
+    weight++;
+  }
+  return result;
+}
+
+void shake_vertices(std::uint_fast32_t seed, std::vector<vertex>& vertices) {
+  DS_TRACE_ZONE("shake_vertices");
+  std::mt19937 mt(seed);
+  std::uniform_real_distribution<float> urd(-0.002f, 0.002f);
+  for (auto& vertex: vertices) {
+    vertex.position += urd(mt);
+  }
+}
+
+namespace {
+
+const float PLANE_CUT_AMOUNT = 0.001f;
+
+template <typename T>
+size_t get_bytes(const std::vector<T>& items) {
+  return items.capacity() * sizeof(T);
+}
+
+size_t get_planet_bytes(const planet& planet) {
+  return
+    get_bytes(planet.mesh.vertices) +
+    get_bytes(planet.mesh.triangles) +
+    get_bytes(planet.altitudes) +
+    get_bytes(planet.cuts);
+}
+
+/**
+ * Measures the stages of `gen_planet()` one after the other. Buffers that
+ * outlive the stage are counted by the caller, `held_bytes`; scratch arrays
+ * are counted by the arena, whose blocks are held until it is destroyed.
+ */
+class stage_meter {
+public:
+  stage_meter(
+    scratch_arena& scratch,
+    std::vector<planet_stage_memory>& report
+  ):
+    scratch_(scratch),
+    report_(report),
+    held_bytes_(0),
+    scratch_allocated_bytes_(0),
+    peak_bytes_(0) {}
+
+  void begin(size_t held_bytes) {
+    held_bytes_ = held_bytes;
+    scratch_allocated_bytes_ = scratch_.allocated_bytes();
+  }
+
+  void end(const char* stage, size_t held_bytes) {
+    auto added_bytes = held_bytes > held_bytes_ ? held_bytes - held_bytes_ : 0;
+    peak_bytes_ = std::max(
+      peak_bytes_,
+      std::max(held_bytes, held_bytes_) + scratch_.reserved_bytes()
+    );
+    report_.push_back({
+      stage,
+      added_bytes + scratch_.allocated_bytes() - scratch_allocated_bytes_,
+      peak_bytes_,
+    });
+  }
+
+private:
+  scratch_arena& scratch_;
+  std::vector<planet_stage_memory>& report_;
+  size_t held_bytes_;
+  size_t scratch_allocated_bytes_;
+  size_t peak_bytes_;
+};
+
+}
+
+planet gen_planet(const planet_options& options, scratch_arena& scratch) {
+  DS_TRACE_ZONE("gen_planet");
+  planet result;
+  result.terrain = options.terrain;
+  stage_meter meter(scratch, result.memory);
+
+  meter.begin(0);
+  result.mesh = get_geodesic_sphere(options.frequency);
+  auto& vertices = result.mesh.vertices;
+  meter.end("geodesic_sphere", get_planet_bytes(result));
+
+  meter.begin(get_planet_bytes(result));
+  std::mt19937 mt(options.seed);
+  std::uniform_real_distribution<float> urd(-1, 1);
+  if (options.terrain == terrain_generator::NOISE) {
+    result.noise = noise_terrain(mt());
+    result.noise.displace(
+      options.kernel,
+      vertices,
+      options.thread_count,
+      scratch
+    );
+  } else {
+    result.cuts.resize(500);
+    for (auto& cut: result.cuts) {
+      cut.normal = glm::normalize(glm::vec3({ urd(mt), urd(mt), urd(mt) }));
+      cut.distance = urd(mt);
+    }
+    apply_plane_cuts(
+      options.kernel,
+      result.cuts,
+      PLANE_CUT_AMOUNT,
+      vertices,
+      options.thread_count,
+      scratch
+    );
+  }
+  meter.end("terrain", get_planet_bytes(result));
+
+  meter.begin(get_planet_bytes(result));
+  result.center = recenter_vertices(vertices);
+  shake_vertices(mt(), vertices);
+  result.ocean_altitude = get_average_altitude(vertices) * 1.01f;
+  result.altitudes.resize(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    auto& position = vertices[i].position;
+    auto length = glm::length(position);
+    result.altitudes[i] = length;
+    if (length < result.ocean_altitude) {
+      position *= result.ocean_altitude / length;
+    }
+  }
+  meter.end("ocean", get_planet_bytes(result));
+
+  meter.begin(get_planet_bytes(result));
+  auto adjacency = get_vertex_adjacency(result.mesh);
+  compute_normals(result.mesh, adjacency, options.thread_count, scratch);
+  meter.end(
+    "normals",
+    get_planet_bytes(result) +
+      get_bytes(adjacency.offsets) +
+      get_bytes(adjacency.triangles)
+  );
+  return result;
+}
+
+planet gen_planet(const planet_options& options) {
+  scratch_arena scratch(SCRATCH_BLOCK_SIZE);
+  return gen_planet(options, scratch);
+}
+
+void displace_to_surface(
+  const planet& planet,
+  std::vector<vertex>& vertices,
+  std::vector<float>& altitudes,
+  scratch_arena& scratch
+) {
+  if (planet.terrain == terrain_generator::NOISE) {
+    planet.noise.displace(terrain_kernel::SIMD, vertices, 1, scratch);
+  } else {
+    apply_plane_cuts(
+      terrain_kernel::SIMD,
+      planet.cuts,
+      PLANE_CUT_AMOUNT,
+      vertices,
+      1,
+      scratch
+    );
+  }
+  altitudes.resize(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    auto& position = vertices[i].position;
+    position -= planet.center;
+    auto length = glm::length(position);
+    altitudes[i] = length;
+    if (length < planet.ocean_altitude) {
+      position *= planet.ocean_altitude / length;
+    }
+  }
+}
+
+glm::vec3 get_altitude_color(float ocean_altitude, float altitude) {
+  if (altitude <= ocean_altitude) {
+    auto depth = glm::pow(altitude / ocean_altitude, 5);
+    return glm::vec3(0.1f, 0.3f, 0.6f) * depth;
+  }
+  auto height = (altitude - ocean_altitude) / 0.3f;
+  auto coef = height / 0.4f + 0.6f;
+  return glm::vec3(0.9f, 0.7f, 0.7f) * coef;
+}
+
+}
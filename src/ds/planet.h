@@ -0,0 +1,116 @@
+#pragma once
+#include "mesh.h"
+#include "noise_terrain.h"
+#include "plane_cuts.h"
+#include "scratch_arena.h"
+#include "terrain_kernel.h"
+#include <cstdint>
+#include <vector>
+
+namespace ds {
+
+/**
+ * How the terrain gets carved: by pushing and pulling the sphere along
+ * random planes, or by fractal noise, see `noise_terrain`.
+ */
+enum class terrain_generator { PLANE_CUTS, NOISE, };
+
+struct planet_options {
+  planet_options():
+    seed(123),
+    frequency(32),
+    terrain(terrain_generator::PLANE_CUTS),
+    kernel(terrain_kernel::SIMD),
+    thread_count(0) {}
+
+  std::uint_fast32_t seed;
+  /**
+   * Subdivision frequency of the geodesic sphere the planet is carved from.
+   */
+  size_t frequency;
+  terrain_generator terrain;
+  /**
+   * Kernel of either generator: the noise is the same with both.
+   */
+  terrain_kernel kernel;
+  /**
+   * Threads used by the kernels that support it, zero means one per
+   * hardware thread.
+   */
+  size_t thread_count;
+};
+
+/**
+ * Memory use of a stage of `gen_planet()`. `allocated_bytes` counts both the
+ * buffers the stage added to the planet and its scratch arrays. `peak_bytes`
+ * is the most the generation held at once so far, planet and scratch arena
+ * together, whichever stage it happened in.
+ */
+struct planet_stage_memory {
+  const char* stage;
+  size_t allocated_bytes;
+  size_t peak_bytes;
+};
+
+struct planet {
+  ds::mesh mesh;
+  float ocean_altitude;
+  /**
+   * Distance of each vertex from the center before it got clamped to the
+   * ocean level. The direction is that of the vertex itself.
+   */
+  std::vector<float> altitudes;
+  /**
+   * The cuts or the noise the terrain was carved with, and the offset
+   * applied afterwards to put the gravity center at the origin. Together
+   * they allow to carve other meshes into the same terrain, see
+   * `displace_to_surface()`.
+   */
+  terrain_generator terrain;
+  std::vector<plane_cut> cuts;
+  noise_terrain noise;
+  glm::vec3 center;
+  /**
+   * One item per stage of `gen_planet()`, in order, empty otherwise.
+   */
+  std::vector<planet_stage_memory> memory;
+};
+
+glm::vec3 get_gravity_center(const std::vector<vertex>& vertices);
+
+/**
+ * Return the gravity center that got subtracted from all the positions.
+ */
+glm::vec3 recenter_vertices(std::vector<vertex>& vertices);
+float get_average_altitude(std::vector<vertex>& vertices);
+void shake_vertices(std::uint_fast32_t seed, std::vector<vertex>& vertices);
+
+/**
+ * Carve the terrain out of a geodesic sphere. Normals follow the terrain,
+ * see `compute_normals()`. Each stage works in place on the planet being
+ * returned, and takes its temporary arrays from `scratch`, all given back
+ * by the end.
+ */
+planet gen_planet(const planet_options& options, scratch_arena& scratch);
+planet gen_planet(const planet_options& options);
+
+/**
+ * Move points of the unit sphere onto the surface of `planet` the same way as
+ * its own vertices, except for the random shake, so that meshes of any
+ * resolution can be built on the same terrain. Normals are left as they are.
+ * `altitudes` receives the altitude of each vertex before it got clamped to
+ * the ocean level.
+ */
+void displace_to_surface(
+  const planet& planet,
+  std::vector<vertex>& vertices,
+  std::vector<float>& altitudes,
+  scratch_arena& scratch
+);
+
+/**
+ * Color of the surface at `altitude`, before clamping to the ocean level.
+ */
+glm::vec3 get_altitude_color(float ocean_altitude, float altitude);
+
+}
@@ -0,0 +1,246 @@
+#include "planet_cache.h"
+#include "atomic_file.h"
+#include "checksum.h"
+#include "trace.h"
+#include <cstring>
+#include <fstream>
+
+namespace ds {
+
+namespace {
+
+const char MAGIC[8] = {'D', 'S', 'P', 'L', 'A', 'N', 'E', 'T'};
+
+struct header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t optimized;
+  std::uint32_t submerged_dropped;
+  std::uint32_t padding;
+  std::uint64_t seed;
+  std::uint64_t frequency;
+  std::uint32_t terrain;
+  std::uint32_t kernel;
+  float ocean_altitude;
+  float inner_radius;
+  height_range heights;
+  std::uint64_t source_triangle_count;
+  std::uint64_t submerged_triangle_count;
+  vertex_cache_stats cache_stats;
+  vertex_cache_stats unoptimized_cache_stats;
+  std::uint64_t meshlet_offset;
+  std::uint64_t meshlet_count;
+  std::uint64_t vertex_offset;
+  std::uint64_t vertex_count;
+  std::uint64_t index_offset;
+  std::uint64_t index_count;
+  std::uint64_t sea_floor_offset;
+  std::uint64_t sea_floor_count;
+  std::uint64_t checksum;
+};
+
+size_t align(size_t offset) {
+  return (offset + PLANET_CACHE_ALIGNMENT - 1) /
+    PLANET_CACHE_ALIGNMENT * PLANET_CACHE_ALIGNMENT;
+}
+
+/**
+ * Everything but the offsets and the checksum.
+ */
+header get_header(
+  const planet_options& options,
+  bool optimize,
+  bool drop_submerged,
+  const planet_mesh& mesh
+) {
+  header result;
+  std::memset(&result, 0, sizeof(result));
+  std::memcpy(result.magic, MAGIC, sizeof(MAGIC));
+  result.version = PLANET_CACHE_VERSION;
+  result.optimized = optimize ? 1 : 0;
+  result.submerged_dropped = drop_submerged ? 1 : 0;
+  result.seed = options.seed;
+  result.frequency = options.frequency;
+  result.terrain = static_cast<std::uint32_t>(options.terrain);
+  result.kernel = static_cast<std::uint32_t>(options.kernel);
+  result.ocean_altitude = mesh.ocean_altitude;
+  result.inner_radius = mesh.inner_radius;
+  result.heights = mesh.heights;
+  result.source_triangle_count = mesh.source_triangle_count;
+  result.submerged_triangle_count = mesh.submerged_triangle_count;
+  result.cache_stats = mesh.cache_stats;
+  result.unoptimized_cache_stats = mesh.unoptimized_cache_stats;
+  result.meshlet_count = mesh.meshlets.size();
+  result.vertex_count = mesh.vertex_count;
+  result.index_count = mesh.index_count;
+  result.sea_floor_count = mesh.sea_floor.size();
+  return result;
+}
+
+bool is_block_valid(
+  const mapped_file& file,
+  std::uint64_t offset,
+  std::uint64_t count,
+  size_t item_size
+) {
+  return
+    offset % PLANET_CACHE_ALIGNMENT == 0 &&
+    offset <= file.size() &&
+    count <= (file.size() - offset) / item_size;
+}
+
+void write_block(std::ofstream& os, const void* data, size_t size) {
+  auto padding = align(static_cast<size_t>(os.tellp())) -
+    static_cast<size_t>(os.tellp());
+  const char zeros[PLANET_CACHE_ALIGNMENT] = {};
+  os.write(zeros, padding);
+  os.write(static_cast<const char*>(data), size);
+}
+
+}
+
+std::string get_planet_cache_path(
+  const std::string& directory,
+  const planet_options& options,
+  bool optimize,
+  bool drop_submerged
+) {
+  return directory + "/planet-" + std::to_string(options.seed) + "-" +
+    std::to_string(options.frequency) + "-" +
+    (options.terrain == terrain_generator::NOISE ? "noise-" : "") +
+    (options.kernel == terrain_kernel::SIMD ? "simd" : "reference") +
+    (optimize ? "" : "-unoptimized") +
+    (drop_submerged ? "" : "-submerged") + ".bin";
+}
+
+bool load_planet_mesh(
+  const std::string& path,
+  const planet_options& options,
+  bool optimize,
+  bool drop_submerged,
+  planet_mesh& result
+) {
+  DS_TRACE_ZONE("load_planet_mesh");
+  auto file = mapped_file::open(path);
+  if (!file || file->size() < sizeof(header)) {
+    return false;
+  }
+  header actual;
+  std::memcpy(&actual, file->data(), sizeof(actual));
+  if (
+    std::memcmp(actual.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+    actual.version != PLANET_CACHE_VERSION ||
+    actual.optimized != (optimize ? 1u : 0u) ||
+    actual.submerged_dropped != (drop_submerged ? 1u : 0u) ||
+    actual.seed != options.seed ||
+    actual.frequency != options.frequency ||
+    actual.terrain != static_cast<std::uint32_t>(options.terrain) ||
+    actual.kernel != static_cast<std::uint32_t>(options.kernel) ||
+    !is_block_valid(
+      *file,
+      actual.meshlet_offset,
+      actual.meshlet_count,
+      sizeof(meshlet)
+    ) ||
+    !is_block_valid(
+      *file,
+      actual.vertex_offset,
+      actual.vertex_count,
+      sizeof(packed_vertex)
+    ) ||
+    !is_block_valid(*file, actual.index_offset, actual.index_count, 1) ||
+    !is_block_valid(
+      *file,
+      actual.sea_floor_offset,
+      actual.sea_floor_count,
+      sizeof(std::uint16_t)
+    )
+  ) {
+    return false;
+  }
+  const auto* meshlets = file->data() + actual.meshlet_offset;
+  const auto* vertices = file->data() + actual.vertex_offset;
+  const auto* indices = file->data() + actual.index_offset;
+  const auto* sea_floor = file->data() + actual.sea_floor_offset;
+  checksum sum;
+  sum.add(meshlets, actual.meshlet_count * sizeof(meshlet));
+  sum.add(vertices, actual.vertex_count * sizeof(packed_vertex));
+  sum.add(indices, actual.index_count);
+  sum.add(sea_floor, actual.sea_floor_count * sizeof(std::uint16_t));
+  if (sum.get() != actual.checksum) {
+    return false;
+  }
+
+  result.meshlets.assign(
+    reinterpret_cast<const meshlet*>(meshlets),
+    reinterpret_cast<const meshlet*>(meshlets) + actual.meshlet_count
+  );
+  result.inner_radius = actual.inner_radius;
+  result.ocean_altitude = actual.ocean_altitude;
+  result.heights = actual.heights;
+  result.source_triangle_count = actual.source_triangle_count;
+  result.submerged_triangle_count = actual.submerged_triangle_count;
+  result.sea_floor.assign(
+    reinterpret_cast<const std::uint16_t*>(sea_floor),
+    reinterpret_cast<const std::uint16_t*>(sea_floor) + actual.sea_floor_count
+  );
+  result.cache_stats = actual.cache_stats;
+  result.unoptimized_cache_stats = actual.unoptimized_cache_stats;
+  result.vertices = reinterpret_cast<const packed_vertex*>(vertices);
+  result.vertex_count = actual.vertex_count;
+  result.indices = indices;
+  result.index_count = actual.index_count;
+  result.vertex_storage.clear();
+  result.index_storage.clear();
+  result.file = std::move(file);
+  return true;
+}
+
+void save_planet_mesh(
+  const std::string& directory,
+  const std::string& path,
+  const planet_options& options,
+  bool optimize,
+  bool drop_submerged,
+  const planet_mesh& mesh
+) {
+  DS_TRACE_ZONE("save_planet_mesh");
+  atomic_file file(directory, path);
+  auto file_header = get_header(options, optimize, drop_submerged, mesh);
+  file_header.meshlet_offset = align(sizeof(header));
+  file_header.vertex_offset = align(
+    file_header.meshlet_offset + mesh.meshlets.size() * sizeof(meshlet)
+  );
+  file_header.index_offset = align(
+    file_header.vertex_offset + mesh.vertex_count * sizeof(packed_vertex)
+  );
+  file_header.sea_floor_offset =
+    align(file_header.index_offset + mesh.index_count);
+  checksum sum;
+  sum.add(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(meshlet));
+  sum.add(mesh.vertices, mesh.vertex_count * sizeof(packed_vertex));
+  sum.add(mesh.indices, mesh.index_count);
+  sum.add(
+    mesh.sea_floor.data(),
+    mesh.sea_floor.size() * sizeof(std::uint16_t)
+  );
+  file_header.checksum = sum.get();
+
+  auto& os = file.stream();
+  os.write(reinterpret_cast<const char*>(&file_header), sizeof(header));
+  write_block(
+    os,
+    mesh.meshlets.data(),
+    mesh.meshlets.size() * sizeof(meshlet)
+  );
+  write_block(os, mesh.vertices, mesh.vertex_count * sizeof(packed_vertex));
+  write_block(os, mesh.indices, mesh.index_count);
+  write_block(
+    os,
+    mesh.sea_floor.data(),
+    mesh.sea_floor.size() * sizeof(std::uint16_t)
+  );
+  file.commit();
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "planet_mesh.h"
+#include <string>
+
+namespace ds {
+
+/**
+ * Planet meshes only depend on a few options, so they can be cached across
+ * runs. Files are made of a header followed by the meshlet, vertex, index
+ * and sea floor blocks, each aligned on `PLANET_CACHE_ALIGNMENT` bytes, in
+ * native byte order: the cache is meant for the machine it got written on. A
+ * checksum covers the blocks.
+ */
+const std::uint32_t PLANET_CACHE_VERSION = 5;
+const size_t PLANET_CACHE_ALIGNMENT = 64;
+
+/**
+ * Path of the cache file for these options in `directory`.
+ */
+std::string get_planet_cache_path(
+  const std::string& directory,
+  const planet_options& options,
+  bool optimize,
+  bool drop_submerged
+);
+
+/**
+ * Map the cache file in memory, the vertices and indices of `result` then
+ * point right into it. Return false if the file is missing, or isn't valid
+ * for these options: older version, truncated, or corrupted.
+ */
+bool load_planet_mesh(
+  const std::string& path,
+  const planet_options& options,
+  bool optimize,
+  bool drop_submerged,
+  planet_mesh& result
+);
+
+/**
+ * Write to a temporary file first, then rename it, so that other processes
+ * never see a partial file. Creates `directory` if needed.
+ */
+void save_planet_mesh(
+  const std::string& directory,
+  const std::string& path,
+  const planet_options& options,
+  bool optimize,
+  bool drop_submerged,
+  const planet_mesh& mesh
+);
+
+}
@@ -0,0 +1,114 @@
+#include "planet_mesh.h"
+#include "trace.h"
+
+namespace ds {
+
+namespace {
+
+/**
+ * Drop the triangles whose vertices are all at or below the ocean level,
+ * that the ocean hides whole. Return how many got dropped.
+ */
+size_t drop_submerged_triangles(planet& planet) {
+  DS_TRACE_ZONE("drop_submerged_triangles");
+  auto& triangles = planet.mesh.triangles;
+  const auto& altitudes = planet.altitudes;
+  size_t kept = 0;
+  for (const auto& triangle: triangles) {
+    if (
+      altitudes[triangle.x] > planet.ocean_altitude ||
+      altitudes[triangle.y] > planet.ocean_altitude ||
+      altitudes[triangle.z] > planet.ocean_altitude
+    ) {
+      triangles[kept++] = triangle;
+    }
+  }
+  auto dropped = triangles.size() - kept;
+  triangles.resize(kept);
+  return dropped;
+}
+
+/**
+ * Sample the terrain at the center of each texel, so that the sea floor
+ * doesn't depend on the resolution of the mesh.
+ */
+std::vector<std::uint16_t> bake_sea_floor(
+  const planet& planet,
+  const height_range& heights
+) {
+  DS_TRACE_ZONE("bake_sea_floor");
+  std::vector<vertex> directions(SEA_FLOOR_SIZE * SEA_FLOOR_SIZE);
+  auto texel_size = 2.0f / SEA_FLOOR_SIZE;
+  for (size_t j = 0; j < SEA_FLOOR_SIZE; ++j) {
+    for (size_t i = 0; i < SEA_FLOOR_SIZE; ++i) {
+      auto& direction = directions[j * SEA_FLOOR_SIZE + i];
+      direction.position = decode_octahedral(glm::vec2(
+        (i + 0.5f) * texel_size - 1,
+        (j + 0.5f) * texel_size - 1
+      ));
+      direction.normal = direction.position;
+    }
+  }
+  std::vector<float> altitudes;
+  scratch_arena scratch(SCRATCH_BLOCK_SIZE);
+  displace_to_surface(planet, directions, altitudes, scratch);
+  std::vector<std::uint16_t> result(altitudes.size());
+  for (size_t i = 0; i < altitudes.size(); ++i) {
+    result[i] = pack_height(altitudes[i], heights);
+  }
+  return result;
+}
+
+}
+
+planet_mesh build_planet_mesh(
+  planet planet,
+  bool optimize,
+  bool drop_submerged
+) {
+  DS_TRACE_ZONE("build_planet_mesh");
+  planet_mesh result;
+  // The sea floor is within the range of the whole planet, submerged
+  // vertices included.
+  result.heights = get_height_range(planet.altitudes);
+  result.source_triangle_count = planet.mesh.triangles.size();
+  result.submerged_triangle_count = 0;
+  if (drop_submerged) {
+    result.submerged_triangle_count = drop_submerged_triangles(planet);
+  }
+  result.sea_floor = bake_sea_floor(planet, result.heights);
+
+  auto set = build_meshlets(planet.mesh);
+  result.unoptimized_cache_stats =
+    get_vertex_cache_stats(set, VERTEX_CACHE_SIZE);
+  result.cache_stats = result.unoptimized_cache_stats;
+  if (optimize) {
+    optimize_meshlets(set, planet.mesh);
+    result.cache_stats = get_vertex_cache_stats(set, VERTEX_CACHE_SIZE);
+  }
+  result.inner_radius = set.inner_radius;
+  result.ocean_altitude = planet.ocean_altitude;
+  {
+    DS_TRACE_ZONE("pack_vertices");
+    result.vertex_storage.resize(set.vertices.size());
+    for (size_t i = 0; i < set.vertices.size(); ++i) {
+      auto ix = set.vertices[i];
+      const auto& vertex = planet.mesh.vertices[ix];
+      result.vertex_storage[i] = pack_vertex(
+        vertex.position,
+        planet.altitudes[ix],
+        vertex.normal,
+        result.heights
+      );
+    }
+  }
+  result.meshlets = std::move(set.meshlets);
+  result.index_storage = std::move(set.indices);
+  result.vertices = result.vertex_storage.data();
+  result.vertex_count = result.vertex_storage.size();
+  result.indices = result.index_storage.data();
+  result.index_count = result.index_storage.size();
+  return result;
+}
+
+}
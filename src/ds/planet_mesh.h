@@ -0,0 +1,73 @@
+#pragma once
+#include "mapped_file.h"
+#include "mesh_optimizer.h"
+#include "meshlets.h"
+#include "packed_vertex.h"
+#include "planet.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Width and height of the sea floor map, see `planet_mesh::sea_floor`.
+ */
+const size_t SEA_FLOOR_SIZE = 256;
+
+/**
+ * The planet as `meshlet_renderer` draws it: meshlets, with their packed
+ * vertices and local indices ready to upload as is. Only what the GPU and
+ * culling need is kept, so that it can be cached, see `planet_cache.h`.
+ */
+struct planet_mesh {
+  std::vector<meshlet> meshlets;
+  float inner_radius;
+  float ocean_altitude;
+  height_range heights;
+  /**
+   * Triangles of the planet the mesh got built from, and how many of them
+   * got dropped for being under the ocean.
+   */
+  size_t source_triangle_count;
+  size_t submerged_triangle_count;
+  /**
+   * Altitudes of the planet before clamping to the ocean level, so that the
+   * ocean can be tinted by its depth where the terrain isn't drawn. Texels
+   * are in octahedral coordinates, see `encode_octahedral()`, row after
+   * row, as heights within `heights` like the packed vertices.
+   */
+  std::vector<std::uint16_t> sea_floor;
+  /**
+   * Simulated vertex cache behavior of the meshlets in order, and as built
+   * before being optimized.
+   */
+  vertex_cache_stats cache_stats;
+  vertex_cache_stats unoptimized_cache_stats;
+  /**
+   * Meshlet after meshlet, see `meshlet_set`. They point either into the
+   * storage below or into the mapped cache file.
+   */
+  const packed_vertex* vertices;
+  size_t vertex_count;
+  const std::uint8_t* indices;
+  size_t index_count;
+
+  std::vector<packed_vertex> vertex_storage;
+  std::vector<std::uint8_t> index_storage;
+  std::unique_ptr<mapped_file> file;
+};
+
+/**
+ * When `drop_submerged` is set, the triangles entirely under the ocean are
+ * dropped, for the ocean to be drawn over them as a sphere. When `optimize`
+ * is set, the meshlets are reordered for the vertex cache and against
+ * overdraw, see `optimize_meshlets()`.
+ */
+planet_mesh build_planet_mesh(
+  planet planet,
+  bool optimize,
+  bool drop_submerged
+);
+
+}
@@ -0,0 +1,176 @@
+#include "program_cache.h"
+#include "atomic_file.h"
+#include "checksum.h"
+#include "mapped_file.h"
+#include "shaders.h"
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+
+namespace ds {
+
+namespace {
+
+const char MAGIC[8] = {'D', 'S', 'P', 'R', 'O', 'G', 'R', 'M'};
+
+struct header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t format;
+  std::uint64_t key;
+  std::uint64_t size;
+  std::uint64_t checksum;
+};
+
+std::string get_string(GLenum name) {
+  const auto* value = glGetString(name);
+  return value == nullptr ? "" : reinterpret_cast<const char*>(value);
+}
+
+/**
+ * Sizes go first, so that moving bytes from a source to the next one
+ * changes the key.
+ */
+void add_field(checksum& sum, const void* data, size_t size) {
+  std::uint64_t size_field = size;
+  sum.add(&size_field, sizeof(size_field));
+  sum.add(data, size);
+}
+
+std::uint64_t get_key(
+  const std::string& driver,
+  const resource& vertex_shader,
+  const resource& fragment_shader
+) {
+  checksum sum;
+  add_field(sum, driver.data(), driver.size());
+  add_field(sum, vertex_shader.data, vertex_shader.size);
+  add_field(sum, fragment_shader.data, fragment_shader.size);
+  return sum.get();
+}
+
+std::string get_path(const std::string& directory, std::uint64_t key) {
+  char name[32];
+  std::snprintf(
+    name,
+    sizeof(name),
+    "program-%016llx.bin",
+    static_cast<unsigned long long>(key)
+  );
+  return directory + "/" + name;
+}
+
+bool load_program(
+  const std::string& path,
+  std::uint64_t key,
+  glpp::program& result,
+  bool& rejected
+) {
+  DS_TRACE_ZONE("load_program_binary");
+  rejected = false;
+  auto file = mapped_file::open(path);
+  if (!file || file->size() < sizeof(header)) {
+    return false;
+  }
+  header actual;
+  std::memcpy(&actual, file->data(), sizeof(actual));
+  if (
+    std::memcmp(actual.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+    actual.version != PROGRAM_CACHE_VERSION ||
+    actual.key != key ||
+    actual.size != file->size() - sizeof(header)
+  ) {
+    return false;
+  }
+  const auto* binary = file->data() + sizeof(header);
+  checksum sum;
+  sum.add(binary, actual.size);
+  if (sum.get() != actual.checksum) {
+    return false;
+  }
+  if (!result.load_binary(
+    actual.format,
+    binary,
+    static_cast<GLsizei>(actual.size)
+  )) {
+    rejected = true;
+    return false;
+  }
+  return true;
+}
+
+void save_program(
+  const std::string& directory,
+  const std::string& path,
+  std::uint64_t key,
+  const glpp::program& program
+) {
+  DS_TRACE_ZONE("save_program_binary");
+  GLenum format = 0;
+  auto binary = program.get_binary(format);
+  if (binary.empty()) {
+    return;
+  }
+  atomic_file file(directory, path);
+  header file_header;
+  std::memset(&file_header, 0, sizeof(file_header));
+  std::memcpy(file_header.magic, MAGIC, sizeof(MAGIC));
+  file_header.version = PROGRAM_CACHE_VERSION;
+  file_header.format = format;
+  file_header.key = key;
+  file_header.size = binary.size();
+  checksum sum;
+  sum.add(binary.data(), binary.size());
+  file_header.checksum = sum.get();
+
+  auto& os = file.stream();
+  os.write(reinterpret_cast<const char*>(&file_header), sizeof(header));
+  os.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+  file.commit();
+}
+
+}
+
+program_cache::program_cache(std::string directory):
+  directory_(std::move(directory)),
+  driver_(get_string(GL_RENDERER) + "\n" + get_string(GL_VERSION)),
+  enabled_(false),
+  hit_count_(0),
+  miss_count_(0),
+  rejected_count_(0) {
+  if (directory_.empty()) {
+    return;
+  }
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  enabled_ = format_count > 0;
+}
+
+glpp::program program_cache::load_and_link(
+  const resource& vertex_shader,
+  const resource& fragment_shader
+) {
+  if (!enabled_) {
+    ++miss_count_;
+    return load_and_link_program(vertex_shader, fragment_shader, false);
+  }
+  auto key = get_key(driver_, vertex_shader, fragment_shader);
+  auto path = get_path(directory_, key);
+  {
+    glpp::program result;
+    bool rejected;
+    if (load_program(path, key, result, rejected)) {
+      ++hit_count_;
+      return result;
+    }
+    if (rejected) {
+      ++rejected_count_;
+    }
+  }
+  ++miss_count_;
+  auto result = load_and_link_program(vertex_shader, fragment_shader, true);
+  save_program(directory_, path, key, result);
+  return result;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "../glpp/program.h"
+#include "resource.h"
+#include <string>
+
+namespace ds {
+
+/**
+ * Keeps linked programs across runs, so that shaders only get compiled
+ * again when they or the driver change. Files are named after a hash of the
+ * shader sources and of the `GL_RENDERER` and `GL_VERSION` strings, and hold
+ * a header followed by the binary of `glGetProgramBinary`. A checksum covers
+ * the binary.
+ *
+ * The driver may still reject a binary, in which case the program gets
+ * compiled from source and cached again. Programs always get compiled when
+ * the driver has no binary formats, as some macOS drivers.
+ */
+const std::uint32_t PROGRAM_CACHE_VERSION = 1;
+
+class program_cache {
+public:
+  /**
+   * Programs are cached in `directory`, created if needed, or not at all
+   * if it's empty. Needs a current context.
+   */
+  program_cache(std::string directory);
+  program_cache(program_cache&) = delete;
+
+  /**
+   * Load the program from the cache when possible, or compile and link it
+   * then save it there.
+   */
+  glpp::program load_and_link(
+    const resource& vertex_shader,
+    const resource& fragment_shader
+  );
+
+  size_t hit_count() const {
+    return hit_count_;
+  }
+
+  /**
+   * Programs compiled from source, including rejected ones.
+   */
+  size_t miss_count() const {
+    return miss_count_;
+  }
+
+  /**
+   * Cached binaries the driver didn't accept, ex. after an update that
+   * kept the same version string.
+   */
+  size_t rejected_count() const {
+    return rejected_count_;
+  }
+
+private:
+  std::string directory_;
+  std::string driver_;
+  bool enabled_;
+  size_t hit_count_;
+  size_t miss_count_;
+  size_t rejected_count_;
+};
+
+}
@@ -0,0 +1,96 @@
+#include "resolution_scaler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ds {
+
+namespace {
+
+/**
+ * Weight of each new time in the smoothed time.
+ */
+const double SMOOTHING = 0.2;
+
+/**
+ * Fractions of the target time: the scale falls above the high load and
+ * rises below the low load, aiming right between.
+ */
+const double HIGH_LOAD = 0.9;
+const double LOW_LOAD = 0.7;
+const double AIMED_LOAD = 0.8;
+
+/**
+ * Largest relative change of the scale at once.
+ */
+const float MAX_FALL = 0.15f;
+const float MAX_RISE = 0.05f;
+
+/**
+ * Changes smaller than that aren't worth it.
+ */
+const float MIN_CHANGE = 0.01f;
+
+/**
+ * Frames to wait after a change. Times come in a few frames late, and the
+ * smoothed time has to catch up with the new scale.
+ */
+const size_t COOLDOWN_FRAMES = 8;
+
+/**
+ * Frames ignored at first: they get programs linked and meshes uploaded,
+ * and take much longer than the next ones.
+ */
+const size_t WARMUP_FRAMES = 4;
+
+}
+
+resolution_scaler::resolution_scaler(
+  double target_time,
+  float min_scale,
+  float max_scale
+):
+  target_time_(target_time),
+  min_scale_(min_scale),
+  max_scale_(max_scale),
+  scale_(max_scale),
+  smoothed_time_(0),
+  sample_count_(0),
+  cooldown_(0),
+  change_count_(0) {}
+
+void resolution_scaler::add_gpu_time(double time) {
+  if (sample_count_ < WARMUP_FRAMES) {
+    ++sample_count_;
+    return;
+  }
+  smoothed_time_ = sample_count_ == WARMUP_FRAMES
+    ? time
+    : smoothed_time_ + (time - smoothed_time_) * SMOOTHING;
+  ++sample_count_;
+  if (cooldown_ > 0) {
+    --cooldown_;
+    return;
+  }
+  auto load = smoothed_time_ / target_time_;
+  if (load <= HIGH_LOAD && (load >= LOW_LOAD || scale_ >= max_scale_)) {
+    return;
+  }
+  auto wanted =
+    scale_ * static_cast<float>(std::sqrt(AIMED_LOAD / std::max(load, 1e-6)));
+  auto next = std::min(
+    std::max(wanted, scale_ * (1 - MAX_FALL)),
+    scale_ * (1 + MAX_RISE)
+  );
+  next = std::min(std::max(next, min_scale_), max_scale_);
+  if (std::abs(next - scale_) < MIN_CHANGE) {
+    return;
+  }
+  // Until the times of the new scale come in, expect them to follow the
+  // number of pixels.
+  smoothed_time_ *= (next * next) / (scale_ * scale_);
+  scale_ = next;
+  cooldown_ = COOLDOWN_FRAMES;
+  ++change_count_;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+
+namespace ds {
+
+/**
+ * Picks the scale of the render resolution, on each axis, from the GPU time
+ * of the last frames, to keep it within the frame time target. GPU time is
+ * taken to grow with the number of pixels, so with the square of the scale.
+ *
+ * Times are smoothed first, and the scale only changes when the load leaves
+ * a band around the aimed load, by a bounded step, then waits a few frames
+ * for the times of the new scale to come in. That way it doesn't oscillate
+ * around a threshold. It falls faster than it recovers, as missing frames is
+ * worse than rendering fewer pixels for a while.
+ */
+class resolution_scaler {
+public:
+  /**
+   * Times are in seconds. The scale starts at `max_scale`.
+   */
+  resolution_scaler(double target_time, float min_scale, float max_scale);
+
+  /**
+   * Account the GPU time of a frame rendered at the current scale.
+   */
+  void add_gpu_time(double time);
+
+  float scale() const {
+    return scale_;
+  }
+
+  /**
+   * Smoothed GPU time of the last frames, as if at the current scale.
+   */
+  double smoothed_time() const {
+    return smoothed_time_;
+  }
+
+  size_t change_count() const {
+    return change_count_;
+  }
+
+private:
+  double target_time_;
+  float min_scale_;
+  float max_scale_;
+  float scale_;
+  double smoothed_time_;
+  size_t sample_count_;
+  size_t cooldown_;
+  size_t change_count_;
+};
+
+}
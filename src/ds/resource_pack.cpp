@@ -0,0 +1,225 @@
+#include "resource_pack.h"
+#include "system_error.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ds {
+
+namespace {
+
+const std::uint32_t MAGIC = 0x50525344;
+const std::uint32_t VERSION = 1;
+const size_t HEADER_SIZE = 16;
+const size_t ENTRY_SIZE = 24;
+const std::uint32_t FLAG_LZ4 = 1;
+
+const size_t MIN_MATCH = 4;
+
+std::uint32_t read_u32(const std::uint8_t* data) {
+  return static_cast<std::uint32_t>(data[0]) |
+    static_cast<std::uint32_t>(data[1]) << 8 |
+    static_cast<std::uint32_t>(data[2]) << 16 |
+    static_cast<std::uint32_t>(data[3]) << 24;
+}
+
+/**
+ * Extended lengths of the LZ4 block format: bytes are added up until one is
+ * less than 255.
+ */
+bool read_length(
+  const std::uint8_t*& source,
+  const std::uint8_t* source_end,
+  size_t& length
+) {
+  std::uint8_t byte;
+  do {
+    if (source == source_end) {
+      return false;
+    }
+    byte = *source++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Decompress an LZ4 block into exactly `target_size` bytes. Return false if
+ * the block is corrupt.
+ */
+bool decompress_lz4(
+  const std::uint8_t* source,
+  size_t source_size,
+  std::uint8_t* target,
+  size_t target_size
+) {
+  const auto* source_end = source + source_size;
+  auto* const target_start = target;
+  const auto* target_end = target + target_size;
+  while (source < source_end) {
+    auto token = *source++;
+    size_t literal_length = token >> 4;
+    if (
+      literal_length == 15 &&
+      !read_length(source, source_end, literal_length)
+    ) {
+      return false;
+    }
+    if (
+      literal_length > static_cast<size_t>(source_end - source) ||
+      literal_length > static_cast<size_t>(target_end - target)
+    ) {
+      return false;
+    }
+    std::memcpy(target, source, literal_length);
+    source += literal_length;
+    target += literal_length;
+    // The last sequence has literals only.
+    if (source == source_end) {
+      break;
+    }
+    if (source_end - source < 2) {
+      return false;
+    }
+    size_t offset = source[0] | source[1] << 8;
+    source += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !read_length(source, source_end, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (
+      offset == 0 ||
+      offset > static_cast<size_t>(target - target_start) ||
+      match_length > static_cast<size_t>(target_end - target)
+    ) {
+      return false;
+    }
+    // Matches may overlap what they write, so copy byte by byte.
+    const auto* match = target - offset;
+    for (size_t i = 0; i < match_length; ++i) {
+      target[i] = match[i];
+    }
+    target += match_length;
+  }
+  return target == target_end;
+}
+
+}
+
+resource_pack::resource_pack(const std::uint8_t* data, size_t size) {
+  read_index(data, size);
+}
+
+std::unique_ptr<resource_pack> resource_pack::open(const std::string& path) {
+  auto file = mapped_file::open(path);
+  if (!file) {
+    throw system_error("cannot open resource pack `" + path + "`");
+  }
+  try {
+    std::unique_ptr<resource_pack> result(
+      new resource_pack(file->data(), file->size())
+    );
+    result->file_ = std::move(file);
+    return result;
+  } catch (system_error error) {
+    throw system_error("`" + path + "`: " + error.message);
+  }
+}
+
+void resource_pack::read_index(const std::uint8_t* data, size_t size) {
+  if (
+    size < HEADER_SIZE ||
+    read_u32(data) != MAGIC ||
+    read_u32(data + 4) != VERSION
+  ) {
+    throw system_error("not a resource pack, or of another version");
+  }
+  size_t count = read_u32(data + 8);
+  if (count > (size - HEADER_SIZE) / ENTRY_SIZE) {
+    throw system_error("corrupt resource pack index");
+  }
+  entries_.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const auto* fields = data + HEADER_SIZE + i * ENTRY_SIZE;
+    size_t path_offset = read_u32(fields);
+    size_t path_size = read_u32(fields + 4);
+    size_t stored_offset = read_u32(fields + 8);
+    size_t stored_size = read_u32(fields + 12);
+    auto& entry = entries_[i];
+    entry.size = read_u32(fields + 16);
+    entry.compressed = (read_u32(fields + 20) & FLAG_LZ4) != 0;
+    // Both paths and uncompressed data are followed by a zero.
+    auto stored_end = stored_offset + stored_size + (entry.compressed ? 0 : 1);
+    if (
+      path_offset + path_size >= size ||
+      data[path_offset + path_size] != 0 ||
+      stored_end > size ||
+      (!entry.compressed && (
+        stored_size != entry.size ||
+        data[stored_offset + stored_size] != 0
+      ))
+    ) {
+      throw system_error("corrupt resource pack index");
+    }
+    entry.file_path = reinterpret_cast<const char*>(data + path_offset);
+    entry.stored = data + stored_offset;
+    entry.stored_size = stored_size;
+    if (
+      i > 0 &&
+      std::strcmp(entries_[i - 1].file_path, entry.file_path) >= 0
+    ) {
+      throw system_error("resource pack index is not sorted");
+    }
+  }
+}
+
+const resource& resource_pack::get(const char* file_path) {
+  auto found = std::lower_bound(
+    entries_.begin(),
+    entries_.end(),
+    file_path,
+    [](const entry& candidate, const char* path) {
+      return std::strcmp(candidate.file_path, path) < 0;
+    }
+  );
+  if (
+    found == entries_.end() ||
+    std::strcmp(found->file_path, file_path) != 0
+  ) {
+    throw system_error(
+      std::string("resource `") + file_path + "` is not in the pack"
+    );
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& entry = *found;
+  if (entry.loaded) {
+    return *entry.loaded;
+  }
+  const std::uint8_t* data = entry.stored;
+  if (entry.compressed) {
+    DS_TRACE_ZONE("decompress_resource");
+    entry.decompressed.reset(new std::vector<std::uint8_t>(entry.size + 1));
+    auto& target = *entry.decompressed;
+    if (!decompress_lz4(
+      entry.stored,
+      entry.stored_size,
+      target.data(),
+      entry.size
+    )) {
+      throw system_error(
+        std::string("resource `") + file_path + "` is corrupt"
+      );
+    }
+    target[entry.size] = 0;
+    data = target.data();
+  }
+  entry.loaded.reset(new resource{
+    .file_path = entry.file_path,
+    .data = data,
+    .size = entry.size,
+  });
+  return *entry.loaded;
+}
+
+}
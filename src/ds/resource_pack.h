@@ -0,0 +1,66 @@
+#pragma once
+#include "mapped_file.h"
+#include "resource.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ds {
+
+/**
+ * All the resources in a single blob, as made by
+ * `build/pack-resources.js`. In little-endian 32-bit words, it's made of a
+ * header with a magic number, a version and the entry count, then an index
+ * of entries sorted by path, each with the offset and size of the path, the
+ * offset and size of the stored data, the decompressed size and flags, then
+ * the paths and the data.
+ *
+ * Stored data is either LZ4-compressed, and decompressed on first access, or
+ * used in place.
+ */
+class resource_pack {
+public:
+  /**
+   * Use a pack that's already in memory, ex. linked in the binary. It must
+   * outlive the pack.
+   */
+  resource_pack(const std::uint8_t* data, size_t size);
+
+  /**
+   * Map a loose pack file, so that resources can change without relinking.
+   */
+  static std::unique_ptr<resource_pack> open(const std::string& path);
+
+  resource_pack(resource_pack&) = delete;
+
+  /**
+   * Return the resource built from `file_path`, relative to `src`, as
+   * given by `resources.h`. The data stays valid as long as the pack.
+   */
+  const resource& get(const char* file_path);
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+private:
+  struct entry {
+    const char* file_path;
+    const std::uint8_t* stored;
+    size_t stored_size;
+    size_t size;
+    bool compressed;
+    std::unique_ptr<std::vector<std::uint8_t>> decompressed;
+    std::unique_ptr<resource> loaded;
+  };
+
+  void read_index(const std::uint8_t* data, size_t size);
+
+  std::unique_ptr<mapped_file> file_;
+  std::vector<entry> entries_;
+  std::mutex mutex_;
+};
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Threads to split a stage in: `thread_count`, or one per core if that is
+ * 0, without going over `max_thread_count` nor under 1.
+ */
+inline size_t get_thread_count(size_t thread_count, size_t max_thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  return std::max<size_t>(std::min(thread_count, max_thread_count), 1);
+}
+
+/**
+ * Split `[0, count)` in `thread_count` ranges, the first of which runs on
+ * the calling thread. `job` gets called with the first and last index of
+ * each range, concurrently, and all of them are done once this returns.
+ */
+template <typename Job>
+void run_split(size_t count, size_t thread_count, const Job& job) {
+  std::vector<std::thread> workers;
+  workers.reserve(thread_count - 1);
+  for (size_t i = 1; i < thread_count; ++i) {
+    workers.emplace_back(
+      job,
+      count * i / thread_count,
+      count * (i + 1) / thread_count
+    );
+  }
+  job(0, count / thread_count);
+  for (auto& worker: workers) {
+    worker.join();
+  }
+}
+
+}
@@ -0,0 +1,67 @@
+#include "scratch_arena.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ds {
+
+scratch_arena::scratch_arena(size_t block_size):
+  block_size_(block_size),
+  block_(0),
+  offset_(0),
+  allocated_bytes_(0) {}
+
+void* scratch_arena::allocate_bytes(size_t size, size_t alignment) {
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+    throw std::logic_error("scratch alignment must be a power of two");
+  }
+  if (alignment > alignof(std::max_align_t)) {
+    throw std::logic_error("scratch alignment is larger than the blocks'");
+  }
+  // Move on to the next block that fits, the ones left behind only get used
+  // again after a rewind.
+  auto first_unused = offset_ == 0 ? block_ : block_ + 1;
+  auto offset = (offset_ + alignment - 1) & ~(alignment - 1);
+  while (block_ < blocks_.size() && offset + size > blocks_[block_].size) {
+    ++block_;
+    offset = 0;
+  }
+  if (block_ == blocks_.size()) {
+    // Unused blocks are all too small, free them rather than keeping them
+    // around the larger one.
+    if (first_unused < blocks_.size()) {
+      blocks_.erase(blocks_.begin() + first_unused, blocks_.end());
+      block_ = blocks_.size();
+    }
+    auto block_size = std::max(block_size_, size);
+    blocks_.push_back({
+      std::unique_ptr<char[]>(new char[block_size]),
+      block_size,
+    });
+    offset = 0;
+  }
+  auto result = blocks_[block_].data.get() + offset;
+  offset_ = offset + size;
+  allocated_bytes_ += size;
+  return result;
+}
+
+void scratch_arena::rewind(const marker& marker) {
+  if (
+    marker.block > block_ ||
+    (marker.block == block_ && marker.offset > offset_)
+  ) {
+    throw std::logic_error("cannot rewind the scratch arena forward");
+  }
+  block_ = marker.block;
+  offset_ = marker.offset;
+}
+
+size_t scratch_arena::reserved_bytes() const {
+  size_t result = 0;
+  for (const auto& block: blocks_) {
+    result += block.size;
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace ds {
+
+/**
+ * Block size that suits the generation stages: small meshes fit in one
+ * block, and the arrays of large ones get blocks of their own.
+ */
+const size_t SCRATCH_BLOCK_SIZE = 1 << 20;
+
+/**
+ * Monotonic allocator for the temporary arrays of the generation stages.
+ * Allocating is bumping an offset into large blocks, and a stage gives all
+ * of its memory back at once by rewinding to where it started, see `scope`.
+ * Blocks are kept, so that the next stages and the next generations reuse
+ * them rather than going through the heap again.
+ *
+ * Memory is uninitialized and destructors are never run, so it only holds
+ * trivial types. It is not thread-safe: stages allocate before they start
+ * their threads.
+ */
+class scratch_arena {
+public:
+  /**
+   * Where the arena is at, to rewind to later.
+   */
+  struct marker {
+    size_t block;
+    size_t offset;
+  };
+
+  /**
+   * Rewind the arena when going out of scope.
+   */
+  class scope {
+  public:
+    scope(scratch_arena& arena): arena_(arena), marker_(arena.get_marker()) {}
+    ~scope() {
+      arena_.rewind(marker_);
+    }
+    scope(scope&) = delete;
+
+  private:
+    scratch_arena& arena_;
+    marker marker_;
+  };
+
+  /**
+   * Blocks get allocated `block_size` bytes at a time, or more for larger
+   * arrays.
+   */
+  scratch_arena(size_t block_size);
+  scratch_arena(scratch_arena&) = delete;
+
+  template <typename T>
+  T* allocate(size_t count) {
+    static_assert(
+      std::is_trivially_destructible<T>::value,
+      "scratch memory never gets destroyed"
+    );
+    return static_cast<T*>(allocate_bytes(count * sizeof(T), alignof(T)));
+  }
+
+  /**
+   * The alignment must be a power of two, at most that of
+   * `std::max_align_t`.
+   */
+  void* allocate_bytes(size_t size, size_t alignment);
+
+  marker get_marker() const {
+    return {block_, offset_};
+  }
+
+  void rewind(const marker& marker);
+
+  /**
+   * Bytes handed out since construction, rewound or not.
+   */
+  size_t allocated_bytes() const {
+    return allocated_bytes_;
+  }
+
+  /**
+   * Bytes of all the blocks, that the arena holds until destroyed. That is
+   * at least the most it ever had in use at once.
+   */
+  size_t reserved_bytes() const;
+
+private:
+  struct block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  size_t block_size_;
+  std::vector<block> blocks_;
+  size_t block_;
+  size_t offset_;
+  size_t allocated_bytes_;
+};
+
+}
@@ -30,7 +30,8 @@ glpp::shader load_and_compile_shader(const resource& resource, GLenum shader_typ
 
 glpp::program load_and_link_program(
   const resource& vertex_shader,
-  const resource& fragment_shader
+  const resource& fragment_shader,
+  bool retrievable_binary
 ) {
   glpp::program result;
   result.attach_shader(
@@ -39,6 +40,9 @@ glpp::program load_and_link_program(
   result.attach_shader(
     load_and_compile_shader(fragment_shader, GL_FRAGMENT_SHADER)
   );
+  if (retrievable_binary) {
+    result.set_binary_retrievable();
+  }
   result.link();
   GLint status;
   result.get_programiv(GL_LINK_STATUS, &status);
@@ -10,9 +10,14 @@ glpp::shader load_and_compile_shader(
   GLenum shader_type
 );
 
+/**
+ * Compile and link a program from source. With `retrievable_binary`, the
+ * driver is told its binary is going to be cached, see `program_cache`.
+ */
 glpp::program load_and_link_program(
   const resource& vertex_shader,
-  const resource& fragment_shader
+  const resource& fragment_shader,
+  bool retrievable_binary
 );
 
 }
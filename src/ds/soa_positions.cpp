@@ -0,0 +1,41 @@
+#include "soa_positions.h"
+
+namespace ds {
+
+soa_positions split_positions(
+  const std::vector<vertex>& vertices,
+  size_t padded_size,
+  scratch_arena& scratch
+) {
+  soa_positions result = {
+    scratch.allocate<float>(padded_size),
+    scratch.allocate<float>(padded_size),
+    scratch.allocate<float>(padded_size),
+  };
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    result.x[i] = vertices[i].position.x;
+    result.y[i] = vertices[i].position.y;
+    result.z[i] = vertices[i].position.z;
+  }
+  for (size_t i = vertices.size(); i < padded_size; ++i) {
+    result.x[i] = 1;
+    result.y[i] = 0;
+    result.z[i] = 0;
+  }
+  return result;
+}
+
+void merge_positions(
+  const soa_positions& positions,
+  std::vector<vertex>& vertices
+) {
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    vertices[i].position = glm::vec3(
+      positions.x[i],
+      positions.y[i],
+      positions.z[i]
+    );
+  }
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "mesh.h"
+#include "scratch_arena.h"
+#include <vector>
+
+namespace ds {
+
+/**
+ * Positions split into one array per coordinate, for kernels that process
+ * several vertices per instruction.
+ */
+struct soa_positions {
+  float* x;
+  float* y;
+  float* z;
+};
+
+/**
+ * Copy the positions of `vertices` into arrays of `padded_size` taken from
+ * `scratch`. The tail is padded with unit vectors, so that kernels can run
+ * on whole blocks and have whatever happens to the padding discarded.
+ */
+soa_positions split_positions(
+  const std::vector<vertex>& vertices,
+  size_t padded_size,
+  scratch_arena& scratch
+);
+
+void merge_positions(
+  const soa_positions& positions,
+  std::vector<vertex>& vertices
+);
+
+}
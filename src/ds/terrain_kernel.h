@@ -0,0 +1,13 @@
+#pragma once
+
+namespace ds {
+
+/**
+ * Implementation the terrain generators run with. `REFERENCE` is the
+ * straightforward one, processing one vertex at a time on a single thread.
+ * `SIMD` processes blocks of vertices with vector instructions when the CPU
+ * has them, split across threads. Both produce the same terrain.
+ */
+enum class terrain_kernel { REFERENCE, SIMD, };
+
+}
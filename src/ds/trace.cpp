@@ -0,0 +1,79 @@
+#include "trace.h"
+#include "system_error.h"
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace ds {
+namespace trace {
+
+namespace {
+
+struct event {
+  const char* name;
+  unsigned track;
+  double start;
+  double duration;
+};
+
+std::mutex events_mutex;
+std::vector<event> events;
+std::atomic<unsigned> next_thread_track(GPU_TRACK + 1);
+
+}
+
+#ifndef DS_DISABLE_TRACING
+
+std::atomic<bool> enabled(false);
+
+void start() {
+  enabled.store(true);
+}
+
+#else
+
+void start() {
+  throw system_error("tracing was disabled at compile time");
+}
+
+#endif
+
+double now() {
+  return std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+unsigned get_thread_track() {
+  static thread_local unsigned track = next_thread_track.fetch_add(1);
+  return track;
+}
+
+void add_event(
+  const char* name,
+  unsigned track,
+  double start,
+  double duration
+) {
+  std::lock_guard<std::mutex> lock(events_mutex);
+  events.push_back({name, track, start, duration});
+}
+
+void write_json(std::ostream& os) {
+  std::lock_guard<std::mutex> lock(events_mutex);
+  os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  os << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+    << GPU_TRACK << ", \"args\": {\"name\": \"GPU\"}}";
+  auto precision = os.precision(15);
+  for (const auto& event: events) {
+    os << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1"
+      << ", \"tid\": " << event.track
+      << ", \"ts\": " << event.start
+      << ", \"dur\": " << event.duration << "}";
+  }
+  os.precision(precision);
+  os << "\n]}\n";
+}
+
+}
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+
+/**
+ * Lightweight instrumentation producing Chrome/Perfetto traces. Scoped CPU
+ * zones are declared with `DS_TRACE_ZONE("name")`, and only cost a branch
+ * until tracing is started. Defining `DS_DISABLE_TRACING` compiles them out
+ * entirely.
+ */
+namespace ds {
+namespace trace {
+
+/**
+ * Timeline track reserved for the GPU, CPU threads get the following ones.
+ */
+const unsigned GPU_TRACK = 0;
+
+#ifndef DS_DISABLE_TRACING
+
+extern std::atomic<bool> enabled;
+
+inline bool is_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+#else
+
+constexpr bool is_enabled() {
+  return false;
+}
+
+#endif
+
+/**
+ * Start recording events, until the process exits. Throws if tracing was
+ * compiled out.
+ */
+void start();
+
+/**
+ * Microseconds elapsed on a monotonic clock, the time base of all events.
+ */
+double now();
+
+/**
+ * Track of the calling thread.
+ */
+unsigned get_thread_track();
+
+/**
+ * Record a complete event, `start` and `duration` in microseconds. The name
+ * must outlive the tracing session, typically a string literal.
+ */
+void add_event(
+  const char* name,
+  unsigned track,
+  double start,
+  double duration
+);
+
+/**
+ * Write everything recorded so far in the Chrome trace event JSON format.
+ */
+void write_json(std::ostream& os);
+
+struct zone {
+  zone(const char* name):
+    name_(name), start_(is_enabled() ? now() : -1) {}
+  ~zone() {
+    if (start_ >= 0) {
+      add_event(name_, get_thread_track(), start_, now() - start_);
+    }
+  }
+  zone(zone&) = delete;
+
+private:
+  const char* name_;
+  double start_;
+};
+
+}
+}
+
+#define DS_TRACE_CONCAT_(a, b) a##b
+#define DS_TRACE_CONCAT(a, b) DS_TRACE_CONCAT_(a, b)
+
+#ifndef DS_DISABLE_TRACING
+#define DS_TRACE_ZONE(name) \
+  ::ds::trace::zone DS_TRACE_CONCAT(ds_trace_zone_, __LINE__)(name)
+#else
+#define DS_TRACE_ZONE(name)
+#endif
@@ -0,0 +1,122 @@
+#ifdef __linux__
+#include "pbuffer_context.h"
+#include <EGL/eglext.h>
+#include <stdexcept>
+#include <string>
+
+namespace eglpp {
+
+namespace {
+
+/**
+ * Prefer Mesa's surfaceless platform, so that we never try to connect to an
+ * X server, and fall back to the default display otherwise.
+ */
+EGLDisplay get_display() {
+  auto get_platform_display =
+    reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      eglGetProcAddress("eglGetPlatformDisplayEXT")
+    );
+  if (get_platform_display != nullptr) {
+    auto display = get_platform_display(
+      EGL_PLATFORM_SURFACELESS_MESA,
+      EGL_DEFAULT_DISPLAY,
+      nullptr
+    );
+    if (display != EGL_NO_DISPLAY) {
+      return display;
+    }
+  }
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+[[noreturn]] void throw_error(const char* what) {
+  throw std::runtime_error(
+    std::string(what) + " failed with EGL error " +
+    std::to_string(eglGetError())
+  );
+}
+
+}
+
+pbuffer_context::pbuffer_context(
+  int width,
+  int height,
+  int major_version,
+  int minor_version
+): width_(width), height_(height) {
+  display_ = get_display();
+  if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+    throw_error("eglInitialize");
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    eglTerminate(display_);
+    throw_error("eglBindAPI");
+  }
+  const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_NONE,
+  };
+  EGLConfig config;
+  EGLint config_count;
+  if (
+    !eglChooseConfig(display_, config_attribs, &config, 1, &config_count) ||
+    config_count == 0
+  ) {
+    eglTerminate(display_);
+    throw_error("eglChooseConfig");
+  }
+  const EGLint surface_attribs[] = {
+    EGL_WIDTH, width,
+    EGL_HEIGHT, height,
+    EGL_NONE,
+  };
+  surface_ = eglCreatePbufferSurface(display_, config, surface_attribs);
+  if (surface_ == EGL_NO_SURFACE) {
+    eglTerminate(display_);
+    throw_error("eglCreatePbufferSurface");
+  }
+  const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, major_version,
+    EGL_CONTEXT_MINOR_VERSION, minor_version,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE,
+  };
+  context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, context_attribs);
+  if (context_ == EGL_NO_CONTEXT) {
+    eglDestroySurface(display_, surface_);
+    eglTerminate(display_);
+    throw_error("eglCreateContext");
+  }
+}
+
+pbuffer_context::~pbuffer_context() {
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display_, context_);
+  eglDestroySurface(display_, surface_);
+  eglTerminate(display_);
+}
+
+void pbuffer_context::make_current() {
+  if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+    throw_error("eglMakeCurrent");
+  }
+}
+
+void pbuffer_context::swap_buffers() {
+  eglSwapBuffers(display_, surface_);
+}
+
+void pbuffer_context::get_framebuffer_size(int* width, int* height) const {
+  *width = width_;
+  *height = height_;
+}
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+#ifdef __linux__
+#include <EGL/egl.h>
+
+namespace eglpp {
+
+/**
+ * An OpenGL core context rendering into an offscreen pbuffer, that doesn't
+ * need any display server. With Mesa, this works on the `llvmpipe` software
+ * renderer when no GPU is available.
+ */
+struct pbuffer_context {
+  pbuffer_context(int width, int height, int major_version, int minor_version);
+  ~pbuffer_context();
+  pbuffer_context(pbuffer_context&) = delete;
+
+  void make_current();
+  void swap_buffers();
+  void get_framebuffer_size(int* width, int* height) const;
+
+private:
+  EGLDisplay display_;
+  EGLSurface surface_;
+  EGLContext context_;
+  int width_;
+  int height_;
+};
+
+}
+
+#endif
@@ -3,14 +3,16 @@
 
 namespace glfwpp {
 
-context::context() {
+context::context(): initialized_(true) {
   if (!glfwInit()) {
     throw std::runtime_error("cannot initialize GLFW");
   }
 }
 
 context::~context() {
-  glfwTerminate();
+  if (initialized_) {
+    glfwTerminate();
+  }
 }
 
 }
@@ -8,7 +8,9 @@ struct context {
   context();
   ~context();
   context(context&) = delete;
-  context(context&&) {}
+  context(context&& other): initialized_(other.initialized_) {
+    other.initialized_ = false;
+  }
 
   void window_hint(int target, int value) {
     glfwWindowHint(target, value);
@@ -21,6 +23,12 @@ struct context {
   GLFWkeyfun set_key_callback(const window& window, GLFWkeyfun cbfun) {
     return glfwSetKeyCallback(window.handle(), cbfun);
   }
+
+private:
+  /**
+   * Only one context terminates GLFW.
+   */
+  bool initialized_;
 };
 
 }
@@ -10,12 +10,15 @@ window::window(int width, int height, const char *title, GLFWmonitor *monitor, G
   }
 }
 
-window::window(const window&& window) {
+window::window(window&& window) {
   handle_ = window.handle_;
+  window.handle_ = nullptr;
 }
 
 window::~window() {
-  glfwDestroyWindow(handle_);
+  if (handle_) {
+    glfwDestroyWindow(handle_);
+  }
 }
 
 void window::get_framebuffer_size(int* width, int* height) const {
@@ -26,6 +29,10 @@ int window::should_close() const {
   return glfwWindowShouldClose(handle_);
 }
 
+void window::set_title(const char* title) {
+  glfwSetWindowTitle(handle_, title);
+}
+
 void window::swap_buffers() {
   glfwSwapBuffers(handle_);
 }
@@ -5,12 +5,13 @@ namespace glfwpp {
 
 struct window {
   window(int width, int height, const char *title, GLFWmonitor *monitor, GLFWwindow *share);
-  window(const window&& window);
+  window(window&& window);
   window(window&) = delete;
   ~window();
 
   void get_framebuffer_size(int* width, int* height) const;
   int should_close() const;
+  void set_title(const char* title);
   void swap_buffers();
   GLFWwindow* handle() const {
     return handle_;
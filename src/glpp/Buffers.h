@@ -1,5 +1,7 @@
 #pragma once
 #include "../opengl.h"
+#include "state.h"
+#include <algorithm>
 
 namespace glpp {
 
@@ -9,10 +11,15 @@ public:
   buffers() {
     glGenBuffers(TCount, handles_);
   }
-  buffers(const buffers&& other) {
-    handles_ = other.handles_;
+  /**
+   * The other one is left without buffers, so they get deleted once.
+   */
+  buffers(buffers&& other) {
+    std::copy(other.handles_, other.handles_ + TCount, handles_);
+    std::fill(other.handles_, other.handles_ + TCount, 0);
   }
   ~buffers() {
+    state::forget_buffers(TCount, handles_);
     glDeleteBuffers(TCount, handles_);
   }
   buffers(buffers&) = delete;
@@ -1,16 +1,96 @@
 #include "program.h"
+#include "state.h"
+#include <algorithm>
+#include <cstring>
 
 namespace glpp {
 
+namespace {
+
+/**
+ * Sorted by name. Arrays are named after their first element, without the
+ * `[0]` suffix, as `glGetUniformLocation` accepts both.
+ */
+template <typename TVariable, typename TGetActive, typename TGetLocation>
+std::vector<TVariable> reflect(
+  GLuint program,
+  GLenum count_name,
+  GLenum max_length_name,
+  TGetActive get_active,
+  TGetLocation get_location
+) {
+  GLint count = 0;
+  GLint max_length = 0;
+  glGetProgramiv(program, count_name, &count);
+  glGetProgramiv(program, max_length_name, &max_length);
+  std::vector<GLchar> name(std::max(max_length, 1));
+  std::vector<TVariable> result;
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size;
+    GLenum type;
+    get_active(program, i, name.size(), &length, &size, &type, name.data());
+    std::string variable_name(name.data(), length);
+    auto bracket = variable_name.find('[');
+    if (bracket != std::string::npos) {
+      variable_name.resize(bracket);
+    }
+    auto location = get_location(program, name.data());
+    // Built-in variables don't have any.
+    if (location >= 0) {
+      result.push_back({variable_name, location});
+    }
+  }
+  std::sort(
+    result.begin(),
+    result.end(),
+    [](const TVariable& left, const TVariable& right) {
+      return left.name < right.name;
+    }
+  );
+  return result;
+}
+
+template <typename TVariable>
+GLint find_location(
+  const std::vector<TVariable>& variables,
+  const GLchar* name
+) {
+  auto found = std::lower_bound(
+    variables.begin(),
+    variables.end(),
+    name,
+    [](const TVariable& variable, const GLchar* name) {
+      return std::strcmp(variable.name.c_str(), name) < 0;
+    }
+  );
+  if (found == variables.end() || found->name != name) {
+    return -1;
+  }
+  return found->location;
+}
+
+}
+
 program::program() {
   handle_ = glCreateProgram();
 }
 
-program::program(const program&& other) {
-  handle_ = other.handle_;
+program::program(program&& other):
+  handle_(other.handle_),
+  uniforms_(std::move(other.uniforms_)),
+  attribs_(std::move(other.attribs_)),
+  value_indices_(std::move(other.value_indices_)),
+  values_(std::move(other.values_)),
+  known_values_(std::move(other.known_values_)) {
+  other.handle_ = 0;
 }
 
 program::~program() {
+  if (handle_ == 0) {
+    return;
+  }
+  state::forget_program(handle_);
   glDeleteProgram(handle_);
 }
 
@@ -18,24 +98,136 @@ void program::attach_shader(const shader& target) {
   glAttachShader(handle_, target.handle());
 }
 
-GLint program::get_attrib_location(const GLchar* name) {
-  return glGetAttribLocation(handle_, name);
+GLint program::get_attrib_location(const GLchar* name) const {
+  return find_location(attribs_, name);
 }
 
 void program::get_programiv(GLenum pname, GLint* params) {
   glGetProgramiv(handle_, pname, params);
 }
 
-GLint program::get_uniform_location(const GLchar* name) {
-  return glGetUniformLocation(handle_, name);
+GLint program::get_uniform_location(const GLchar* name) const {
+  return find_location(uniforms_, name);
 }
 
 void program::link() {
   glLinkProgram(handle_);
+  GLint status;
+  glGetProgramiv(handle_, GL_LINK_STATUS, &status);
+  if (status) {
+    reflect_();
+  }
+}
+
+void program::set_binary_retrievable() {
+  glProgramParameteri(handle_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+std::vector<std::uint8_t> program::get_binary(GLenum& format) const {
+  GLint length = 0;
+  glGetProgramiv(handle_, GL_PROGRAM_BINARY_LENGTH, &length);
+  std::vector<std::uint8_t> result(length);
+  GLsizei written = 0;
+  glGetProgramBinary(handle_, length, &written, &format, result.data());
+  result.resize(written);
+  return result;
+}
+
+bool program::load_binary(GLenum format, const void* binary, GLsizei size) {
+  glProgramBinary(handle_, format, binary, size);
+  GLint status;
+  glGetProgramiv(handle_, GL_LINK_STATUS, &status);
+  if (!status) {
+    return false;
+  }
+  reflect_();
+  return true;
+}
+
+void program::reflect_() {
+  uniforms_ = reflect<variable>(
+    handle_,
+    GL_ACTIVE_UNIFORMS,
+    GL_ACTIVE_UNIFORM_MAX_LENGTH,
+    glGetActiveUniform,
+    glGetUniformLocation
+  );
+  attribs_ = reflect<variable>(
+    handle_,
+    GL_ACTIVE_ATTRIBUTES,
+    GL_ACTIVE_ATTRIBUTE_MAX_LENGTH,
+    glGetActiveAttrib,
+    glGetAttribLocation
+  );
+  GLint max_location = -1;
+  for (const auto& uniform: uniforms_) {
+    max_location = std::max(max_location, uniform.location);
+  }
+  value_indices_.assign(max_location + 1, -1);
+  for (size_t i = 0; i < uniforms_.size(); ++i) {
+    value_indices_[uniforms_[i].location] = static_cast<GLint>(i);
+  }
+  values_.assign(uniforms_.size() * MAX_UNIFORM_SIZE, 0);
+  known_values_.assign(uniforms_.size(), false);
 }
 
 void program::use() {
-  glUseProgram(handle_);
+  state::use_program(handle_);
+}
+
+void program::uniform_1i(GLint location, GLint value) {
+  if (update_uniform_(location, &value, sizeof(value))) {
+    glUniform1i(location, value);
+  }
+}
+
+void program::uniform_1f(GLint location, GLfloat value) {
+  if (update_uniform_(location, &value, sizeof(value))) {
+    glUniform1f(location, value);
+  }
+}
+
+void program::uniform_2f(GLint location, GLfloat x, GLfloat y) {
+  const GLfloat value[] = {x, y};
+  if (update_uniform_(location, value, sizeof(value))) {
+    glUniform2f(location, x, y);
+  }
+}
+
+void program::uniform_3fv(GLint location, const GLfloat* value) {
+  if (update_uniform_(location, value, 3 * sizeof(GLfloat))) {
+    glUniform3fv(location, 1, value);
+  }
+}
+
+void program::uniform_matrix_4fv(GLint location, const GLfloat* value) {
+  if (update_uniform_(location, value, 16 * sizeof(GLfloat))) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+  }
+}
+
+bool program::update_uniform_(
+  GLint location,
+  const void* value,
+  size_t size
+) {
+  auto index = location >= 0 &&
+    location < static_cast<GLint>(value_indices_.size())
+    ? value_indices_[location]
+    : -1;
+  if (index < 0) {
+    state::count_call(true);
+    return true;
+  }
+  auto* cached = &values_[index * MAX_UNIFORM_SIZE];
+  if (known_values_[index] && std::memcmp(cached, value, size) == 0) {
+    state::count_call(false);
+    return false;
+  }
+  std::memcpy(cached, value, size);
+  known_values_[index] = true;
+  state::count_call(true);
+  return true;
 }
 
 }
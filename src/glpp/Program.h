@@ -1,27 +1,91 @@
 #pragma once
 #include "../opengl.h"
 #include "shader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace glpp {
 
+/**
+ * Uniform and attribute locations are looked up once after linking, and
+ * then come from a table. Uniform setters apply to the program in use, and
+ * skip values the uniform already has, see `state`.
+ */
 class program {
 public:
   program();
-  program(const program&&);
+  /**
+   * The other one is left without a program, so it gets deleted once.
+   */
+  program(program&& other);
   ~program();
   program(program&) = delete;
   void attach_shader(const shader& shader);
-  GLint get_attrib_location(const GLchar* name);
+  GLint get_attrib_location(const GLchar* name) const;
   void get_programiv(GLenum pname, GLint* params);
-  GLint get_uniform_location(const GLchar* name);
+  GLint get_uniform_location(const GLchar* name) const;
   GLuint handle() const {
     return handle_;
   }
   void link();
   void use();
 
+  /**
+   * Tell the driver that the binary is going to be retrieved, before
+   * linking.
+   */
+  void set_binary_retrievable();
+
+  /**
+   * The linked program in the driver's own format, for `load_binary()` to
+   * restore it on the next runs.
+   */
+  std::vector<std::uint8_t> get_binary(GLenum& format) const;
+
+  /**
+   * Link from a binary of `get_binary()`, instead of shaders. Return false
+   * if the driver rejects it, ex. after an update, as if linking failed.
+   */
+  bool load_binary(GLenum format, const void* binary, GLsizei size);
+
+  void uniform_1i(GLint location, GLint value);
+  void uniform_1f(GLint location, GLfloat value);
+  void uniform_2f(GLint location, GLfloat x, GLfloat y);
+  void uniform_3fv(GLint location, const GLfloat* value);
+  void uniform_matrix_4fv(GLint location, const GLfloat* value);
+
 private:
+  struct variable {
+    std::string name;
+    GLint location;
+  };
+
+  /**
+   * Components of the largest uniform type set, a 4x4 matrix.
+   */
+  static const size_t MAX_UNIFORM_SIZE = 16;
+
+  /**
+   * Whether the uniform at `location` gets a different value, that gets
+   * remembered. Unknown locations, like -1, always do.
+   */
+  bool update_uniform_(GLint location, const void* value, size_t size);
+
+  /**
+   * Look up the locations, once linked.
+   */
+  void reflect_();
+
   GLuint handle_;
+  std::vector<variable> uniforms_;
+  std::vector<variable> attribs_;
+  /**
+   * By location, the index of the value of each uniform, if any.
+   */
+  std::vector<GLint> value_indices_;
+  std::vector<GLfloat> values_;
+  std::vector<bool> known_values_;
 };
 
 }
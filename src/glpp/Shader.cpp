@@ -6,8 +6,9 @@ shader::shader(GLenum shaderType) {
   handle_ = glCreateShader(shaderType);
 }
 
-shader::shader(const shader&& shader) {
+shader::shader(shader&& shader) {
   handle_ = shader.handle_;
+  shader.handle_ = 0;
 }
 
 shader::~shader() {
@@ -6,7 +6,7 @@ namespace glpp {
 class shader {
 public:
   shader(GLenum shaderType);
-  shader(const shader&& shader);
+  shader(shader&& shader);
   ~shader();
   shader(shader&) = delete;
   void source(GLsizei count, const GLchar **string, const GLint *length);
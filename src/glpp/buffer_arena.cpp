@@ -0,0 +1,90 @@
+#include "buffer_arena.h"
+#include "state.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace glpp {
+
+buffer_arena::buffer_arena(size_t block_size):
+  block_size_(block_size), allocated_bytes_(0) {}
+
+buffer_arena::~buffer_arena() {
+  for (const auto& block: blocks_) {
+    state::forget_buffers(1, &block.buffer);
+    glDeleteBuffers(1, &block.buffer);
+  }
+}
+
+buffer_arena::range buffer_arena::allocate(size_t size, size_t alignment) {
+  if (size == 0) {
+    return {0, 0, 0};
+  }
+  for (auto& block: blocks_) {
+    auto& free_ranges = block.free_ranges;
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+      auto start = it->first;
+      auto end = start + it->second;
+      auto offset = (start + alignment - 1) / alignment * alignment;
+      if (offset + size > end) {
+        continue;
+      }
+      free_ranges.erase(it);
+      if (offset > start) {
+        free_ranges[start] = offset - start;
+      }
+      if (offset + size < end) {
+        free_ranges[offset + size] = end - offset - size;
+      }
+      allocated_bytes_ += size;
+      return {block.buffer, offset, size};
+    }
+  }
+
+  block created;
+  auto block_size = std::max(block_size_, size);
+  glGenBuffers(1, &created.buffer);
+  state::bind_buffer(GL_COPY_WRITE_BUFFER, created.buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, block_size, nullptr, GL_STATIC_DRAW);
+  if (size < block_size) {
+    created.free_ranges[size] = block_size - size;
+  }
+  blocks_.push_back(std::move(created));
+  allocated_bytes_ += size;
+  return {blocks_.back().buffer, 0, size};
+}
+
+void buffer_arena::free(const range& range) {
+  if (range.size == 0) {
+    return;
+  }
+  auto found = std::find_if(
+    blocks_.begin(),
+    blocks_.end(),
+    [&range](const block& candidate) {
+      return candidate.buffer == range.buffer;
+    }
+  );
+  if (found == blocks_.end()) {
+    throw std::logic_error("freeing a range of another arena");
+  }
+  auto& free_ranges = found->free_ranges;
+  auto start = range.offset;
+  auto end = range.offset + range.size;
+  auto next = free_ranges.lower_bound(start);
+  if (next != free_ranges.end() && next->first == end) {
+    end += next->second;
+    next = free_ranges.erase(next);
+  }
+  if (next != free_ranges.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == start) {
+      start = previous->first;
+      free_ranges.erase(previous);
+    }
+  }
+  free_ranges[start] = end - start;
+  allocated_bytes_ -= range.size;
+}
+
+}
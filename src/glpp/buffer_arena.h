@@ -0,0 +1,65 @@
+#pragma once
+#include "../opengl.h"
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace glpp {
+
+/**
+ * Sub-allocates ranges out of a few large buffers, so that meshes coming and
+ * going reuse the same storage instead of each getting a buffer of its own
+ * from the driver. Vertices and indices can share a buffer: attribute
+ * pointers and draw calls just add the offset of their range.
+ */
+class buffer_arena {
+public:
+  struct range {
+    GLuint buffer;
+    size_t offset;
+    size_t size;
+  };
+
+  /**
+   * Buffers get allocated `block_size` bytes at a time, or more for larger
+   * ranges.
+   */
+  buffer_arena(size_t block_size);
+  ~buffer_arena();
+  buffer_arena(buffer_arena&) = delete;
+
+  /**
+   * Take the first free range that fits, or allocate a new buffer. The
+   * offset is a multiple of `alignment`, not necessarily a power of two.
+   * The content is undefined.
+   */
+  range allocate(size_t size, size_t alignment);
+
+  /**
+   * Give back a range, that gets merged with the free ranges around it.
+   */
+  void free(const range& range);
+
+  size_t buffer_count() const {
+    return blocks_.size();
+  }
+
+  size_t allocated_bytes() const {
+    return allocated_bytes_;
+  }
+
+private:
+  struct block {
+    GLuint buffer;
+    /**
+     * Free ranges, size by offset.
+     */
+    std::map<size_t, size_t> free_ranges;
+  };
+
+  size_t block_size_;
+  std::vector<block> blocks_;
+  size_t allocated_bytes_;
+};
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "../opengl.h"
+
+namespace glpp {
+
+template <int TCount>
+class framebuffers {
+public:
+  framebuffers() {
+    glGenFramebuffers(TCount, handles_);
+  }
+  ~framebuffers() {
+    glDeleteFramebuffers(TCount, handles_);
+  }
+  framebuffers(framebuffers&) = delete;
+  const GLuint* handles() const {
+    return handles_;
+  }
+
+private:
+  GLuint handles_[TCount];
+};
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "../opengl.h"
+
+namespace glpp {
+
+template <int TCount>
+class queries {
+public:
+  queries() {
+    glGenQueries(TCount, handles_);
+  }
+  ~queries() {
+    glDeleteQueries(TCount, handles_);
+  }
+  queries(queries&) = delete;
+  const GLuint* handles() const {
+    return handles_;
+  }
+
+private:
+  GLuint handles_[TCount];
+};
+
+}
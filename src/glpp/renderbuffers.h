@@ -0,0 +1,24 @@
+#pragma once
+#include "../opengl.h"
+
+namespace glpp {
+
+template <int TCount>
+class renderbuffers {
+public:
+  renderbuffers() {
+    glGenRenderbuffers(TCount, handles_);
+  }
+  ~renderbuffers() {
+    glDeleteRenderbuffers(TCount, handles_);
+  }
+  renderbuffers(renderbuffers&) = delete;
+  const GLuint* handles() const {
+    return handles_;
+  }
+
+private:
+  GLuint handles_[TCount];
+};
+
+}
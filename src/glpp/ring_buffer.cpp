@@ -0,0 +1,90 @@
+#include "ring_buffer.h"
+#include "state.h"
+
+namespace glpp {
+
+namespace {
+
+/**
+ * Covers `GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT` on all the hardware around.
+ */
+const size_t SECTION_ALIGNMENT = 256;
+
+const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+}
+
+ring_buffer::ring_buffer(size_t section_size):
+  section_size_(
+    (section_size + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT *
+    SECTION_ALIGNMENT
+  ),
+  persistent_(GLEW_ARB_buffer_storage),
+  persistent_data_(nullptr),
+  fences_(),
+  section_(0) {
+  state::bind_buffer(GL_COPY_WRITE_BUFFER, buffer());
+  auto size = section_size_ * SECTION_COUNT;
+  if (!persistent_) {
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    return;
+  }
+  const GLbitfield flags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+  persistent_data_ = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+}
+
+ring_buffer::~ring_buffer() {
+  for (auto fence: fences_) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  if (persistent_) {
+    state::bind_buffer(GL_COPY_WRITE_BUFFER, buffer());
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+}
+
+void* ring_buffer::map() {
+  auto& fence = fences_[section_];
+  if (fence) {
+    while (
+      glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT) ==
+        GL_TIMEOUT_EXPIRED
+    ) {}
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (persistent_) {
+    return static_cast<char*>(persistent_data_) + offset();
+  }
+  state::bind_buffer(GL_COPY_WRITE_BUFFER, buffer());
+  return glMapBufferRange(
+    GL_COPY_WRITE_BUFFER,
+    offset(),
+    section_size_,
+    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+      GL_MAP_INVALIDATE_RANGE_BIT
+  );
+}
+
+void ring_buffer::unmap() {
+  if (persistent_) {
+    return;
+  }
+  state::bind_buffer(GL_COPY_WRITE_BUFFER, buffer());
+  glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+}
+
+void ring_buffer::fence() {
+  auto& fence = fences_[section_];
+  if (fence) {
+    glDeleteSync(fence);
+  }
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  section_ = (section_ + 1) % SECTION_COUNT;
+}
+
+}
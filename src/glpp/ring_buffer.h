@@ -0,0 +1,75 @@
+#pragma once
+#include "../opengl.h"
+#include "buffers.h"
+#include <cstddef>
+
+namespace glpp {
+
+/**
+ * Streams data that changes every frame, like instance transforms. The
+ * buffer has a section per frame in flight: the CPU writes one while the GPU
+ * still reads the previous ones, and a fence per section makes it wait only
+ * when the GPU falls behind by that many frames. There's no implicit
+ * synchronization as with `glBufferSubData` or orphaning.
+ *
+ * With `ARB_buffer_storage`, the buffer stays mapped for good. Otherwise,
+ * as on macOS, each section gets mapped unsynchronized, which the fences
+ * make safe just the same.
+ */
+class ring_buffer {
+public:
+  static const size_t SECTION_COUNT = 3;
+
+  /**
+   * Sections get rounded up to keep the alignment of uniform blocks.
+   */
+  ring_buffer(size_t section_size);
+  ~ring_buffer();
+  ring_buffer(ring_buffer&) = delete;
+
+  /**
+   * Wait for the GPU to be done with the current section, and return where
+   * to write it.
+   */
+  void* map();
+
+  /**
+   * Make the writes visible to the GPU, before drawing.
+   */
+  void unmap();
+
+  /**
+   * Fence the current section, after the calls reading it, and move on to
+   * the next one.
+   */
+  void fence();
+
+  GLuint buffer() const {
+    return buffers_.handles()[0];
+  }
+
+  /**
+   * Offset of the current section in the buffer.
+   */
+  size_t offset() const {
+    return section_ * section_size_;
+  }
+
+  size_t section_size() const {
+    return section_size_;
+  }
+
+  bool is_persistent() const {
+    return persistent_;
+  }
+
+private:
+  size_t section_size_;
+  buffers<1> buffers_;
+  bool persistent_;
+  void* persistent_data_;
+  GLsync fences_[SECTION_COUNT];
+  size_t section_;
+};
+
+}
@@ -0,0 +1,207 @@
+#include "state.h"
+#include <algorithm>
+
+namespace glpp {
+
+namespace state {
+
+namespace {
+
+/**
+ * Targets and units beyond these aren't tracked, and always issued.
+ */
+const GLenum BUFFER_TARGETS[] = {
+  GL_ARRAY_BUFFER,
+  GL_ELEMENT_ARRAY_BUFFER,
+  GL_COPY_READ_BUFFER,
+  GL_COPY_WRITE_BUFFER,
+  GL_PIXEL_PACK_BUFFER,
+  GL_PIXEL_UNPACK_BUFFER,
+  GL_UNIFORM_BUFFER,
+};
+const size_t BUFFER_TARGET_COUNT =
+  sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]);
+
+const GLenum TEXTURE_TARGETS[] = {GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY};
+const size_t TEXTURE_TARGET_COUNT =
+  sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]);
+const size_t TEXTURE_UNIT_COUNT = 16;
+
+const GLenum CAPABILITIES[] = {
+  GL_BLEND,
+  GL_CULL_FACE,
+  GL_DEPTH_TEST,
+  GL_SCISSOR_TEST,
+  GL_STENCIL_TEST,
+};
+const size_t CAPABILITY_COUNT = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+
+/**
+ * A value of the context, that may not be known.
+ */
+struct binding {
+  bool known;
+  GLuint value;
+
+  /**
+   * Return whether the call changing it to `target` must be issued.
+   */
+  bool set(GLuint target) {
+    if (known && value == target) {
+      count_call(false);
+      return false;
+    }
+    known = true;
+    value = target;
+    count_call(true);
+    return true;
+  }
+
+  void forget(GLuint name) {
+    if (value == name) {
+      known = false;
+    }
+  }
+};
+
+struct context_state {
+  binding program;
+  binding vertex_array;
+  binding buffers[BUFFER_TARGET_COUNT];
+  binding active_texture;
+  binding textures[TEXTURE_UNIT_COUNT][TEXTURE_TARGET_COUNT];
+  binding capabilities[CAPABILITY_COUNT];
+  call_counts counts;
+};
+
+context_state current = {};
+
+template <size_t TCount>
+size_t find(const GLenum (&values)[TCount], GLenum value) {
+  return std::find(values, values + TCount, value) - values;
+}
+
+void set_capability(GLenum capability, bool enabled) {
+  auto ix = find(CAPABILITIES, capability);
+  if (ix < CAPABILITY_COUNT && !current.capabilities[ix].set(enabled)) {
+    return;
+  }
+  if (ix == CAPABILITY_COUNT) {
+    count_call(true);
+  }
+  if (enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+}
+
+}
+
+void use_program(GLuint program) {
+  if (current.program.set(program)) {
+    glUseProgram(program);
+  }
+}
+
+void bind_vertex_array(GLuint vertex_array) {
+  if (!current.vertex_array.set(vertex_array)) {
+    return;
+  }
+  glBindVertexArray(vertex_array);
+  current.buffers[find(BUFFER_TARGETS, GL_ELEMENT_ARRAY_BUFFER)].known =
+    false;
+}
+
+void bind_buffer(GLenum target, GLuint buffer) {
+  auto ix = find(BUFFER_TARGETS, target);
+  if (ix == BUFFER_TARGET_COUNT) {
+    count_call(true);
+  } else if (!current.buffers[ix].set(buffer)) {
+    return;
+  }
+  glBindBuffer(target, buffer);
+}
+
+void active_texture(GLenum unit) {
+  if (current.active_texture.set(unit)) {
+    glActiveTexture(unit);
+  }
+}
+
+void bind_texture(GLenum target, GLuint texture) {
+  auto ix = find(TEXTURE_TARGETS, target);
+  auto unit = current.active_texture.known
+    ? current.active_texture.value - GL_TEXTURE0
+    : TEXTURE_UNIT_COUNT;
+  if (ix < TEXTURE_TARGET_COUNT && unit >= TEXTURE_UNIT_COUNT) {
+    // It could be any unit.
+    for (auto& bindings: current.textures) {
+      bindings[ix].known = false;
+    }
+  }
+  if (ix == TEXTURE_TARGET_COUNT || unit >= TEXTURE_UNIT_COUNT) {
+    count_call(true);
+  } else if (!current.textures[unit][ix].set(texture)) {
+    return;
+  }
+  glBindTexture(target, texture);
+}
+
+void enable(GLenum capability) {
+  set_capability(capability, true);
+}
+
+void disable(GLenum capability) {
+  set_capability(capability, false);
+}
+
+void forget_program(GLuint program) {
+  current.program.forget(program);
+}
+
+void forget_vertex_arrays(GLsizei count, const GLuint* vertex_arrays) {
+  for (GLsizei i = 0; i < count; ++i) {
+    current.vertex_array.forget(vertex_arrays[i]);
+  }
+}
+
+void forget_buffers(GLsizei count, const GLuint* buffers) {
+  for (GLsizei i = 0; i < count; ++i) {
+    for (auto& binding: current.buffers) {
+      binding.forget(buffers[i]);
+    }
+  }
+}
+
+void forget_textures(GLsizei count, const GLuint* textures) {
+  for (GLsizei i = 0; i < count; ++i) {
+    for (auto& unit: current.textures) {
+      for (auto& binding: unit) {
+        binding.forget(textures[i]);
+      }
+    }
+  }
+}
+
+void invalidate() {
+  auto counts = current.counts;
+  current = context_state();
+  current.counts = counts;
+}
+
+void count_call(bool issued) {
+  ++(issued ? current.counts.issued : current.counts.elided);
+}
+
+call_counts get_call_counts() {
+  return current.counts;
+}
+
+void reset_call_counts() {
+  current.counts = {0, 0};
+}
+
+}
+
+}
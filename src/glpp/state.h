@@ -0,0 +1,63 @@
+#pragma once
+#include "../opengl.h"
+#include <cstddef>
+
+namespace glpp {
+
+/**
+ * Shadow of the bindings and capabilities of the current context. Calls go
+ * through it so that those that wouldn't change anything never reach the
+ * driver. Anything changing that state directly must `invalidate()` it
+ * after. Only for a single context, used from a single thread.
+ */
+namespace state {
+
+struct call_counts {
+  size_t issued;
+  size_t elided;
+};
+
+void use_program(GLuint program);
+void bind_vertex_array(GLuint vertex_array);
+
+/**
+ * The element array buffer binding is part of the vertex array, so it's
+ * only elided until another vertex array gets bound.
+ */
+void bind_buffer(GLenum target, GLuint buffer);
+void active_texture(GLenum unit);
+
+/**
+ * Bind to the active texture unit.
+ */
+void bind_texture(GLenum target, GLuint texture);
+void enable(GLenum capability);
+void disable(GLenum capability);
+
+/**
+ * Deleted objects get unbound, and their names reused.
+ */
+void forget_program(GLuint program);
+void forget_vertex_arrays(GLsizei count, const GLuint* vertex_arrays);
+void forget_buffers(GLsizei count, const GLuint* buffers);
+void forget_textures(GLsizei count, const GLuint* textures);
+
+/**
+ * Forget everything, to issue all the next calls.
+ */
+void invalidate();
+
+/**
+ * Count a call made elsewhere, ex. by `program` uniform setters.
+ */
+void count_call(bool issued);
+
+/**
+ * Calls since the last reset, ex. in the current frame.
+ */
+call_counts get_call_counts();
+void reset_call_counts();
+
+}
+
+}
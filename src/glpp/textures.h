@@ -0,0 +1,26 @@
+#pragma once
+#include "../opengl.h"
+#include "state.h"
+
+namespace glpp {
+
+template <int TCount>
+class textures {
+public:
+  textures() {
+    glGenTextures(TCount, handles_);
+  }
+  ~textures() {
+    state::forget_textures(TCount, handles_);
+    glDeleteTextures(TCount, handles_);
+  }
+  textures(textures&) = delete;
+  const GLuint* handles() const {
+    return handles_;
+  }
+
+private:
+  GLuint handles_[TCount];
+};
+
+}
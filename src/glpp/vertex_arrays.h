@@ -1,5 +1,7 @@
 #pragma once
 #include "../opengl.h"
+#include "state.h"
+#include <algorithm>
 
 namespace glpp {
 
@@ -9,10 +11,12 @@ public:
   vertex_arrays() {
     glGenVertexArrays(TCount, handles_);
   }
-  vertex_arrays(const vertex_arrays&& other) {
-    handles_ = other.handles_;
+  vertex_arrays(vertex_arrays&& other) {
+    std::copy(other.handles_, other.handles_ + TCount, handles_);
+    std::fill(other.handles_, other.handles_ + TCount, 0);
   }
   ~vertex_arrays() {
+    state::forget_vertex_arrays(TCount, handles_);
     glDeleteVertexArrays(TCount, handles_);
   }
   vertex_arrays(vertex_arrays&) = delete;
@@ -1,21 +1,41 @@
-#include "ds/icosahedron.h"
+#include "ds/bodies.h"
+#include "ds/body_renderer.h"
+#include "ds/cdlod_renderer.h"
+#include "ds/dynamic_resolution.h"
+#include "ds/frame_pacer.h"
+#include "ds/frame_recorder.h"
+#include "ds/gpu_timer.h"
+#include "ds/meshlet_renderer.h"
+#include "ds/ocean_renderer.h"
+#include "ds/planet.h"
+#include "ds/planet_cache.h"
+#include "ds/program_cache.h"
+#include "ds/resource_pack.h"
 #include "ds/shaders.h"
 #include "ds/system_error.h"
+#include "ds/trace.h"
+#include "eglpp/pbuffer_context.h"
 #include "glfwpp/context.h"
 #include "glfwpp/window.h"
+#include "glpp/buffer_arena.h"
 #include "glpp/buffers.h"
 #include "glpp/program.h"
 #include "glpp/shader.h"
+#include "glpp/state.h"
 #include "glpp/vertex_arrays.h"
 #include "opengl.h"
 #include "resources.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <future>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
-#include <map>
-#include <random>
+#include <limits>
+#include <memory>
 #include <sstream>
 #include <thread>
 #include <vector>
@@ -37,24 +57,228 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 enum class window_mode { WINDOW, FULLSCREEN, };
 
 struct options {
-  options(): show_help(false), window_mode(window_mode::WINDOW) {}
+  options():
+    show_help(false),
+    window_mode(window_mode::WINDOW),
+    headless(false),
+    frames(0),
+    cull(true),
+    optimize_mesh(true),
+    drop_submerged(true),
+    lod(false),
+    lod_error(8),
+    camera_distance(2),
+    body_count(0),
+    pacing(ds::pacing_policy::VSYNC),
+    dynamic_resolution(false) {}
 
   bool show_help;
   window_mode window_mode;
+  /**
+   * Render offscreen as fast as possible, and print frame statistics.
+   */
+  bool headless;
+  /**
+   * Exit after rendering that many frames, zero means never.
+   */
+  size_t frames;
+  /**
+   * Write a Chrome trace of the whole run there, if not empty.
+   */
+  std::string trace_path;
+  ds::planet_options planet;
+  /**
+   * Skip the parts of the planet mesh that can't be seen.
+   */
+  bool cull;
+  /**
+   * Reorder the planet mesh for the vertex cache and against overdraw.
+   */
+  bool optimize_mesh;
+  /**
+   * Drop the planet mesh under the ocean, that gets drawn as a sphere.
+   */
+  bool drop_submerged;
+  /**
+   * Keep the planet meshes and program binaries in this directory across
+   * runs, if not empty.
+   */
+  std::string cache_dir;
+  /**
+   * Load resources from this pack file rather than the one linked in the
+   * binary, if not empty.
+   */
+  std::string resource_pack;
+  /**
+   * Draw the planet with continuous levels of detail, rather than its
+   * whole mesh.
+   */
+  bool lod;
+  /**
+   * Screen-space error, in pixels, above which LOD patches get refined.
+   */
+  float lod_error;
+  /**
+   * Distance from the camera to the center of the planet, whose radius is
+   * about 1.
+   */
+  float camera_distance;
+  /**
+   * Small planets orbiting around the big one.
+   */
+  size_t body_count;
+  /**
+   * How windowed frames get paced. Headless frames are always uncapped.
+   */
+  ds::pacing_policy pacing;
+  /**
+   * Render at a lower resolution when the GPU can't keep up with the frame
+   * rate, then upscale.
+   */
+  bool dynamic_resolution;
+  /**
+   * Record the frames to this file, if not empty.
+   */
+  std::string record_path;
 };
 
+const size_t DEFAULT_HEADLESS_FRAMES = 600;
+
+static size_t parse_positive_integer(
+  const std::string& arg,
+  const std::string& value
+) {
+  size_t end = 0;
+  unsigned long result = 0;
+  try {
+    result = std::stoul(value, &end);
+  } catch (const std::logic_error&) {}
+  if (end == 0 || end != value.size() || result == 0) {
+    throw std::runtime_error(
+      "expected a positive integer for `" + arg + "`, got `" + value + "`"
+    );
+  }
+  return result;
+}
+
+static float parse_positive_float(
+  const std::string& arg,
+  const std::string& value
+) {
+  size_t end = 0;
+  float result = 0;
+  try {
+    result = std::stof(value, &end);
+  } catch (const std::logic_error&) {}
+  if (end == 0 || end != value.size() || !(result > 0)) {
+    throw std::runtime_error(
+      "expected a positive number for `" + arg + "`, got `" + value + "`"
+    );
+  }
+  return result;
+}
+
+static ds::pacing_policy parse_pacing_policy(const std::string& name) {
+  if (name == "vsync") {
+    return ds::pacing_policy::VSYNC;
+  }
+  if (name == "hybrid") {
+    return ds::pacing_policy::HYBRID;
+  }
+  if (name == "uncapped") {
+    return ds::pacing_policy::UNCAPPED;
+  }
+  throw std::runtime_error("unknown pacing policy: `" + name + "`");
+}
+
+static ds::terrain_generator parse_terrain(const std::string& name) {
+  if (name == "plane-cuts") {
+    return ds::terrain_generator::PLANE_CUTS;
+  }
+  if (name == "noise") {
+    return ds::terrain_generator::NOISE;
+  }
+  throw std::runtime_error("unknown terrain generator: `" + name + "`");
+}
+
+static ds::terrain_kernel parse_terrain_kernel(const std::string& name) {
+  if (name == "reference") {
+    return ds::terrain_kernel::REFERENCE;
+  }
+  if (name == "simd") {
+    return ds::terrain_kernel::SIMD;
+  }
+  throw std::runtime_error("unknown terrain kernel: `" + name + "`");
+}
+
+/**
+ * Consume the argument following option `arg`, that is its value.
+ */
+static std::string shift_value(const std::string& arg, int& argc, char**& argv) {
+  if (argc < 2) {
+    throw std::runtime_error("expected a value after `" + arg + "`");
+  }
+  ++argv, --argc;
+  return *argv;
+}
+
 static options parse_options(int argc, char* argv[]) {
   options result;
   for (++argv, --argc; argc > 0; ++argv, --argc) {
     const auto arg = std::string(*argv);
     if (arg == "--fullscreen" || arg == "-f") {
       result.window_mode = window_mode::FULLSCREEN;
+    } else if (arg == "--frequency") {
+      result.planet.frequency =
+        parse_positive_integer(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--terrain") {
+      result.planet.terrain = parse_terrain(shift_value(arg, argc, argv));
+    } else if (arg == "--terrain-kernel") {
+      result.planet.kernel =
+        parse_terrain_kernel(shift_value(arg, argc, argv));
+    } else if (arg == "--headless") {
+      result.headless = true;
+    } else if (arg == "--frames") {
+      result.frames =
+        parse_positive_integer(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--trace") {
+      result.trace_path = shift_value(arg, argc, argv);
+    } else if (arg == "--no-culling") {
+      result.cull = false;
+    } else if (arg == "--no-mesh-optimization") {
+      result.optimize_mesh = false;
+    } else if (arg == "--keep-submerged") {
+      result.drop_submerged = false;
+    } else if (arg == "--cache-dir") {
+      result.cache_dir = shift_value(arg, argc, argv);
+    } else if (arg == "--resource-pack") {
+      result.resource_pack = shift_value(arg, argc, argv);
+    } else if (arg == "--lod") {
+      result.lod = true;
+    } else if (arg == "--lod-error") {
+      result.lod_error =
+        parse_positive_float(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--camera-distance") {
+      result.camera_distance =
+        parse_positive_float(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--bodies") {
+      result.body_count =
+        parse_positive_integer(arg, shift_value(arg, argc, argv));
+    } else if (arg == "--pacing") {
+      result.pacing = parse_pacing_policy(shift_value(arg, argc, argv));
+    } else if (arg == "--dynamic-resolution") {
+      result.dynamic_resolution = true;
+    } else if (arg == "--record") {
+      result.record_path = shift_value(arg, argc, argv);
     } else if (arg == "--help" || arg == "-h") {
       result.show_help = true;
     } else {
       throw std::runtime_error("unknown argument: `" + arg + "`");
     }
   }
+  if (result.headless && result.frames == 0) {
+    result.frames = DEFAULT_HEADLESS_FRAMES;
+  }
   return result;
 }
 
@@ -62,17 +286,110 @@ static int show_help() {
   std::cout << R"END(Usage: gl-demo [options]
 Options:
   --fullscreen, -f          Create a fullscreen window
+  --frequency <n>           Planet mesh subdivision frequency (default 32)
+  --terrain <name>          Terrain generator, `plane-cuts` (default) or
+                            `noise`
+  --terrain-kernel <name>   Terrain kernel, `simd` (default) or `reference`
+  --headless                Render offscreen without frame rate limit, then
+                            print frame statistics (Linux only)
+  --frames <n>              Exit after rendering that many frames (default
+                            600 when headless)
+  --trace <path>            Write a Chrome/Perfetto trace of CPU and GPU time
+  --no-culling              Draw all of the planet mesh, even the meshlets
+                            that can't be seen
+  --no-mesh-optimization    Draw the planet mesh in the order it's built
+  --keep-submerged          Keep all of the planet mesh, even the parts
+                            under the ocean
+  --cache-dir <path>        Keep planet meshes and linked shaders there, to
+                            load them instantly on the next runs with the
+                            same options
+  --resource-pack <path>    Load shaders from that pack rather than the one
+                            linked in, to change them without relinking
+  --lod                     Draw the planet with continuous levels of detail
+  --lod-error <pixels>      Screen-space error allowed with `--lod` (default 8)
+  --camera-distance <d>     Initial distance of the camera to the planet
+                            center, the radius being about 1 (default 2)
+  --bodies <n>              Draw that many small planets in orbit, instanced
+  --pacing <policy>         `vsync` (default), `hybrid` to sleep then spin
+                            until 60 fps deadlines, or `uncapped`
+  --dynamic-resolution      Lower the resolution when the GPU takes longer
+                            than 60 fps allow, and raise it back after
+  --record <path>           Record the frames as a `.y4m` video, or as raw
+                            RGBA frames with any other extension
   --help, -h                Show this
+Keys:
+  Up, Down                  Zoom in and out
+  N                         Switch to the planet of the next seed
+  Left, Right               Halve or double the planet frequency
+  Escape                    Quit
+The planet is generated in the background, and `--lod` ignores N, Left and
+Right.
 )END";
   return 0;
 }
 
-static glfwpp::window create_window(
+/**
+ * Frame rate aimed at without vsync, and rate of the simulation, that frames
+ * interpolate.
+ */
+const double FRAME_DELTA = 1.0 / 60.0;
+const double SIMULATION_STEP = 1.0 / 120.0;
+
+/**
+ * Radians per second of the planet spin.
+ */
+const float ROTATION_SPEED = 0.3f;
+
+/**
+ * Fraction of the altitude of the camera left after zooming in for a second.
+ */
+const float ZOOM_FACTOR = 0.3f;
+
+const int WINDOW_WIDTH = 800;
+const int WINDOW_HEIGHT = 600;
+const float FOVY = 1.221f;
+
+/**
+ * Lowest scale of the resolution on each axis, with `--dynamic-resolution`.
+ */
+const float MIN_RESOLUTION_SCALE = 0.5f;
+
+/**
+ * Deepest LOD level, and the number of patches kept on the GPU.
+ */
+const size_t LOD_MAX_LEVEL = 16;
+const size_t LOD_CAPACITY = 4096;
+
+/**
+ * Frequencies reachable with the keys.
+ */
+const size_t MIN_FREQUENCY = 2;
+const size_t MAX_FREQUENCY = 256;
+
+/**
+ * Bytes of a new planet mesh uploaded each frame, so that switching planets
+ * never makes a frame miss its deadline.
+ */
+const size_t UPLOAD_BUDGET = 1 << 20;
+
+/**
+ * A planet and the bodies fit in one block at the default frequency, and a
+ * new planet in another while switching.
+ */
+const size_t MESH_ARENA_BLOCK_SIZE = 16 << 20;
+
+static std::unique_ptr<glfwpp::window> create_window(
   glfwpp::context& context,
   window_mode window_mode
 ) {
   if (window_mode == window_mode::WINDOW) {
-    return glfwpp::window(800, 600, "Demo", nullptr, nullptr);
+    return std::unique_ptr<glfwpp::window>(new glfwpp::window(
+      WINDOW_WIDTH,
+      WINDOW_HEIGHT,
+      "Demo",
+      nullptr,
+      nullptr
+    ));
   }
   GLFWmonitor* monitor = glfwGetPrimaryMonitor();
   const GLFWvidmode* mode = glfwGetVideoMode(monitor);
@@ -80,22 +397,232 @@ static glfwpp::window create_window(
   context.window_hint(GLFW_GREEN_BITS, mode->greenBits);
   context.window_hint(GLFW_BLUE_BITS, mode->blueBits);
   context.window_hint(GLFW_REFRESH_RATE, mode->refreshRate);
-  return glfwpp::window(mode->width, mode->height, "Demo", monitor, nullptr);
+  return std::unique_ptr<glfwpp::window>(new glfwpp::window(
+    mode->width,
+    mode->height,
+    "Demo",
+    monitor,
+    nullptr
+  ));
 }
 
-static glfwpp::context create_context() {
-  glfwpp::context context;
+static void set_context_hints(glfwpp::context& context) {
   context.window_hint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   context.window_hint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
   context.window_hint(GLFW_CONTEXT_VERSION_MAJOR, 4);
   context.window_hint(GLFW_CONTEXT_VERSION_MINOR, 1);
   context.window_hint(GLFW_RESIZABLE, GL_FALSE);
-  return context;
 }
 
+/**
+ * Where frames get presented: a GLFW window, or in headless mode an
+ * offscreen EGL pbuffer that doesn't need any display.
+ */
+struct surface {
+  surface(const options& options) {
+    if (options.headless) {
+#ifdef __linux__
+      pbuffer_.reset(
+        new eglpp::pbuffer_context(WINDOW_WIDTH, WINDOW_HEIGHT, 4, 1)
+      );
+      pbuffer_->make_current();
+      return;
+#else
+      throw ds::system_error("headless mode is only supported on Linux");
+#endif
+    }
+    context_.reset(new glfwpp::context());
+    set_context_hints(*context_);
+    glfwSetErrorCallback(error_callback);
+    window_ = create_window(*context_, options.window_mode);
+    context_->make_context_current(*window_);
+    context_->set_key_callback(*window_, key_callback);
+    glfwSwapInterval(options.pacing == ds::pacing_policy::VSYNC ? 1 : 0);
+  }
+
+  bool is_headless() const {
+    return !window_;
+  }
+
+  bool should_close() const {
+    return window_ && window_->should_close();
+  }
+
+  bool is_key_pressed(int key) const {
+    return window_ && glfwGetKey(window_->handle(), key) == GLFW_PRESS;
+  }
+
+  void set_title(const std::string& title) {
+    if (window_) {
+      window_->set_title(title.c_str());
+    }
+  }
+
+  /**
+   * Process pending window events, that update the state of the keys.
+   */
+  void poll_events() {
+    if (window_) {
+      glfwPollEvents();
+    }
+  }
+
+  void get_framebuffer_size(int* width, int* height) const {
+#ifdef __linux__
+    if (pbuffer_) {
+      pbuffer_->get_framebuffer_size(width, height);
+      return;
+    }
+#endif
+    window_->get_framebuffer_size(width, height);
+  }
+
+  /**
+   * Present the frame. As there is nothing to present to in headless mode,
+   * wait for the frame to be rendered instead, so that it's accounted in the
+   * frame time.
+   */
+  void end_frame() {
+#ifdef __linux__
+    if (pbuffer_) {
+      pbuffer_->swap_buffers();
+      glFinish();
+      return;
+    }
+#endif
+    window_->swap_buffers();
+  }
+
+private:
+  std::unique_ptr<glfwpp::context> context_;
+  std::unique_ptr<glfwpp::window> window_;
+#ifdef __linux__
+  std::unique_ptr<eglpp::pbuffer_context> pbuffer_;
+#endif
+};
+
+/**
+ * Load the planet mesh from the cache when possible, or generate it and
+ * save it there.
+ */
+static ds::planet_mesh get_planet_mesh(
+  const options& options,
+  bool& cache_hit
+) {
+  cache_hit = false;
+  if (options.cache_dir.empty()) {
+    return ds::build_planet_mesh(
+      ds::gen_planet(options.planet),
+      options.optimize_mesh,
+      options.drop_submerged
+    );
+  }
+  auto path = ds::get_planet_cache_path(
+    options.cache_dir,
+    options.planet,
+    options.optimize_mesh,
+    options.drop_submerged
+  );
+  ds::planet_mesh result;
+  if (ds::load_planet_mesh(
+    path,
+    options.planet,
+    options.optimize_mesh,
+    options.drop_submerged,
+    result
+  )) {
+    cache_hit = true;
+    return result;
+  }
+  result = ds::build_planet_mesh(
+    ds::gen_planet(options.planet),
+    options.optimize_mesh,
+    options.drop_submerged
+  );
+  ds::save_planet_mesh(
+    options.cache_dir,
+    path,
+    options.planet,
+    options.optimize_mesh,
+    options.drop_submerged,
+    result
+  );
+  return result;
+}
+
+/**
+ * What the simulation steps advance, and frames interpolate.
+ */
+struct scene_state {
+  float rotation;
+  float body_time;
+  /**
+   * See `options::camera_distance`.
+   */
+  float camera_distance;
+};
+
+static void step_scene(
+  scene_state& state,
+  bool zoom_in,
+  bool zoom_out,
+  double step
+) {
+  auto delta = static_cast<float>(step);
+  state.rotation += ROTATION_SPEED * delta;
+  state.body_time += delta;
+  // Zoom at a constant pace relative to the altitude.
+  auto zoom = std::pow(ZOOM_FACTOR, delta);
+  if (zoom_in) {
+    state.camera_distance = 1 + (state.camera_distance - 1) * zoom;
+  }
+  if (zoom_out) {
+    state.camera_distance = 1 + (state.camera_distance - 1) / zoom;
+  }
+}
+
+static scene_state interpolate(
+  const scene_state& from,
+  const scene_state& to,
+  float alpha
+) {
+  return {
+    .rotation = from.rotation + (to.rotation - from.rotation) * alpha,
+    .body_time = from.body_time + (to.body_time - from.body_time) * alpha,
+    .camera_distance = from.camera_distance +
+      (to.camera_distance - from.camera_distance) * alpha,
+  };
+}
+
+/**
+ * Turn the state of a key into presses.
+ */
+class key_press {
+public:
+  key_press(int key): key_(key), was_pressed_(false) {}
+
+  bool poll(const surface& surface) {
+    auto is_pressed = surface.is_key_pressed(key_);
+    auto result = is_pressed && !was_pressed_;
+    was_pressed_ = is_pressed;
+    return result;
+  }
+
+private:
+  int key_;
+  bool was_pressed_;
+};
+
 void enableGlew() {
   glewExperimental = GL_TRUE;
   GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  // GLEW built for GLX still loads all the GL entry points with EGL
+  // contexts, it only fails to find the GLX extensions.
+  if (err == GLEW_ERROR_NO_GLX_DISPLAY) {
+    err = GLEW_OK;
+  }
+#endif
   if(err != GLEW_OK) {
     throw std::runtime_error(
       std::string("cannot initialize GLEW: ") +
@@ -104,11 +631,19 @@ void enableGlew() {
   }
 }
 
-glm::mat4 getPerspectiveProjection(const glfwpp::window& window) {
+/**
+ * The near plane gets closer with the camera, so that the surface doesn't
+ * get clipped when zooming in.
+ */
+glm::mat4 getPerspectiveProjection(
+  const surface& surface,
+  float camera_distance
+) {
   int width, height;
-  window.get_framebuffer_size(&width, &height);
+  surface.get_framebuffer_size(&width, &height);
   float ratio = static_cast<float>(width) / static_cast<float>(height);
-  return glm::perspective(1.221f, ratio, 0.01f, 100.0f);
+  auto near = glm::clamp((camera_distance - 1) * 0.1f, 0.00001f, 0.01f);
+  return glm::perspective(FOVY, ratio, near, 100.0f);
 }
 
 std::ostream &operator<<(std::ostream &os, const glm::vec3& vec) {
@@ -135,148 +670,16 @@ std::ostream &operator<<(std::ostream &os, const std::vector<T>& vector) {
   return std::cout << std::endl << "}";
 }
 
-struct ico_sphere_generator {
-  ds::mesh operator()() {
-    positions_.clear();
-    for (const auto& vertex: ds::icosahedron.vertices) {
-      positions_.push_back(glm::normalize(vertex.position));
-    }
-    std::vector<glm::uvec3> triangles = ds::icosahedron.triangles;
-    for (size_t pass_ix = 0; pass_ix < 5; ++pass_ix) {
-      middle_positions_index_.clear();
-      std::vector<glm::uvec3> new_triangles;
-      for (const auto& triangle: triangles) {
-        auto ix1 = triangle.x;
-        auto ix2 = triangle.y;
-        auto ix3 = triangle.z;
-        auto mid1 = get_middle_position_(ix1, ix2);
-        auto mid2 = get_middle_position_(ix2, ix3);
-        auto mid3 = get_middle_position_(ix3, ix1);
-        new_triangles.push_back({ ix1, mid1, mid3 });
-        new_triangles.push_back({ ix2, mid2, mid1 });
-        new_triangles.push_back({ ix3, mid3, mid2 });
-        new_triangles.push_back({ mid1, mid2, mid3 });
-      }
-      triangles = std::move(new_triangles);
-    }
-    ds::mesh result;
-    result.triangles = std::move(triangles);
-    for (const auto& position: positions_) {
-      result.vertices.push_back({
-        .position = position,
-        .normal = position,
-      });
-    }
-    return result;
-  }
-
-private:
-  size_t get_middle_position_(size_t first, size_t second) {
-    if (first > second) {
-      std::swap(first, second);
-    }
-    std::pair<size_t, size_t> key = {first, second};
-    auto iter = middle_positions_index_.find(key);
-    if (iter != middle_positions_index_.end()) {
-      return iter->second;
-    }
-    const auto& first_vec = positions_[first];
-    const auto& second_vec = positions_[second];
-    glm::vec3 mid_vec = glm::normalize((first_vec + second_vec) * 0.5f);
-    positions_.push_back(mid_vec);
-    auto ix = positions_.size() - 1;
-    middle_positions_index_.insert({ key, ix });
-    return ix;
+static void write_trace(const std::string& path, const ds::gpu_timer& gpu_timer) {
+  std::ofstream file(path);
+  ds::trace::write_json(file);
+  if (!file) {
+    throw ds::system_error("cannot write trace to `" + path + "`");
   }
-
-  std::vector<glm::vec3> positions_;
-  std::map<std::pair<size_t, size_t>, size_t> middle_positions_index_;
-};
-
-void mod_altitude(glm::vec3& position, float amount) {
-  auto length = glm::length(position);
-  position *= (length + amount) / length;
-}
-
-float OCEAN_ALTITUDE = 1.0f;
-float EPSILON = 0.000001f;
-
-glm::vec3 get_gravity_center(const std::vector<ds::vertex>& vertices) {
-  glm::vec3 result;
-  size_t weight = 0;
-  for (const auto& vertex: vertices) {
-    result = (result * static_cast<float>(weight) + vertex.position) /
-      static_cast<float>(weight + 1);
-    weight++;
+  if (gpu_timer.dropped_count() > 0) {
+    std::cerr << "warning: " << gpu_timer.dropped_count()
+      << " GPU timings were not ready in time and got dropped" << std::endl;
   }
-  return result;
-}
-
-void recenter_vertices(std::vector<ds::vertex>& vertices) {
-  auto center = get_gravity_center(vertices);
-  for (auto& vertex: vertices) {
-    vertex.position -= center;
-  }
-}
-
-float get_average_altitude(std::vector<ds::vertex>& vertices) {
-  float result = 0;
-  size_t weight = 0;
-  for (const auto& vertex: vertices) {
-    result =
-      (result * static_cast<float>(weight) + glm::length(vertex.position)) /
-      static_cast<float>(weight + 1);
-    weight++;
-  }
-  return result;
-}
-
-void shake_vertices(std::uint_fast32_t seed, std::vector<ds::vertex>& vertices) {
-  std::mt19937 mt(seed);
-  std::uniform_real_distribution<float> urd(-0.002f, 0.002f);
-  for (auto& vertex: vertices) {
-    vertex.position += urd(mt);
-  }
-}
-
-struct planet {
-  ds::mesh mesh;
-  float ocean_altitude;
-  std::vector<glm::vec3> altitudes;
-};
-
-planet gen_planet(std::uint_fast32_t seed) {
-  auto sphere = ico_sphere_generator()();
-  std::mt19937 mt(seed);
-  std::uniform_real_distribution<float> urd(-1, 1);
-  for (size_t i = 0; i < 500; ++i) {
-    glm::vec3 plane_normal = glm::normalize(glm::vec3({ urd(mt), urd(mt), urd(mt) }));
-    float dist = urd(mt);
-    for (auto& vertex: sphere.vertices) {
-      if (glm::dot(vertex.position, plane_normal) >= dist) {
-        mod_altitude(vertex.position, 0.001f);
-      } else {
-        mod_altitude(vertex.position, -0.001f);
-      }
-    }
-  }
-  recenter_vertices(sphere.vertices);
-  shake_vertices(mt(), sphere.vertices);
-  auto ocean_altitude = get_average_altitude(sphere.vertices) * 1.01f;
-  auto i = 0;
-  std::vector<glm::vec3> altitudes(sphere.vertices.size());
-  for (auto& vertex: sphere.vertices) {
-    altitudes[i++] = vertex.position;
-    auto length = glm::length(vertex.position);
-    if (length < ocean_altitude) {
-      vertex.position *= ocean_altitude / length;
-    }
-  }
-  return {
-    .mesh = sphere,
-    .ocean_altitude = ocean_altitude,
-    .altitudes = altitudes,
-  };
 }
 
 int run(int argc, char* argv[]) {
@@ -284,138 +687,416 @@ int run(int argc, char* argv[]) {
   if (options.show_help) {
     return show_help();
   }
-  auto context = create_context();
-  glfwSetErrorCallback(error_callback);
-  auto window = create_window(context, options.window_mode);
-  context.make_context_current(window);
-  context.set_key_callback(window, key_callback);
+  surface surface(options);
   enableGlew();
 
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_CULL_FACE);
+  glpp::state::enable(GL_DEPTH_TEST);
+  glpp::state::enable(GL_CULL_FACE);
   glDepthFunc(GL_LESS);
   glFrontFace(GL_CCW);
 
-  glpp::vertex_arrays<1> vao;
-  glBindVertexArray(vao.handles()[0]);
-  glpp::buffers<1> vbo;
-  glpp::program program = ds::load_and_link_program(
-    resources::shaders::BASIC_VS,
-    resources::shaders::BASIC_FS
+  auto resource_pack = options.resource_pack.empty()
+    ? std::unique_ptr<ds::resource_pack>(
+      new ds::resource_pack(resources::PACK_DATA, resources::PACK_SIZE)
+    )
+    : ds::resource_pack::open(options.resource_pack);
+  // Programs get cached along with the planets.
+  ds::program_cache program_cache(options.cache_dir);
+  const auto* vertex_shader = options.lod
+    ? resources::shaders::LOD_VS
+    : resources::shaders::BASIC_VS;
+  glpp::program program = program_cache.load_and_link(
+    resource_pack->get(vertex_shader),
+    resource_pack->get(resources::shaders::BASIC_FS)
   );
   program.use();
 
-  auto planet = gen_planet(123);
-  auto object = planet.mesh;
-
-  std::vector<GLfloat> colorData(object.vertices.size() * 3);
-  for(int i = 0; i < colorData.size(); i += 3) {
-    const auto& alt = planet.altitudes[i / 3];
-    auto length = glm::length(alt);
-    if (length <= planet.ocean_altitude) {
-      auto depth = glm::pow(length / planet.ocean_altitude, 5);
-      colorData[i] = 0.1f * depth;
-      colorData[i + 1] = 0.3f * depth;
-      colorData[i + 2] = 0.6f * depth;
-      continue;
-    }
-    auto height = (length - planet.ocean_altitude) / 0.3f;
-    auto coef = height / 0.4f + 0.6f;
-    colorData[i] = 0.9f * coef;
-    colorData[i + 1] = 0.7f * coef;
-    colorData[i + 2] = 0.7f * coef;
-  }
-
-  // Allocate space and upload the data from CPU to GPU
-  auto objectVerticesByteCount = sizeof(ds::vertex) * object.vertices.size();
-  auto colorsByteCount = sizeof(GLfloat) * colorData.size();
-  glBindBuffer(GL_ARRAY_BUFFER, vbo.handles()[0]);
-  auto totalSize = objectVerticesByteCount + colorsByteCount;
-  glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STATIC_DRAW);
-  glBufferSubData(GL_ARRAY_BUFFER, 0, objectVerticesByteCount, object.vertices.data());
-  glBufferSubData(GL_ARRAY_BUFFER, objectVerticesByteCount, colorsByteCount, colorData.data());
-
-  GLint positionAttribute = program.get_attrib_location("position");
-  glVertexAttribPointer(
-    positionAttribute,
-    3,
-    GL_FLOAT,
-    GL_FALSE,
-    sizeof(ds::vertex),
-    reinterpret_cast<void*>(offsetof(ds::vertex, position))
-  );
-  glEnableVertexAttribArray(positionAttribute);
-
-  GLint normalAttribute = program.get_attrib_location("normal");
-  glVertexAttribPointer(
-    normalAttribute,
-    3,
-    GL_FLOAT,
-    GL_FALSE,
-    sizeof(ds::vertex),
-    reinterpret_cast<void*>(offsetof(ds::vertex, normal))
-  );
-  glEnableVertexAttribArray(normalAttribute);
+  if (!options.trace_path.empty()) {
+    ds::trace::start();
+  }
+  // Meshes get sub-allocated from the arena, that outlives the renderers.
+  glpp::buffer_arena mesh_arena(MESH_ARENA_BLOCK_SIZE);
+  // The CDLOD renderer keeps referring to the planet.
+  ds::planet planet;
+  std::unique_ptr<ds::meshlet_renderer> mesh;
+  std::unique_ptr<ds::ocean_renderer> ocean;
+  std::unique_ptr<ds::cdlod_renderer> lod;
+  // The LOD terrain still has its ocean clamped in, so only the meshes need
+  // a program for the ocean.
+  std::unique_ptr<glpp::program> ocean_program;
+  size_t source_triangle_count = 0;
+  size_t submerged_triangle_count = 0;
+  auto setup_start = ds::get_time();
+  bool cache_hit = false;
+  if (options.lod) {
+    planet = ds::gen_planet(options.planet);
+    lod.reset(new ds::cdlod_renderer(
+      planet,
+      program,
+      LOD_MAX_LEVEL,
+      LOD_CAPACITY
+    ));
+  } else {
+    ocean_program.reset(new glpp::program(program_cache.load_and_link(
+      resource_pack->get(resources::shaders::OCEAN_VS),
+      resource_pack->get(resources::shaders::OCEAN_FS)
+    )));
+    auto planet_mesh = get_planet_mesh(options, cache_hit);
+    source_triangle_count = planet_mesh.source_triangle_count;
+    submerged_triangle_count = planet_mesh.submerged_triangle_count;
+    ocean.reset(new ds::ocean_renderer(
+      planet_mesh,
+      *ocean_program,
+      mesh_arena
+    ));
+    mesh.reset(new ds::meshlet_renderer(
+      std::move(planet_mesh),
+      program,
+      mesh_arena
+    ));
+    mesh->upload(std::numeric_limits<size_t>::max());
+  }
+  auto setup_time = ds::get_time() - setup_start;
 
-  GLint color_attr = program.get_attrib_location("color");
-  glVertexAttribPointer(color_attr, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void*>(objectVerticesByteCount));
-  glEnableVertexAttribArray(color_attr);
+  // Bodies have their own program, that gets used only to draw them.
+  std::unique_ptr<glpp::program> body_program;
+  std::unique_ptr<ds::body_renderer> body_renderer;
+  std::vector<ds::body> bodies;
+  std::vector<ds::body_instance> body_instances;
+  GLint body_view_uniform = -1;
+  GLint body_projection_uniform = -1;
+  if (options.body_count > 0) {
+    body_program.reset(new glpp::program(program_cache.load_and_link(
+      resource_pack->get(resources::shaders::BODIES_VS),
+      resource_pack->get(resources::shaders::BASIC_FS)
+    )));
+    body_renderer.reset(new ds::body_renderer(
+      ds::gen_body_meshes(options.planet.seed),
+      *body_program,
+      mesh_arena,
+      options.body_count
+    ));
+    bodies = ds::gen_bodies(options.planet.seed, options.body_count);
+    body_instances.resize(bodies.size());
+    body_view_uniform = body_program->get_uniform_location("View");
+    body_projection_uniform =
+      body_program->get_uniform_location("Projection");
+  }
+  if (program_cache.rejected_count() > 0) {
+    std::cerr << "warning: the driver rejected "
+      << program_cache.rejected_count()
+      << " cached programs, compiled them again" << std::endl;
+  }
 
-  // Transfer the data from indices to eab
-  GLuint eab;
-  glGenBuffers(1, &eab);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eab);
-  auto triangles_byte_size = sizeof(object.triangles[0]) * object.triangles.size();
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangles_byte_size, object.triangles.data(), GL_STATIC_DRAW);
+  // Planets requested with the keys get generated on a worker thread, then
+  // uploaded over several frames, while the current one is still drawn.
+  auto requested_planet = options.planet;
+  auto next_planet = options.planet;
+  std::future<ds::planet_mesh> next_mesh;
+  std::unique_ptr<ds::meshlet_renderer> next_renderer;
+  std::unique_ptr<ds::ocean_renderer> next_ocean;
+  key_press next_seed_key(GLFW_KEY_N);
+  key_press finer_key(GLFW_KEY_RIGHT);
+  key_press coarser_key(GLFW_KEY_LEFT);
 
   GLint model_uniform = program.get_uniform_location("Model");
   GLint view_uniform = program.get_uniform_location("View");
   GLint projection_uniform = program.get_uniform_location("Projection");
 
-  glm::mat4 view = glm::lookAt(
-    glm::vec3(2, 0, 0),
-    glm::vec3(0, 0, 0),
-    glm::vec3(0, 1, 0)
+  int viewport_width, viewport_height;
+  surface.get_framebuffer_size(&viewport_width, &viewport_height);
+  scene_state state = {
+    .rotation = 0,
+    .body_time = 0,
+    .camera_distance = options.camera_distance,
+  };
+  auto previous_state = state;
+  // Headless runs simulate exactly one frame delta per frame, so that they
+  // render the same frames however fast they go.
+  ds::frame_pacer pacer(
+    surface.is_headless() ? ds::pacing_policy::UNCAPPED : options.pacing,
+    FRAME_DELTA,
+    SIMULATION_STEP
   );
-  glUniformMatrix4fv(view_uniform, 1, GL_FALSE, glm::value_ptr(view));
-  glm::mat4 projection = getPerspectiveProjection(window);
-  glUniformMatrix4fv(projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
+  glpp::state::call_counts gl_calls = {0, 0};
+  auto last_input_time = ds::get_time();
+  auto title_time = last_input_time;
+  ds::gpu_timer gpu_timer;
+  std::unique_ptr<ds::dynamic_resolution> resolution;
+  if (options.dynamic_resolution) {
+    resolution.reset(new ds::dynamic_resolution(
+      viewport_width,
+      viewport_height,
+      FRAME_DELTA,
+      MIN_RESOLUTION_SCALE
+    ));
+  }
+  std::unique_ptr<ds::frame_recorder> recorder;
+  if (!options.record_path.empty()) {
+    recorder.reset(new ds::frame_recorder(
+      options.record_path,
+      viewport_width,
+      viewport_height,
+      static_cast<int>(std::lround(1 / FRAME_DELTA))
+    ));
+  }
 
-  auto rot = 0.0f;
-  double target_delta = 1.0 / 60.0;
-  double last_time = glfwGetTime();
-  double extra_time = 0;
+  while (
+    !surface.should_close() &&
+    (options.frames == 0 || pacer.frame_count() < options.frames)
+  ) {
+    DS_TRACE_ZONE("frame");
+    pacer.wait();
+    glpp::state::reset_call_counts();
 
-  while (!window.should_close()) {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Sample the input as late as possible before drawing.
+    surface.poll_events();
+    auto input_time = ds::get_time();
+    auto steps = pacer.advance(
+      surface.is_headless() ? FRAME_DELTA : input_time - last_input_time
+    );
+    last_input_time = input_time;
+    auto zoom_in = surface.is_key_pressed(GLFW_KEY_UP);
+    auto zoom_out = surface.is_key_pressed(GLFW_KEY_DOWN);
+    for (size_t i = 0; i < steps; ++i) {
+      previous_state = state;
+      step_scene(state, zoom_in, zoom_out, pacer.step_delta());
+    }
+    auto frame_state =
+      interpolate(previous_state, state, pacer.get_alpha());
+    auto camera_distance = frame_state.camera_distance;
+    auto frame_height = static_cast<float>(
+      resolution ? resolution->frame_height() : viewport_height
+    );
+
+    if (mesh) {
+      if (next_seed_key.poll(surface)) {
+        ++requested_planet.seed;
+      }
+      if (finer_key.poll(surface)) {
+        requested_planet.frequency =
+          std::min(requested_planet.frequency * 2, MAX_FREQUENCY);
+      }
+      if (coarser_key.poll(surface)) {
+        requested_planet.frequency =
+          std::max(requested_planet.frequency / 2, MIN_FREQUENCY);
+      }
+      if (
+        !next_mesh.valid() &&
+        !next_renderer &&
+        (
+          requested_planet.seed != next_planet.seed ||
+          requested_planet.frequency != next_planet.frequency
+        )
+      ) {
+        next_planet = requested_planet;
+        auto next_options = options;
+        next_options.planet = next_planet;
+        // Leave a hardware thread to the rendering.
+        if (next_options.planet.thread_count == 0) {
+          next_options.planet.thread_count = std::max(
+            std::thread::hardware_concurrency(),
+            2u
+          ) - 1;
+        }
+        next_mesh = std::async(std::launch::async, [next_options]() {
+          bool cache_hit;
+          return get_planet_mesh(next_options, cache_hit);
+        });
+      }
+      if (
+        next_mesh.valid() &&
+        next_mesh.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready
+      ) {
+        auto planet_mesh = next_mesh.get();
+        next_ocean.reset(new ds::ocean_renderer(
+          planet_mesh,
+          *ocean_program,
+          mesh_arena
+        ));
+        next_renderer.reset(new ds::meshlet_renderer(
+          std::move(planet_mesh),
+          program,
+          mesh_arena
+        ));
+      }
+      if (next_renderer && next_renderer->upload(UPLOAD_BUDGET)) {
+        mesh = std::move(next_renderer);
+        ocean = std::move(next_ocean);
+      }
+    }
+
+    auto eye = glm::vec3(camera_distance, 0, 0);
+    glm::mat4 view = glm::lookAt(
+      eye,
+      glm::vec3(0, 0, 0),
+      glm::vec3(0, 1, 0)
+    );
+    glm::mat4 projection = getPerspectiveProjection(surface, camera_distance);
+    program.use();
+    program.uniform_matrix_4fv(view_uniform, glm::value_ptr(view));
+    program.uniform_matrix_4fv(projection_uniform, glm::value_ptr(projection));
 
     auto ident = glm::mat4();
     auto model =
       glm::translate(ident, glm::vec3(0.0f, 0.0f, 0.0f)) *
-      glm::rotate(ident, rot, glm::vec3(0.0f, 1.0f, 0.0f));
-    glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    rot += 0.005f;
-
-    auto vertexCount = object.triangles.size() * 3;
-    glDrawElements(GL_TRIANGLES, vertexCount, GL_UNSIGNED_INT, 0);
-
-    window.swap_buffers();
-    glfwPollEvents();
-
-    double curTime = glfwGetTime();
-    double elapsed_delta = curTime - last_time;
-    double spare_delta = extra_time + target_delta - elapsed_delta;
-    if (spare_delta > 0) {
-      auto ms = spare_delta * 1000 * 1000;
-      auto chr = std::chrono::microseconds(static_cast<int>(ms));
-      std::this_thread::sleep_for(chr);
+      glm::rotate(ident, frame_state.rotation, glm::vec3(0.0f, 1.0f, 0.0f));
+    program.uniform_matrix_4fv(model_uniform, glm::value_ptr(model));
+
+    auto model_camera = glm::inverse(model) * glm::vec4(eye, 1);
+    auto camera = glm::vec3(model_camera.x, model_camera.y, model_camera.z);
+    if (lod) {
+      lod->update(
+        camera,
+        projection * view * model,
+        FOVY,
+        frame_height,
+        options.lod_error
+      );
+    } else {
+      mesh->update(camera, projection * view * model, options.cull);
     }
 
-    curTime = glfwGetTime();
-    elapsed_delta = curTime - last_time;
-    extra_time += target_delta - elapsed_delta;
-    last_time = curTime;
+    if (body_renderer) {
+      for (size_t i = 0; i < bodies.size(); ++i) {
+        body_instances[i] = {
+          .shape = bodies[i].shape,
+          .palette = bodies[i].palette,
+          .scale = bodies[i].scale,
+          .transform =
+            ds::get_body_transform(bodies[i], frame_state.body_time),
+        };
+      }
+      body_renderer->update(
+        body_instances,
+        eye,
+        projection * view,
+        FOVY,
+        frame_height,
+        lod ? 0 : mesh->inner_radius()
+      );
+    }
+
+    // Only now, so that the uploads and updates above aren't counted as GPU
+    // time of the frame.
+    if (resolution) {
+      resolution->begin_frame();
+    }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gpu_timer.begin("draw");
+    if (lod) {
+      lod->draw();
+    } else {
+      // The ocean goes first, for the terrain under it to fail the depth
+      // test early.
+      ocean->draw(camera, model, view, projection);
+      mesh->draw();
+    }
+    if (body_renderer) {
+      body_program->use();
+      body_program->uniform_matrix_4fv(
+        body_view_uniform,
+        glm::value_ptr(view)
+      );
+      body_program->uniform_matrix_4fv(
+        body_projection_uniform,
+        glm::value_ptr(projection)
+      );
+      body_renderer->draw();
+    }
+    gpu_timer.end();
+    if (resolution) {
+      resolution->end_frame();
+    }
+    if (recorder) {
+      recorder->capture();
+    }
+
+    gpu_timer.begin("swap_buffers");
+    surface.end_frame();
+    gpu_timer.end();
+    gpu_timer.poll();
+    if (recorder) {
+      recorder->poll();
+    }
+    if (resolution) {
+      resolution->poll();
+    }
 
+    pacer.end_frame(input_time, ds::get_time());
+    gl_calls = glpp::state::get_call_counts();
+
+    if (!surface.is_headless() && input_time - title_time >= 1) {
+      std::ostringstream title;
+      title << "Demo - " << pacer.recent_frames().count() << " fps, p99 "
+        << pacer.recent_frames().get_percentile(0.99) * 1000
+        << "ms, input to present p99 "
+        << pacer.recent_latencies().get_percentile(0.99) * 1000 << "ms";
+      if (resolution) {
+        title << ", resolution " << std::lround(resolution->scale() * 100)
+          << "%";
+      }
+      surface.set_title(title.str());
+      pacer.reset_recent();
+      title_time = input_time;
+    }
+  }
+  if (surface.is_headless()) {
+    pacer.print(std::cout);
+    if (lod) {
+      std::cout << "lod: " << lod->drawn_patch_count() << " patches, "
+        << lod->drawn_triangle_count() << " triangles in the last frame, "
+        << lod->generated_patch_count() << " patches generated" << std::endl;
+    } else {
+      std::cout << "planet: " << (cache_hit ? "loaded from cache" : "generated")
+        << " in " << setup_time * 1000 << "ms" << std::endl;
+      std::cout << "meshlets: " << mesh->submitted_meshlet_count() << " of "
+        << mesh->meshlet_count() << " submitted in the last frame, "
+        << mesh->submitted_triangle_count() << " of "
+        << mesh->triangle_count() << " triangles, "
+        << mesh->vertex_bytes() / 1024 << " KiB of vertices" << std::endl;
+      std::cout << "terrain: " << mesh->triangle_count() << " of "
+        << source_triangle_count << " triangles kept, "
+        << submerged_triangle_count << " under the ocean dropped, ocean of "
+        << ocean->triangle_count() << " triangles" << std::endl;
+      const auto& before = mesh->unoptimized_cache_stats();
+      const auto& after = mesh->cache_stats();
+      std::cout << "vertex cache: ACMR " << after.acmr << " (was "
+        << before.acmr << "), ATVR " << after.atvr << " (was "
+        << before.atvr << ")" << std::endl;
+    }
+  }
+  if (surface.is_headless()) {
+    std::cout << "gl state: " << gl_calls.issued << " calls issued, "
+      << gl_calls.elided << " elided in the last frame" << std::endl;
+    std::cout << "program cache: " << program_cache.hit_count() << " hits, "
+      << program_cache.miss_count() << " misses" << std::endl;
+    std::cout << "mesh arena: " << mesh_arena.allocated_bytes() / 1024
+      << " KiB in " << mesh_arena.buffer_count() << " buffers" << std::endl;
+  }
+  if (surface.is_headless() && resolution) {
+    std::cout << "resolution: " << resolution->scale() * 100
+      << "% in the last frame, down to " << resolution->min_used_scale() * 100
+      << "%, " << resolution->scaler().change_count() << " changes, GPU time "
+      << resolution->scaler().smoothed_time() * 1000 << "ms" << std::endl;
+  }
+  if (surface.is_headless() && body_renderer) {
+    std::cout << "bodies: " << body_renderer->drawn_instance_count() << " of "
+      << bodies.size() << " drawn in the last frame, "
+      << body_renderer->drawn_triangle_count() << " triangles in "
+      << body_renderer->draw_call_count() << " draw calls" << std::endl;
+  }
+  if (recorder) {
+    recorder->finish();
+    std::cout << "record: " << recorder->written_count() << " of "
+      << pacer.frame_count() << " frames written, "
+      << recorder->dropped_count() << " dropped waiting on the GPU, "
+      << recorder->backpressure_count() << " dropped behind the writer, "
+      << recorder->max_queued_count() << " queued at most" << std::endl;
+  }
+  if (!options.trace_path.empty()) {
+    write_trace(options.trace_path, gpu_timer);
   }
   return 0;
 }
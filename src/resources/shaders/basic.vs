@@ -3,16 +3,50 @@
 uniform mat4 Model;
 uniform mat4 View;
 uniform mat4 Projection;
+// Distance from the origin of the vertices with a packed height of 0 and 1.
+uniform vec2 HeightRange;
+// Vertices below are drawn at that height, but keep their color.
+uniform float OceanAltitude;
+// Colors by altitude along s, and by sine of the latitude along t.
+uniform sampler2D Palette;
+// Altitudes at the edges of the palette, with the ocean level right between
+// two texels.
+uniform vec2 PaletteRange;
 
-in vec4 position;
-in vec4 normal;
-in vec4 color;
+// See `ds::packed_vertex`: octahedral coordinates are mapped to [0, 1].
+in vec2 direction;
+in vec2 normal;
+in float height;
 out vec4 edge_color;
 
+vec3 decode_octahedral(vec2 encoded) {
+  vec2 coordinates = encoded * 2 - 1;
+  vec3 result = vec3(
+    coordinates,
+    1 - abs(coordinates.x) - abs(coordinates.y)
+  );
+  if (result.z < 0) {
+    vec2 signs = step(vec2(0), result.xy) * 2 - 1;
+    result.xy = (1 - abs(result.yx)) * signs;
+  }
+  return normalize(result);
+}
+
 void main() {
+  vec3 unit = decode_octahedral(direction);
+  float altitude = mix(HeightRange.x, HeightRange.y, height);
+  vec4 position = vec4(unit * max(altitude, OceanAltitude), 1);
   gl_Position = Projection * View * Model * position;
-  vec4 worldNormal = Model * normal;
+  vec4 worldNormal = Model * vec4(decode_octahedral(normal), 1);
   vec3 lightDir = normalize(vec3(0.1, 0.3, 1.0));
   float power = clamp(dot(worldNormal, vec4(lightDir, 1)), 0, 1);
-  edge_color = color * power;
+  float span = PaletteRange.y - PaletteRange.x;
+  float s = (altitude - PaletteRange.x) / span;
+  // Don't let the filtering blend the coast with the sea floor.
+  float ocean = (OceanAltitude - PaletteRange.x) / span;
+  float half_texel = 0.5 / textureSize(Palette, 0).x;
+  s = altitude <= OceanAltitude
+    ? min(s, ocean - half_texel)
+    : max(s, ocean + half_texel);
+  edge_color = texture(Palette, vec2(s, unit.y * 0.5 + 0.5)) * power;
 }
@@ -0,0 +1,51 @@
+#version 150
+
+uniform mat4 View;
+uniform mat4 Projection;
+// Same as in `basic.vs`, for the mesh being drawn.
+uniform vec2 HeightRange;
+uniform float OceanAltitude;
+uniform vec2 PaletteRange;
+// One palette per layer, see `ds::body_renderer`.
+uniform sampler2DArray Palettes;
+
+in vec2 direction;
+in vec2 normal;
+in float height;
+// Per instance: rotation and translation, then the scale and palette layer.
+in mat4 model;
+in vec2 body;
+out vec4 edge_color;
+
+vec3 decode_octahedral(vec2 encoded) {
+  vec2 coordinates = encoded * 2 - 1;
+  vec3 result = vec3(
+    coordinates,
+    1 - abs(coordinates.x) - abs(coordinates.y)
+  );
+  if (result.z < 0) {
+    vec2 signs = step(vec2(0), result.xy) * 2 - 1;
+    result.xy = (1 - abs(result.yx)) * signs;
+  }
+  return normalize(result);
+}
+
+void main() {
+  vec3 unit = decode_octahedral(direction);
+  float altitude = mix(HeightRange.x, HeightRange.y, height);
+  vec4 position = vec4(unit * max(altitude, OceanAltitude) * body.x, 1);
+  gl_Position = Projection * View * model * position;
+  // Lit like `basic.vs`, leaving out the translation of the instance.
+  vec4 worldNormal = vec4(mat3(model) * decode_octahedral(normal), 1);
+  vec3 lightDir = normalize(vec3(0.1, 0.3, 1.0));
+  float power = clamp(dot(worldNormal, vec4(lightDir, 1)), 0, 1);
+  float span = PaletteRange.y - PaletteRange.x;
+  float s = (altitude - PaletteRange.x) / span;
+  float ocean = (OceanAltitude - PaletteRange.x) / span;
+  float half_texel = 0.5 / textureSize(Palettes, 0).x;
+  s = altitude <= OceanAltitude
+    ? min(s, ocean - half_texel)
+    : max(s, ocean + half_texel);
+  edge_color =
+    texture(Palettes, vec3(s, unit.y * 0.5 + 0.5, body.y)) * power;
+}
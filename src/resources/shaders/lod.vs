@@ -0,0 +1,46 @@
+#version 150
+
+uniform mat4 Model;
+uniform mat4 View;
+uniform mat4 Projection;
+// Camera position in model space.
+uniform vec3 Camera;
+// Distances from the camera between which the patch morphs into its parent.
+uniform vec2 MorphRange;
+// Vertices below are already drawn at that height, but keep their color.
+uniform float OceanAltitude;
+// Colors by altitude along s, and by sine of the latitude along t.
+uniform sampler2D Palette;
+// Altitudes at the edges of the palette, with the ocean level right between
+// two texels.
+uniform vec2 PaletteRange;
+
+in vec4 position;
+in vec4 coarse_position;
+in vec4 normal;
+in float altitude;
+out vec4 edge_color;
+
+void main() {
+  float camera_distance = distance(position.xyz, Camera);
+  float morph = clamp(
+    (camera_distance - MorphRange.x) / (MorphRange.y - MorphRange.x),
+    0,
+    1
+  );
+  vec4 morphed = mix(position, coarse_position, morph);
+  gl_Position = Projection * View * Model * morphed;
+  vec4 worldNormal = Model * normal;
+  vec3 lightDir = normalize(vec3(0.1, 0.3, 1.0));
+  float power = clamp(dot(worldNormal, vec4(lightDir, 1)), 0, 1);
+  float span = PaletteRange.y - PaletteRange.x;
+  float s = (altitude - PaletteRange.x) / span;
+  // Don't let the filtering blend the coast with the sea floor.
+  float ocean = (OceanAltitude - PaletteRange.x) / span;
+  float half_texel = 0.5 / textureSize(Palette, 0).x;
+  s = altitude <= OceanAltitude
+    ? min(s, ocean - half_texel)
+    : max(s, ocean + half_texel);
+  float latitude = normalize(position.xyz).y;
+  edge_color = texture(Palette, vec2(s, latitude * 0.5 + 0.5)) * power;
+}
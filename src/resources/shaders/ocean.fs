@@ -0,0 +1,56 @@
+#version 150
+
+uniform mat4 Model;
+uniform mat4 View;
+uniform mat4 Projection;
+// In model space.
+uniform vec3 Camera;
+uniform vec2 Radii;
+// Distance from the origin of a sea floor texel of 0 and 1.
+uniform vec2 HeightRange;
+// Altitudes in octahedral coordinates mapped to [0, 1].
+uniform sampler2D SeaFloor;
+// See `basic.vs`.
+uniform sampler2D Palette;
+uniform vec2 PaletteRange;
+
+in vec3 model_position;
+out vec4 out_color;
+
+vec2 encode_octahedral(vec3 direction) {
+  vec3 result = direction / dot(abs(direction), vec3(1));
+  if (result.z < 0) {
+    vec2 signs = step(vec2(0), result.xy) * 2 - 1;
+    result.xy = (1 - abs(result.yx)) * signs;
+  }
+  return result.xy;
+}
+
+void main() {
+  vec3 ray = normalize(model_position - Camera);
+  float b = dot(Camera, ray);
+  float delta = b * b - dot(Camera, Camera) + Radii.x * Radii.x;
+  float t = -b - sqrt(max(delta, 0));
+  if (delta < 0 || t < 0) {
+    discard;
+  }
+  vec3 position = Camera + ray * t;
+  vec4 clip = Projection * View * Model * vec4(position, 1);
+  gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+  vec3 unit = position / Radii.x;
+  float height =
+    texture(SeaFloor, encode_octahedral(unit) * 0.5 + 0.5).r;
+  float altitude = mix(HeightRange.x, HeightRange.y, height);
+  // The sea floor is coarser than the terrain, it may come out above the
+  // ocean near the coasts.
+  float span = PaletteRange.y - PaletteRange.x;
+  float ocean = (Radii.x - PaletteRange.x) / span;
+  float half_texel = 0.5 / textureSize(Palette, 0).x;
+  float s = min((altitude - PaletteRange.x) / span, ocean - half_texel);
+  // Lit like the vertices of `basic.vs`, with the normal of the sphere.
+  vec4 worldNormal = Model * vec4(unit, 1);
+  vec3 lightDir = normalize(vec3(0.1, 0.3, 1.0));
+  float power = clamp(dot(worldNormal, vec4(lightDir, 1)), 0, 1);
+  out_color = texture(Palette, vec2(s, unit.y * 0.5 + 0.5)) * power;
+}
@@ -0,0 +1,18 @@
+#version 150
+
+uniform mat4 Model;
+uniform mat4 View;
+uniform mat4 Projection;
+// Radius of the ocean, and of the sphere that contains it once `position`
+// is scaled.
+uniform vec2 Radii;
+
+// Unit geodesic sphere, whose faces are outside of the unit sphere once
+// scaled to the second radius.
+in vec3 position;
+out vec3 model_position;
+
+void main() {
+  model_position = position * Radii.y;
+  gl_Position = Projection * View * Model * vec4(model_position, 1);
+}